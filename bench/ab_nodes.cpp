@@ -0,0 +1,133 @@
+/*
+   Search speed of DDS in nodes per second on a fixed set of boards,
+   to compare builds, for example with and without DDS_POS_BITBOARD,
+   and the plain search with the one compiled for each strain and
+   node type (SetSpecializedSearch).
+
+   The boards are random deals from a fixed seed, each solved for
+   one result in all five strains on thread 0. The node count and
+   the checksum must be the same for every build and search; only
+   the time should change. The two searches take turns for a number
+   of rounds, and the fastest round of each counts, as the time on
+   a shared machine only ever gets worse.
+
+   Build from the top of the repository:
+
+     g++ -O2 -std=c++11 -DDDS_THREADS_STL [-DDDS_POS_BITBOARD] \
+       -Idds bench/ab_nodes.cpp \
+       $(find dds -name '*.cpp' ! -name Python.cpp) -lpthread -o ab_nodes
+
+     ./ab_nodes [deals] [cards per hand] [rounds]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "dll.h"
+
+using namespace std;
+
+
+static void RandomDeal(
+  mt19937& rng,
+  const int cards,
+  deal& dl)
+{
+  vector<int> deck(52);
+  for (int c = 0; c < 52; c++)
+    deck[static_cast<unsigned>(c)] = c;
+  shuffle(deck.begin(), deck.end(), rng);
+
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      dl.remainCards[h][s] = 0;
+
+  for (int i = 0; i < DDS_HANDS * cards; i++)
+  {
+    const int c = deck[static_cast<unsigned>(i)];
+    dl.remainCards[i / cards][c / 13] |= 4u << (c % 13);
+  }
+
+  for (int k = 0; k < 3; k++)
+  {
+    dl.currentTrickSuit[k] = 0;
+    dl.currentTrickRank[k] = 0;
+  }
+}
+
+
+int main(int argc, char * argv[])
+{
+  const int count = (argc > 1 ? atoi(argv[1]) : 20);
+  const int cards = (argc > 2 ? atoi(argv[2]) : 13);
+  const int rounds = (argc > 3 ? atoi(argv[3]) : 3);
+
+  SetMaxThreads(0);
+
+  mt19937 rng(1);
+  vector<deal> deals(static_cast<unsigned>(count));
+  for (int i = 0; i < count; i++)
+  {
+    RandomDeal(rng, cards, deals[static_cast<unsigned>(i)]);
+    deals[static_cast<unsigned>(i)].first = i % DDS_HANDS;
+  }
+
+#ifdef DDS_POS_BITBOARD
+  const char * build = "bitboard";
+#else
+  const char * build = "plain";
+#endif
+
+  printf("%-9s %-12s %12s %10s %12s %18s\n",
+    "build", "search", "nodes", "seconds", "knodes/s", "checksum");
+
+  const int was = SetSpecializedSearch(0);
+  double best[2] = { 0., 0. };
+  long long nodes[2] = { 0, 0 };
+  unsigned long long sum[2] = { 0, 0 };
+
+  for (int round = 0; round < rounds; round++)
+  {
+    for (int spec = 0; spec < 2; spec++)
+    {
+      SetSpecializedSearch(spec);
+
+      futureTricks fut;
+      nodes[spec] = 0;
+      sum[spec] = 0;
+
+      auto t0 = chrono::steady_clock::now();
+      for (auto& dl : deals)
+      {
+        for (int strain = 0; strain < DDS_STRAINS; strain++)
+        {
+          dl.trump = strain;
+          if (SolveBoard(dl, -1, 1, 1, &fut, 0) != RETURN_NO_FAULT)
+          {
+            printf("SolveBoard failed\n");
+            return 1;
+          }
+          nodes[spec] += fut.nodes;
+          sum[spec] = sum[spec] * 1000003ULL +
+            static_cast<unsigned>(fut.score[0]);
+        }
+      }
+      auto t1 = chrono::steady_clock::now();
+
+      const double secs = chrono::duration<double>(t1 - t0).count();
+      if (round == 0 || secs < best[spec])
+        best[spec] = secs;
+    }
+  }
+  SetSpecializedSearch(was);
+
+  for (int spec = 0; spec < 2; spec++)
+    printf("%-9s %-12s %12lld %10.3f %12.1f   %016llx\n",
+      build, (spec ? "specialized" : "plain"), nodes[spec],
+      best[spec], nodes[spec] / best[spec] / 1000., sum[spec]);
+  return 0;
+}
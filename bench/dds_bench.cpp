@@ -0,0 +1,743 @@
+/*
+   Correctness and speed of the DDS batch solvers on a fixed corpus
+   of deals, for regression runs and to compare builds.
+
+   The corpus (bench/dds_corpus_v1.txt) holds three kinds of record,
+   each with its golden answer:
+
+     solve  a deal on lead with 13, 9 or 6 cards per hand, in any
+            strain, and the tricks for the side on lead
+     table  a full deal and its double dummy table
+     play   a full deal, the first cards played, and the tricks
+            after each of them, as AnalysePlayBin gives them
+
+   For each thread count, the solve records go through
+   SolveAllBoardsBin in batches of up to 200 boards, the tables
+   through CalcAllTables in calls of 10 deals, and the plays through
+   AnalyseAllPlaysBin in calls of 20 traces. Every answer is checked
+   against the corpus. The report has the rate in items per second
+   and the p50/p99 latency: per board for the solves, from
+   SetSolveTelemetry, and per call for the others. Peak RSS is for
+   the process so far, so it only grows from one thread count to the
+   next. With --json, the same comes out as one JSON object.
+
+   --write makes a new corpus from a fixed seed. Its golden answers
+   come from the single-board calls (SolveBoard and AnalysePlayBin)
+   rather than the batch calls that the benchmark times. A change to
+   the corpus gets a new version number in the file name and on its
+   first line.
+
+   Build from the top of the repository:
+
+     g++ -O2 -std=c++11 -DDDS_THREADS_STL -Idds bench/dds_bench.cpp \
+       $(find dds -name '*.cpp' ! -name Python.cpp) -lpthread -o dds_bench
+
+     ./dds_bench [--json] [corpus] [threads ...]
+     ./dds_bench --write corpus
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "dll.h"
+#include "PBN.h"
+
+using namespace std;
+
+
+static const char * CORPUS_VERSION = "dds-corpus 1";
+static const char * SUIT_CHARS = "SHDC";
+static const char * RANK_CHARS = "23456789TJQKA";
+
+static const int TABLES_PER_CALL = 10;
+static const int PLAYS_PER_CALL = 20;
+
+
+struct solveRecord
+{
+  deal dl;
+  int tricks;
+};
+
+struct tableRecord
+{
+  ddTableDeal dl;
+  ddTableResults res;
+};
+
+struct playRecord
+{
+  deal dl;
+  playTraceBin play;
+  solvedPlay golden;
+};
+
+struct corpusType
+{
+  vector<solveRecord> solves;
+  vector<tableRecord> tables;
+  vector<playRecord> plays;
+};
+
+struct workloadResult
+{
+  string name;
+  string per;
+  int items;
+  int mismatches;
+  double seconds;
+  double p50ms;
+  double p99ms;
+};
+
+
+static void Check(
+  const int ret,
+  const char * name)
+{
+  if (ret == RETURN_NO_FAULT)
+    return;
+
+  char line[80];
+  ErrorMessage(ret, line);
+  fprintf(stderr, "%s: %s\n", name, line);
+  exit(2);
+}
+
+
+static double Seconds(
+  chrono::steady_clock::time_point t0,
+  chrono::steady_clock::time_point t1)
+{
+  return chrono::duration<double>(t1 - t0).count();
+}
+
+
+static double Percentile(
+  vector<double> v,
+  const double p)
+{
+  if (v.empty())
+    return 0.;
+  sort(v.begin(), v.end());
+  const size_t i = static_cast<size_t>(p * static_cast<double>(v.size() - 1) + 0.5);
+  return v[i];
+}
+
+
+static long PeakRSSKB()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+
+// ------------------------------------------------------------------
+// Deals and plays, and their text form.
+// ------------------------------------------------------------------
+
+static void RandomCards(
+  mt19937& rng,
+  const int cards,
+  unsigned remain[DDS_HANDS][DDS_SUITS])
+{
+  vector<int> deck(52);
+  for (int c = 0; c < 52; c++)
+    deck[static_cast<unsigned>(c)] = c;
+  shuffle(deck.begin(), deck.end(), rng);
+
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      remain[h][s] = 0;
+
+  for (int i = 0; i < DDS_HANDS * cards; i++)
+  {
+    const int c = deck[static_cast<unsigned>(i)];
+    remain[i / cards][c / 13] |= 4u << (c % 13);
+  }
+}
+
+
+static void ClearTrick(deal& dl)
+{
+  for (int k = 0; k < 3; k++)
+  {
+    dl.currentTrickSuit[k] = 0;
+    dl.currentTrickRank[k] = 0;
+  }
+}
+
+
+static string ToPBN(const unsigned remain[DDS_HANDS][DDS_SUITS])
+{
+  string out = "N:";
+  for (int h = 0; h < DDS_HANDS; h++)
+  {
+    if (h > 0)
+      out += ' ';
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      if (s > 0)
+        out += '.';
+      for (int r = 14; r >= 2; r--)
+        if (remain[h][s] & (1u << r))
+          out += RANK_CHARS[r - 2];
+    }
+  }
+  return out;
+}
+
+
+static void RandomPlay(
+  mt19937& rng,
+  const deal& dl,
+  const int cards,
+  playTraceBin& play)
+{
+  // Random legal cards from the lead, with the trick winner leading
+  // to the next trick.
+  unsigned remain[DDS_HANDS][DDS_SUITS];
+  memcpy(remain, dl.remainCards, sizeof(remain));
+
+  int leader = dl.first;
+  int winner = leader, winSuit = 0, winRank = 0;
+  play.number = cards;
+
+  for (int i = 0; i < cards; i++)
+  {
+    const int pos = i % 4;
+    if (pos == 0)
+      leader = winner;
+    const int hand = (leader + pos) % DDS_HANDS;
+    const int leadSuit = (pos == 0 ? -1 : play.suit[i - pos]);
+
+    vector<int> legal;
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      if (leadSuit != -1 && s != leadSuit && remain[hand][leadSuit])
+        continue;
+      for (int r = 2; r <= 14; r++)
+        if (remain[hand][s] & (1u << r))
+          legal.push_back(16 * s + r);
+    }
+
+    const int c = legal[rng() % legal.size()];
+    const int s = c / 16, r = c % 16;
+    remain[hand][s] &= ~(1u << r);
+    play.suit[i] = s;
+    play.rank[i] = r;
+
+    if (pos == 0 ||
+        (s == winSuit && r > winRank) ||
+        (s == dl.trump && winSuit != dl.trump))
+    {
+      winner = hand;
+      winSuit = s;
+      winRank = r;
+    }
+  }
+}
+
+
+static string PlayText(const playTraceBin& play)
+{
+  string out;
+  for (int i = 0; i < play.number; i++)
+  {
+    out += SUIT_CHARS[play.suit[i]];
+    out += RANK_CHARS[play.rank[i] - 2];
+  }
+  return out;
+}
+
+
+static bool ParsePlay(
+  const char * text,
+  playTraceBin& play)
+{
+  const size_t len = strlen(text);
+  if (len % 2 || len > 104)
+    return false;
+
+  play.number = static_cast<int>(len / 2);
+  for (int i = 0; i < play.number; i++)
+  {
+    const char * s = strchr(SUIT_CHARS, text[2 * i]);
+    const char * r = strchr(RANK_CHARS, text[2 * i + 1]);
+    if (s == nullptr || r == nullptr)
+      return false;
+    play.suit[i] = static_cast<int>(s - SUIT_CHARS);
+    play.rank[i] = static_cast<int>(r - RANK_CHARS) + 2;
+  }
+  return true;
+}
+
+
+// ------------------------------------------------------------------
+// Reading and writing the corpus.
+// ------------------------------------------------------------------
+
+static bool ReadQuoted(
+  char *& p,
+  string& out)
+{
+  while (* p == ' ')
+    p++;
+  if (* p != '"')
+    return false;
+  char * end = strchr(p + 1, '"');
+  if (end == nullptr)
+    return false;
+  out.assign(p + 1, end);
+  p = end + 1;
+  return true;
+}
+
+
+static bool ReadInts(
+  char *& p,
+  const int n,
+  int * out)
+{
+  for (int i = 0; i < n; i++)
+  {
+    char * end;
+    out[i] = static_cast<int>(strtol(p, &end, 10));
+    if (end == p)
+      return false;
+    p = end;
+  }
+  return true;
+}
+
+
+static bool ParseLine(
+  char * line,
+  corpusType& corpus)
+{
+  char kind[8];
+  int used;
+  if (sscanf(line, "%7s%n", kind, &used) != 1)
+    return false;
+  char * p = line + used;
+  string pbn, plays;
+
+  if (strcmp(kind, "solve") == 0)
+  {
+    solveRecord rec;
+    int tf[2];
+    if (! ReadInts(p, 2, tf) || ! ReadQuoted(p, pbn) ||
+        ! ReadInts(p, 1, &rec.tricks))
+      return false;
+    rec.dl.trump = tf[0];
+    rec.dl.first = tf[1];
+    ClearTrick(rec.dl);
+    if (ConvertFromPBN(pbn.c_str(), rec.dl.remainCards) != RETURN_NO_FAULT)
+      return false;
+    corpus.solves.push_back(rec);
+    return true;
+  }
+  else if (strcmp(kind, "table") == 0)
+  {
+    tableRecord rec;
+    if (! ReadQuoted(p, pbn) ||
+        ! ReadInts(p, DDS_STRAINS * DDS_HANDS, &rec.res.resTable[0][0]))
+      return false;
+    if (ConvertFromPBN(pbn.c_str(), rec.dl.cards) != RETURN_NO_FAULT)
+      return false;
+    corpus.tables.push_back(rec);
+    return true;
+  }
+  else if (strcmp(kind, "play") == 0)
+  {
+    playRecord rec;
+    int tf[2];
+    if (! ReadInts(p, 2, tf) || ! ReadQuoted(p, pbn) ||
+        ! ReadQuoted(p, plays) || ! ParsePlay(plays.c_str(), rec.play))
+      return false;
+    rec.dl.trump = tf[0];
+    rec.dl.first = tf[1];
+    ClearTrick(rec.dl);
+    if (ConvertFromPBN(pbn.c_str(), rec.dl.remainCards) != RETURN_NO_FAULT)
+      return false;
+    rec.golden.number = rec.play.number + 1;
+    if (! ReadInts(p, rec.golden.number, rec.golden.tricks))
+      return false;
+    corpus.plays.push_back(rec);
+    return true;
+  }
+  return false;
+}
+
+
+static bool ReadCorpus(
+  const char * fname,
+  corpusType& corpus)
+{
+  FILE * fp = fopen(fname, "r");
+  if (fp == nullptr)
+  {
+    fprintf(stderr, "Cannot open %s\n", fname);
+    return false;
+  }
+
+  char line[512];
+  bool ok = (fgets(line, sizeof(line), fp) != nullptr &&
+    strncmp(line, CORPUS_VERSION, strlen(CORPUS_VERSION)) == 0);
+  if (! ok)
+    fprintf(stderr, "%s: not a %s file\n", fname, CORPUS_VERSION);
+
+  int lineNo = 1;
+  while (ok && fgets(line, sizeof(line), fp))
+  {
+    lineNo++;
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+    if (! ParseLine(line, corpus))
+    {
+      fprintf(stderr, "%s:%d: bad record\n", fname, lineNo);
+      ok = false;
+    }
+  }
+
+  fclose(fp);
+  return ok;
+}
+
+
+static int WriteCorpus(const char * fname)
+{
+  FILE * fp = fopen(fname, "w");
+  if (fp == nullptr)
+  {
+    fprintf(stderr, "Cannot open %s\n", fname);
+    return 2;
+  }
+
+  SetMaxThreads(0);
+  mt19937 rng(20181);
+  futureTricks fut;
+
+  fprintf(fp, "%s\n", CORPUS_VERSION);
+  fprintf(fp, "# solve <trump> <first> \"<deal>\" <tricks for the side on lead>\n");
+  fprintf(fp, "# table \"<deal>\" <tricks for N E S W in S, H, D, C, NT>\n");
+  fprintf(fp, "# play <trump> <first> \"<deal>\" \"<cards>\" <tricks before each>\n");
+  fprintf(fp, "# Suits 0-3 are SHDC and 4 is NT; hands 0-3 are NESW.\n");
+
+  const int solveCards[] = { 13, 9, 6 };
+  const int solveCount[] = { 40, 60, 100 };
+  for (int k = 0; k < 3; k++)
+  {
+    for (int i = 0; i < solveCount[k]; i++)
+    {
+      deal dl;
+      RandomCards(rng, solveCards[k], dl.remainCards);
+      dl.trump = i % DDS_STRAINS;
+      dl.first = static_cast<int>(rng() % DDS_HANDS);
+      ClearTrick(dl);
+      Check(SolveBoard(dl, -1, 1, 1, &fut, 0), "SolveBoard");
+      fprintf(fp, "solve %d %d \"%s\" %d\n", dl.trump, dl.first,
+        ToPBN(dl.remainCards).c_str(), fut.score[0]);
+    }
+  }
+
+  for (int i = 0; i < 4 * TABLES_PER_CALL; i++)
+  {
+    deal dl;
+    RandomCards(rng, 13, dl.remainCards);
+    ClearTrick(dl);
+    fprintf(fp, "table \"%s\"", ToPBN(dl.remainCards).c_str());
+    for (int strain = 0; strain < DDS_STRAINS; strain++)
+    {
+      for (int decl = 0; decl < DDS_HANDS; decl++)
+      {
+        dl.trump = strain;
+        dl.first = (decl + 1) % DDS_HANDS;
+        Check(SolveBoard(dl, -1, 1, 1, &fut, 0), "SolveBoard");
+        fprintf(fp, " %d", 13 - fut.score[0]);
+      }
+    }
+    fprintf(fp, "\n");
+  }
+
+  for (int i = 0; i < 2 * PLAYS_PER_CALL; i++)
+  {
+    deal dl;
+    playTraceBin play;
+    solvedPlay sp;
+    RandomCards(rng, 13, dl.remainCards);
+    dl.trump = i % DDS_STRAINS;
+    dl.first = static_cast<int>(rng() % DDS_HANDS);
+    ClearTrick(dl);
+    RandomPlay(rng, dl, 4 + i % 9, play);
+    Check(AnalysePlayBin(dl, play, &sp, 0), "AnalysePlayBin");
+
+    fprintf(fp, "play %d %d \"%s\" \"%s\"", dl.trump, dl.first,
+      ToPBN(dl.remainCards).c_str(), PlayText(play).c_str());
+    for (int k = 0; k < sp.number; k++)
+      fprintf(fp, " %d", sp.tricks[k]);
+    fprintf(fp, "\n");
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+
+// ------------------------------------------------------------------
+// The three workloads.
+// ------------------------------------------------------------------
+
+static workloadResult RunSolves(const corpusType& corpus)
+{
+  workloadResult wr = { "solve", "board", 0, 0, 0., 0., 0. };
+  boards * bop = new boards;
+  solvedBoards * solvedp = new solvedBoards;
+  solveTelemetry * telp = new solveTelemetry;
+  vector<double> latency;
+
+  const int wasOn = SetSolveTelemetry(1);
+  const int n = static_cast<int>(corpus.solves.size());
+
+  for (int start = 0; start < n; start += MAXNOOFBOARDS)
+  {
+    bop->noOfBoards = min(MAXNOOFBOARDS, n - start);
+    for (int b = 0; b < bop->noOfBoards; b++)
+    {
+      bop->deals[b] = corpus.solves[static_cast<unsigned>(start + b)].dl;
+      bop->target[b] = -1;
+      bop->solutions[b] = 1;
+      bop->mode[b] = 1;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    Check(SolveAllBoardsBin(bop, solvedp), "SolveAllBoardsBin");
+    wr.seconds += Seconds(t0, chrono::steady_clock::now());
+
+    GetSolveTelemetry(telp);
+    for (int b = 0; b < bop->noOfBoards; b++)
+    {
+      latency.push_back(telp->micros[b] / 1000.);
+      if (solvedp->solvedBoard[b].score[0] !=
+          corpus.solves[static_cast<unsigned>(start + b)].tricks)
+        wr.mismatches++;
+    }
+  }
+
+  SetSolveTelemetry(wasOn);
+  wr.items = n;
+  wr.p50ms = Percentile(latency, 0.5);
+  wr.p99ms = Percentile(latency, 0.99);
+
+  delete telp;
+  delete solvedp;
+  delete bop;
+  return wr;
+}
+
+
+static workloadResult RunTables(const corpusType& corpus)
+{
+  workloadResult wr = { "table", "call", 0, 0, 0., 0., 0. };
+  ddTableDeals * dealsp = new ddTableDeals;
+  ddTablesRes * resp = new ddTablesRes;
+  allParResults * parp = new allParResults;
+  int filter[DDS_STRAINS] = { 0, 0, 0, 0, 0 };
+  vector<double> latency;
+
+  const int n = static_cast<int>(corpus.tables.size());
+
+  for (int start = 0; start < n; start += TABLES_PER_CALL)
+  {
+    dealsp->noOfTables = min(TABLES_PER_CALL, n - start);
+    for (int m = 0; m < dealsp->noOfTables; m++)
+      dealsp->deals[m] = corpus.tables[static_cast<unsigned>(start + m)].dl;
+
+    auto t0 = chrono::steady_clock::now();
+    Check(CalcAllTables(dealsp, -1, filter, resp, parp), "CalcAllTables");
+    const double s = Seconds(t0, chrono::steady_clock::now());
+    wr.seconds += s;
+    latency.push_back(1000. * s);
+
+    for (int m = 0; m < dealsp->noOfTables; m++)
+    {
+      const ddTableResults& golden =
+        corpus.tables[static_cast<unsigned>(start + m)].res;
+      if (memcmp(resp->results[m].resTable, golden.resTable,
+          sizeof(golden.resTable)) != 0)
+        wr.mismatches++;
+    }
+  }
+
+  wr.items = n;
+  wr.p50ms = Percentile(latency, 0.5);
+  wr.p99ms = Percentile(latency, 0.99);
+
+  delete parp;
+  delete resp;
+  delete dealsp;
+  return wr;
+}
+
+
+static workloadResult RunPlays(const corpusType& corpus)
+{
+  workloadResult wr = { "play", "call", 0, 0, 0., 0., 0. };
+  boards * bop = new boards;
+  playTracesBin * plp = new playTracesBin;
+  solvedPlays * solvedp = new solvedPlays;
+  vector<double> latency;
+
+  const int n = static_cast<int>(corpus.plays.size());
+
+  for (int start = 0; start < n; start += PLAYS_PER_CALL)
+  {
+    const int count = min(PLAYS_PER_CALL, n - start);
+    bop->noOfBoards = count;
+    plp->noOfBoards = count;
+    for (int b = 0; b < count; b++)
+    {
+      const playRecord& rec = corpus.plays[static_cast<unsigned>(start + b)];
+      bop->deals[b] = rec.dl;
+      bop->target[b] = -1;
+      bop->solutions[b] = 1;
+      bop->mode[b] = 1;
+      plp->plays[b] = rec.play;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    Check(AnalyseAllPlaysBin(bop, plp, solvedp, 1), "AnalyseAllPlaysBin");
+    const double s = Seconds(t0, chrono::steady_clock::now());
+    wr.seconds += s;
+    latency.push_back(1000. * s);
+
+    for (int b = 0; b < count; b++)
+    {
+      const solvedPlay& golden =
+        corpus.plays[static_cast<unsigned>(start + b)].golden;
+      const solvedPlay& got = solvedp->solved[b];
+      if (got.number != golden.number ||
+          ! equal(golden.tricks, golden.tricks + golden.number, got.tricks))
+        wr.mismatches++;
+    }
+  }
+
+  wr.items = n;
+  wr.p50ms = Percentile(latency, 0.5);
+  wr.p99ms = Percentile(latency, 0.99);
+
+  delete solvedp;
+  delete plp;
+  delete bop;
+  return wr;
+}
+
+
+// ------------------------------------------------------------------
+// Reports.
+// ------------------------------------------------------------------
+
+static void PrintTable(
+  const int threads,
+  const vector<workloadResult>& results,
+  const long rss)
+{
+  printf("threads %d, peak RSS %ld KB\n", threads, rss);
+  printf("%-6s %6s %9s %10s %6s %9s %9s %6s\n",
+    "run", "items", "seconds", "items/s", "per", "p50 ms", "p99 ms", "wrong");
+  for (auto& wr : results)
+    printf("%-6s %6d %9.3f %10.1f %6s %9.2f %9.2f %6d\n",
+      wr.name.c_str(), wr.items, wr.seconds,
+      wr.seconds > 0. ? wr.items / wr.seconds : 0.,
+      wr.per.c_str(), wr.p50ms, wr.p99ms, wr.mismatches);
+  printf("\n");
+}
+
+
+static void PrintJSON(
+  const int threads,
+  const vector<workloadResult>& results,
+  const long rss,
+  const bool first)
+{
+  printf("%s\n    {\"threads\": %d, \"peak_rss_kb\": %ld, \"workloads\": [",
+    first ? "" : ",", threads, rss);
+  for (unsigned i = 0; i < results.size(); i++)
+  {
+    const workloadResult& wr = results[i];
+    printf("%s\n      {\"name\": \"%s\", \"items\": %d, "
+      "\"seconds\": %.6f, \"items_per_s\": %.3f, \"latency_per\": \"%s\", "
+      "\"p50_ms\": %.3f, \"p99_ms\": %.3f, \"mismatches\": %d}",
+      i ? "," : "", wr.name.c_str(), wr.items, wr.seconds,
+      wr.seconds > 0. ? wr.items / wr.seconds : 0.,
+      wr.per.c_str(), wr.p50ms, wr.p99ms, wr.mismatches);
+  }
+  printf("]}");
+}
+
+
+int main(int argc, char * argv[])
+{
+  bool json = false;
+  const char * fname = "bench/dds_corpus_v1.txt";
+  vector<int> threadList;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--json") == 0)
+      json = true;
+    else if (strcmp(argv[i], "--write") == 0)
+      return (i + 1 < argc ? WriteCorpus(argv[i + 1]) : 2);
+    else if (argv[i][0] >= '0' && argv[i][0] <= '9')
+      threadList.push_back(atoi(argv[i]));
+    else
+      fname = argv[i];
+  }
+  if (threadList.empty())
+    threadList.push_back(0);
+
+  corpusType corpus;
+  if (! ReadCorpus(fname, corpus))
+    return 2;
+
+  if (json)
+    printf("{\"corpus\": \"%s\", \"file\": \"%s\", \"runs\": [",
+      CORPUS_VERSION, fname);
+  else
+    printf("%s: %zu solves, %zu tables, %zu plays\n\n", fname,
+      corpus.solves.size(), corpus.tables.size(), corpus.plays.size());
+
+  int mismatches = 0;
+  for (unsigned k = 0; k < threadList.size(); k++)
+  {
+    // 0 is one thread per core.
+    SetResources(0, threadList[k]);
+    DDSInfo info;
+    GetDDSInfo(&info);
+
+    vector<workloadResult> results;
+    results.push_back(RunSolves(corpus));
+    results.push_back(RunTables(corpus));
+    results.push_back(RunPlays(corpus));
+    for (auto& wr : results)
+      mismatches += wr.mismatches;
+
+    if (json)
+      PrintJSON(info.noOfThreads, results, PeakRSSKB(), k == 0);
+    else
+      PrintTable(info.noOfThreads, results, PeakRSSKB());
+  }
+
+  if (json)
+    printf("\n  ], \"mismatches\": %d}\n", mismatches);
+  return (mismatches ? 1 : 0);
+}
@@ -0,0 +1,133 @@
+"""
+Tail latency of DDS batch solves with and without work stealing, and
+with the batches ordered by the built-in constants or by the scheduler's
+fitted time model (dds.set_scheduler_model).
+
+Each batch is 200 boards, one call to the solver.  For every batch this
+reports the wall time and the load balance from dds.scheduler_stats():
+the busiest thread's CPU time over the mean.  A balance of 1.00 means
+no thread sat idle waiting for another to finish.  "pred" is the fitted
+model's mean |ln(predicted/actual)| solve time, and "corr" the
+correlation of the logs, over the last half of the batches, after the
+model has had a chance to calibrate.
+
+    python bench/dds_tail.py [batches] [seed]
+
+Two kinds of batch are run:
+  skewed   mostly 5-card notrump endings, with every tenth board an
+           11-card suit ending, which costs a hundred times as much
+  related  9-card spade endings sharing North/South, solved in related
+           mode, so the default scheduler keeps them all on one thread
+
+Needs more than one core to say anything; with one core there is only
+one thread and nothing to balance.
+"""
+
+import random
+import sys
+import time
+from array import array
+
+from bridgemoose import dds
+
+BATCH = 200
+
+
+def add_hand(hands, cards):
+    mask = 0
+    for c in cards:
+        mask |= 1 << (16 * (c // 13) + 2 + c % 13)
+    hands.append(mask)
+
+
+def add_deal(hands, rng, ncards, fixed=None):
+    if fixed is None:
+        deck = list(range(52))
+        rng.shuffle(deck)
+        seats = [deck[i*ncards:(i+1)*ncards] for i in range(4)]
+    else:
+        rest = [c for c in range(52) if c not in fixed]
+        rng.shuffle(rest)
+        n, s = fixed[:ncards], fixed[ncards:2*ncards]
+        seats = [rest[:ncards], n, rest[ncards:2*ncards], s]
+    for cards in seats:
+        add_hand(hands, cards)
+
+
+def make_batch(kind, rng):
+    hands = array("Q")
+    strains = array("B")
+    if kind == "skewed":
+        for j in range(BATCH):
+            hard = (j % 10 == 9)
+            add_deal(hands, rng, 11 if hard else 5)
+            strains.append(2 if hard else 4)
+    else:
+        fixed = rng.sample(range(52), 18)
+        for j in range(BATCH):
+            add_deal(hands, rng, 9, fixed)
+            strains.append(3)
+    return hands, strains
+
+
+def percentile(xs, p):
+    xs = sorted(xs)
+    return xs[min(len(xs) - 1, int(p * len(xs)))]
+
+
+def run(kind, steal, model, batches, seed):
+    rng = random.Random(seed)
+    old_steal = dds.set_work_stealing(steal)
+    old_model = dds.set_scheduler_model(model)
+    old_related = dds.set_related_boards(kind == "related")
+
+    walls = []
+    balance = []
+    steals = 0
+    errors = []
+    corrs = []
+    results = array("B")
+    for b in range(batches):
+        hands, strains = make_batch(kind, rng)
+        out = bytearray(BATCH)
+        t0 = time.perf_counter()
+        dds.solve_many_packed(hands, strains, 0, out)
+        walls.append(time.perf_counter() - t0)
+        results.extend(out)
+
+        stats = dds.scheduler_stats()
+        busy = stats["busy_us"]
+        mean = sum(busy) / len(busy)
+        balance.append(max(busy) / mean if mean else 1.0)
+        steals += stats["steals"]
+        if 2 * b >= batches:
+            errors.append(stats["mean_abs_log_error"])
+            corrs.append(stats["log_correlation"])
+
+    dds.set_work_stealing(old_steal)
+    dds.set_scheduler_model(old_model)
+    dds.set_related_boards(old_related)
+
+    print("%-8s steal=%d model=%d  wall p50 %7.1f ms  p99 %7.1f ms  "
+        "balance mean %.2f max %.2f  steals/batch %.1f  "
+        "pred %.2f corr %.2f" % (
+        kind, steal, model, 1000 * percentile(walls, 0.5),
+        1000 * percentile(walls, 0.99),
+        sum(balance) / len(balance), max(balance), steals / batches,
+        sum(errors) / len(errors), sum(corrs) / len(corrs)))
+    return results
+
+
+def main():
+    batches = int(sys.argv[1]) if len(sys.argv) > 1 else 20
+    seed = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+    for kind in ("skewed", "related"):
+        plain = run(kind, False, False, batches, seed)
+        for steal, model in ((True, False), (False, True), (True, True)):
+            if run(kind, steal, model, batches, seed) != plain:
+                print("MISMATCH between scheduling modes for", kind)
+                sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,234 @@
+/*
+   Per-board setup cost of DDS on tiny endings, where building the
+   tables for a new deal takes longer than the search itself.
+
+   Three runs of 3-card endings, one board at a time on thread 0:
+
+     random    every board a fresh random ending
+     one-suit  each board swaps two cards of one suit between
+               hands, so the other three suits keep their layout
+     same      one ending over and over, with the leader rotating
+
+   and one batch run through SolveAllBoardsBin in related mode,
+   with North/South fixed and East/West re-dealt, so that the
+   scheduler's order within a group decides how much changes
+   from one board to the next.
+
+   The checksum covers every result, to compare builds.
+
+   Build from the top of the repository:
+
+     g++ -O2 -std=c++11 -DDDS_THREADS_STL -Idds bench/deal_setup.cpp \
+       $(find dds -name '*.cpp' ! -name Python.cpp) -lpthread -o deal_setup
+
+     ./deal_setup [boards]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "dll.h"
+
+using namespace std;
+
+
+static const int CARDS = 3;
+
+
+static void RandomEnding(
+  mt19937& rng,
+  deal& dl)
+{
+  vector<int> deck(52);
+  for (int c = 0; c < 52; c++)
+    deck[static_cast<unsigned>(c)] = c;
+  shuffle(deck.begin(), deck.end(), rng);
+
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      dl.remainCards[h][s] = 0;
+
+  for (int i = 0; i < DDS_HANDS * CARDS; i++)
+  {
+    const int c = deck[static_cast<unsigned>(i)];
+    dl.remainCards[i / CARDS][c / 13] |= 4u << (c % 13);
+  }
+
+  dl.trump = static_cast<int>(rng() % 5);
+  dl.first = static_cast<int>(rng() % 4);
+  for (int k = 0; k < 3; k++)
+  {
+    dl.currentTrickSuit[k] = 0;
+    dl.currentTrickRank[k] = 0;
+  }
+}
+
+
+static void SwapInOneSuit(
+  mt19937& rng,
+  deal& dl)
+{
+  // Two cards of the same suit in different hands change places.
+  while (true)
+  {
+    const int s = static_cast<int>(rng() % DDS_SUITS);
+    const int h1 = static_cast<int>(rng() % DDS_HANDS);
+    const int h2 = static_cast<int>(rng() % DDS_HANDS);
+    const unsigned c1 = dl.remainCards[h1][s];
+    const unsigned c2 = dl.remainCards[h2][s];
+    if (h1 == h2 || c1 == 0 || c2 == 0)
+      continue;
+
+    const unsigned b1 = c1 & (0u - c1);
+    const unsigned b2 = c2 & (0u - c2);
+    dl.remainCards[h1][s] ^= b1 | b2;
+    dl.remainCards[h2][s] ^= b1 | b2;
+    return;
+  }
+}
+
+
+static unsigned long long Mix(
+  unsigned long long sum,
+  const futureTricks& fut)
+{
+  sum = sum * 1000003ULL + static_cast<unsigned>(fut.score[0]);
+  return sum * 1000003ULL + static_cast<unsigned>(fut.cards);
+}
+
+
+static double RunSingle(
+  const vector<deal>& deals,
+  unsigned long long& sum)
+{
+  futureTricks fut;
+
+  auto t0 = chrono::steady_clock::now();
+  for (auto& dl : deals)
+  {
+    if (SolveBoard(dl, -1, 3, 1, &fut, 0) != RETURN_NO_FAULT)
+    {
+      printf("SolveBoard failed\n");
+      exit(1);
+    }
+    sum = Mix(sum, fut);
+  }
+  auto t1 = chrono::steady_clock::now();
+
+  return chrono::duration<double, micro>(t1 - t0).count() /
+    static_cast<double>(deals.size());
+}
+
+
+static double RunRelated(
+  mt19937& rng,
+  const int count,
+  unsigned long long& sum)
+{
+  boards * bop = new boards;
+  solvedBoards * solvedp = new solvedBoards;
+
+  const int was = SetRelatedBoards(1);
+  double micros = 0.;
+  int done = 0;
+
+  while (done < count)
+  {
+    // One ending per batch. North and South keep their cards,
+    // and East and West share out theirs afresh for each board.
+    deal base;
+    RandomEnding(rng, base);
+
+    vector<int> pool;
+    for (int h = 1; h < DDS_HANDS; h += 2)
+      for (int s = 0; s < DDS_SUITS; s++)
+        for (int r = 2; r <= 14; r++)
+          if (base.remainCards[h][s] & (1u << r))
+            pool.push_back(16 * s + r);
+
+    bop->noOfBoards = min(MAXNOOFBOARDS, count - done);
+    for (int b = 0; b < bop->noOfBoards; b++)
+    {
+      deal& dl = bop->deals[b];
+      dl = base;
+      shuffle(pool.begin(), pool.end(), rng);
+      for (int s = 0; s < DDS_SUITS; s++)
+      {
+        dl.remainCards[1][s] = 0;
+        dl.remainCards[3][s] = 0;
+      }
+      for (unsigned i = 0; i < pool.size(); i++)
+      {
+        const int h = (i < CARDS ? 1 : 3);
+        dl.remainCards[h][pool[i] / 16] |= 1u << (pool[i] % 16);
+      }
+
+      bop->target[b] = -1;
+      bop->solutions[b] = 3;
+      bop->mode[b] = 1;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    if (SolveAllBoardsBin(bop, solvedp) != RETURN_NO_FAULT)
+    {
+      printf("SolveAllBoardsBin failed\n");
+      exit(1);
+    }
+    auto t1 = chrono::steady_clock::now();
+    micros += chrono::duration<double, micro>(t1 - t0).count();
+
+    for (int b = 0; b < bop->noOfBoards; b++)
+      sum = Mix(sum, solvedp->solvedBoard[b]);
+    done += bop->noOfBoards;
+  }
+
+  SetRelatedBoards(was);
+  delete solvedp;
+  delete bop;
+  return micros / count;
+}
+
+
+int main(int argc, char * argv[])
+{
+  const int count = (argc > 1 ? atoi(argv[1]) : 20000);
+
+  SetMaxThreads(0);
+
+  mt19937 rng(1);
+  unsigned long long sum = 0;
+  vector<deal> deals(static_cast<unsigned>(count));
+
+  for (auto& dl : deals)
+    RandomEnding(rng, dl);
+  const double random = RunSingle(deals, sum);
+
+  RandomEnding(rng, deals[0]);
+  for (unsigned i = 1; i < deals.size(); i++)
+  {
+    deals[i] = deals[i - 1];
+    SwapInOneSuit(rng, deals[i]);
+  }
+  const double oneSuit = RunSingle(deals, sum);
+
+  for (unsigned i = 1; i < deals.size(); i++)
+  {
+    deals[i] = deals[0];
+    deals[i].first = static_cast<int>(i % DDS_HANDS);
+  }
+  const double same = RunSingle(deals, sum);
+
+  const double related = RunRelated(rng, count, sum);
+
+  printf("%-9s %10s\n", "run", "us/board");
+  printf("%-9s %10.2f\n", "random", random);
+  printf("%-9s %10.2f\n", "one-suit", oneSuit);
+  printf("%-9s %10.2f\n", "same", same);
+  printf("%-9s %10.2f\n", "related", related);
+  printf("checksum %016llx\n", sum);
+  return 0;
+}
@@ -0,0 +1,568 @@
+/*
+   Work done by the jade single-dummy solvers on a fixed set of
+   problems, to compare builds.
+
+   Each argument is a PROBLEM file, as PROBLEM::write_to_filestream
+   writes it, with an optional play prefix after a colon: the cards
+   played so far, from the opening lead, in jade's own card text
+   (suit first, CDHS).
+
+   For every problem, ANSOLVER::eval (can one line of play make the
+   target against all of the deals?) and SOLVER::eval (the sets of
+   deals that one line can beat) run from a fresh solver, and the
+   report has the answer, the wall time of the eval, the solver's
+   whole stats map (including the BDT node count, the BDT memo maps
+   and the TT size), and the peak RSS of the process so far. "live"
+   is the number of deals that are still consistent with the play
+   prefix. When both solvers run, their answers must agree on
+   whether one line beats all the live deals. --solver picks one of
+   the two, and with --json the same comes out as one JSON object.
+
+   --write makes a problem from a fixed seed: a random deal and
+   strain, and a play prefix of the given number of whole tricks of
+   random legal cards. The other East/West layouts keep the cards
+   that East and West have played and share out the rest at random,
+   so that every layout is live after the prefix. The target is the
+   fewest tricks that North/South make double dummy from there on
+   any of the layouts, which is the hardest case for ANSOLVER. It
+   prints the argument for the benchmark.
+
+   The fixed set, bench/jade_problem[1-4].bin, is seeds 1 to 4 with
+   16 layouts and 4 tricks played:
+
+     ./jade_bench \
+       bench/jade_problem1.bin:S3S9S4S7SQS5SAS6S2SKSJS8D3D4DKD7 \
+       bench/jade_problem2.bin:C2C9CQCAHAH2HJH8C3CKC6CTD2DJD9DT \
+       bench/jade_problem3.bin:C7CJC5C6D4DQD8DKSKS7S9SACTCQC9C2 \
+       bench/jade_problem4.bin:D7D5D9D4C9C8C7C2DTDJD2DKSKS3S6S2
+
+   Build from the top of the repository:
+
+     g++ -O2 -std=c++11 -DDDS_THREADS_STL -Idds -Ijade \
+       bench/jade_bench.cpp $(find jade -name '*.cpp' ! -name Python.cpp) \
+       $(find dds -name '*.cpp' ! -name Python.cpp) -lpthread -o jade_bench
+
+     ./jade_bench [--json] [--solver an|bdt] problem[:plays] ...
+     ./jade_bench --write problem seed deals [tricks]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "dll.h"
+#include "ansolver.h"
+#include "solver.h"
+#include "solutil.h"
+#include "problem.h"
+
+using namespace std;
+
+
+struct runResult
+{
+  string solver;
+  string answer;
+  bool all;
+  double millis;
+  long rss;
+  map<string, stat_t> stats;
+};
+
+struct problemResult
+{
+  string arg;
+  string file;
+  string plays;
+  int deals;
+  int live;
+  int trump;
+  int target;
+  vector<runResult> runs;
+};
+
+
+static long PeakRSSKB()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+
+static void Check(
+  const int ret,
+  const char * name)
+{
+  if (ret == RETURN_NO_FAULT)
+    return;
+
+  char line[80];
+  ErrorMessage(ret, line);
+  printf("%s: %s\n", name, line);
+  exit(1);
+}
+
+
+static void HookUpDDS()
+{
+  // jade reaches DDS through a table of entry points, which the
+  // Python module gets from a capsule.
+  static DDS_C_API api;
+  api.pErrorMessage = ErrorMessage;
+  api.pSolveAllBoardsBin = SolveAllBoardsBin;
+  api.pSetRelatedBoards = SetRelatedBoards;
+  dds_api = &api;
+}
+
+
+// ------------------------------------------------------------------
+// Making problems.
+// ------------------------------------------------------------------
+
+static void Shuffle(
+  mt19937& rng,
+  vector<int>& v)
+{
+  // By hand rather than std::shuffle, so that a seed gives the same
+  // problem with any standard library.
+  for (unsigned i = static_cast<unsigned>(v.size()); i > 1; i--)
+    swap(v[i - 1], v[rng() % i]);
+}
+
+
+static hand64_t CardsToHand(
+  const vector<int>& cards,
+  const unsigned from)
+{
+  hand64_t hand = 0;
+  for (unsigned i = from; i < from + 13; i++)
+  {
+    CARD card;
+    card.suit = cards[i] / 13;
+    card.rank = 2 + cards[i] % 13;
+    hand |= card_to_handbit(card);
+  }
+  return hand;
+}
+
+
+static int TricksNS(
+  const PROBLEM& problem,
+  const unsigned did,
+  const STATE& state)
+{
+  // jade's seats and suits go straight into the DDS deal, as in
+  // DDS_LOADER. The state is at the start of a trick.
+  deal dl;
+  set_deal_cards(problem.wests[did] & ~state.played(), J_WEST, dl);
+  set_deal_cards(problem.north & ~state.played(), J_NORTH, dl);
+  set_deal_cards(problem.easts[did] & ~state.played(), J_EAST, dl);
+  set_deal_cards(problem.south & ~state.played(), J_SOUTH, dl);
+  dl.trump = problem.trump;
+  dl.first = state.to_play();
+  for (int k = 0; k < 3; k++)
+  {
+    dl.currentTrickSuit[k] = 0;
+    dl.currentTrickRank[k] = 0;
+  }
+
+  futureTricks fut;
+  Check(SolveBoard(dl, -1, 1, 1, &fut, 0), "SolveBoard");
+  const int left = 13 - state.current_trick_num();
+  return state.ns_tricks() +
+    (state.to_play_ns() ? fut.score[0] : left - fut.score[0]);
+}
+
+
+static void RandomTricks(
+  mt19937& rng,
+  const PROBLEM& problem,
+  const int tricks,
+  STATE& state,
+  vector<CARD>& plays)
+{
+  // Random legal cards from the first layout.
+  const hand64_t hands[4] =
+    { problem.wests[0], problem.north, problem.easts[0], problem.south };
+
+  for (int i = 0; i < 4 * tricks; i++)
+  {
+    hand64_t hand = hands[state.to_play()] & ~state.played();
+    if (! state.new_trick() && (hand & suit_bits(state.suit_led())))
+      hand &= suit_bits(state.suit_led());
+
+    vector<CARD> legal;
+    for (HAND_ITR itr(hand); itr.more(); itr.next())
+      legal.push_back(itr.current());
+
+    const CARD card = legal[rng() % legal.size()];
+    plays.push_back(card);
+    state.play(card);
+  }
+}
+
+
+static bool MakeProblem(
+  mt19937& rng,
+  const int deals,
+  const int tricks,
+  PROBLEM& problem,
+  vector<CARD>& plays)
+{
+  vector<int> deck(52);
+  for (int c = 0; c < 52; c++)
+    deck[static_cast<unsigned>(c)] = c;
+  Shuffle(rng, deck);
+
+  problem.north = CardsToHand(deck, 0);
+  problem.south = CardsToHand(deck, 13);
+  problem.trump = static_cast<int>(rng() % 5);
+  problem.wests.assign(1, CardsToHand(deck, 26));
+  problem.easts.assign(1, CardsToHand(deck, 39));
+
+  STATE state(problem.trump);
+  plays.clear();
+  RandomTricks(rng, problem, tricks, state, plays);
+
+  // The other layouts keep the cards that East and West have played,
+  // share out the rest afresh, and must agree with the show-outs.
+  const hand64_t westPlayed = problem.wests[0] & state.played();
+  const hand64_t eastPlayed = problem.easts[0] & state.played();
+  vector<int> pool;
+  for (unsigned i = 26; i < 52; i++)
+  {
+    CARD card;
+    card.suit = deck[i] / 13;
+    card.rank = 2 + deck[i] % 13;
+    if ((card_to_handbit(card) & state.played()) == 0)
+      pool.push_back(deck[i]);
+  }
+  const int westLeft = 13 - handbits_count(westPlayed);
+
+  for (int tries = 0; problem.wests.size() < static_cast<unsigned>(deals);
+      tries++)
+  {
+    if (tries == 100 * deals)
+      return false;
+
+    Shuffle(rng, pool);
+    hand64_t west = westPlayed;
+    for (int i = 0; i < westLeft; i++)
+    {
+      CARD card;
+      card.suit = pool[static_cast<unsigned>(i)] / 13;
+      card.rank = 2 + pool[static_cast<unsigned>(i)] % 13;
+      west |= card_to_handbit(card);
+    }
+    const hand64_t east =
+      ALL_CARDS_BITS & ~(west | problem.north | problem.south);
+    if ((east & eastPlayed) != eastPlayed ||
+        find(problem.wests.begin(), problem.wests.end(), west) !=
+          problem.wests.end())
+      continue;
+
+    problem.wests.push_back(west);
+    problem.easts.push_back(east);
+    INTSET one;
+    one.insert(static_cast<int>(problem.wests.size()) - 1);
+    if (load_from_history(problem, plays, one).second.size() == 0)
+    {
+      problem.wests.pop_back();
+      problem.easts.pop_back();
+    }
+  }
+
+  problem.target = 13;
+  for (unsigned did = 0; did < problem.wests.size(); did++)
+    problem.target = min(problem.target, TricksNS(problem, did, state));
+  return true;
+}
+
+
+static int WriteProblem(
+  const char * fname,
+  const int seed,
+  const int deals,
+  const int tricks)
+{
+  // ANSOLVER keys its TT on the defenders' tricks in three bits, so
+  // the target has to be a contract: seven tricks or more.
+  mt19937 rng(static_cast<unsigned>(seed));
+  PROBLEM problem;
+  vector<CARD> plays;
+  while (! MakeProblem(rng, deals, tricks, problem, plays) ||
+      problem.target < 7)
+    ;
+
+  FILE * fp = fopen(fname, "w");
+  if (fp == NULL)
+  {
+    printf("%s: cannot write\n", fname);
+    return 2;
+  }
+  const string err = problem.write_to_filestream(fp);
+  fclose(fp);
+  if (err != "")
+  {
+    printf("%s: %s\n", fname, err.c_str());
+    return 2;
+  }
+
+  printf("%s%s", fname, plays.empty() ? "" : ":");
+  for (auto& card : plays)
+    printf("%s", card_to_string(card).c_str());
+  printf("\n");
+  return 0;
+}
+
+
+// ------------------------------------------------------------------
+// Running them.
+// ------------------------------------------------------------------
+
+static bool ParsePlays(
+  const string& text,
+  vector<CARD>& plays)
+{
+  if (text.size() % 2)
+  {
+    printf("%s: odd number of characters in the plays\n", text.c_str());
+    return false;
+  }
+
+  for (unsigned i = 0; i < text.size(); i += 2)
+  {
+    CARD card;
+    if (! parse_card(text.c_str() + i, card))
+      return false;
+    plays.push_back(card);
+  }
+  return true;
+}
+
+
+static double Millis(
+  chrono::steady_clock::time_point t0,
+  chrono::steady_clock::time_point t1)
+{
+  return chrono::duration<double, milli>(t1 - t0).count();
+}
+
+
+static runResult RunANSolver(
+  const PROBLEM& problem,
+  const vector<CARD>& plays)
+{
+  runResult rr;
+  rr.solver = "an";
+
+  ANSOLVER an(problem);
+  auto t0 = chrono::steady_clock::now();
+  rr.all = an.eval(plays);
+  rr.millis = Millis(t0, chrono::steady_clock::now());
+
+  rr.answer = (rr.all ? "all" : "not all");
+  rr.stats = an.get_stats();
+  rr.rss = PeakRSSKB();
+  return rr;
+}
+
+
+static runResult RunSolver(
+  const PROBLEM& problem,
+  const vector<CARD>& plays,
+  const int live)
+{
+  runResult rr;
+  rr.solver = "bdt";
+
+  SOLVER sv(problem);
+  auto t0 = chrono::steady_clock::now();
+  const bdt_t out = sv.eval(plays);
+  rr.millis = Millis(t0, chrono::steady_clock::now());
+
+  // The number of maximal sets of deals, and the size of the largest,
+  // which is the most deals that any one line beats.
+  const vector<INTSET> cubes = sv.bdt_mgr().get_cubes(out);
+  size_t best = 0;
+  for (auto& c : cubes)
+    best = max(best, c.size());
+  rr.answer = to_string(cubes.size()) + " sets, best " + to_string(best);
+  rr.all = (best == static_cast<size_t>(live));
+
+  rr.stats = sv.get_stats();
+  rr.rss = PeakRSSKB();
+  return rr;
+}
+
+
+static bool RunProblem(
+  const char * arg,
+  const bool runAN,
+  const bool runBDT,
+  problemResult& pr)
+{
+  pr.arg = arg;
+  pr.file = arg;
+  const size_t colon = pr.file.rfind(':');
+  if (colon != string::npos)
+  {
+    pr.plays = pr.file.substr(colon + 1);
+    pr.file = pr.file.substr(0, colon);
+  }
+
+  vector<CARD> plays;
+  if (! ParsePlays(pr.plays, plays))
+    return false;
+
+  FILE * fp = fopen(pr.file.c_str(), "r");
+  if (fp == NULL)
+  {
+    printf("%s: cannot open\n", pr.file.c_str());
+    return false;
+  }
+  PROBLEM problem;
+  const string err = problem.read_from_filestream(fp);
+  fclose(fp);
+  if (err != "")
+  {
+    printf("%s: %s\n", pr.file.c_str(), err.c_str());
+    return false;
+  }
+
+  pr.deals = static_cast<int>(problem.wests.size());
+  pr.live = static_cast<int>(load_from_history(problem, plays).second.size());
+  pr.trump = problem.trump;
+  pr.target = problem.target;
+
+  if (runAN)
+    pr.runs.push_back(RunANSolver(problem, plays));
+  if (runBDT)
+    pr.runs.push_back(RunSolver(problem, plays, pr.live));
+
+  // One line beats all the live deals for both solvers, or for neither.
+  if (pr.runs.size() == 2 && pr.runs[0].all != pr.runs[1].all)
+  {
+    printf("%s: the solvers disagree\n", arg);
+    exit(1);
+  }
+  return true;
+}
+
+
+// ------------------------------------------------------------------
+// Reports.
+// ------------------------------------------------------------------
+
+static void PrintTable(
+  const vector<problemResult>& results)
+{
+  for (auto& pr : results)
+  {
+    printf("%s\n", pr.arg.c_str());
+    printf("  deals %d, live %d, trump %d, target %d\n",
+      pr.deals, pr.live, pr.trump, pr.target);
+    for (auto& rr : pr.runs)
+    {
+      printf("  %-4s %-18s %10.1f ms %9ld KB peak RSS\n",
+        rr.solver.c_str(), rr.answer.c_str(), rr.millis, rr.rss);
+      for (auto& st : rr.stats)
+        printf("       %-20s %12lu\n", st.first.c_str(), st.second);
+    }
+    printf("\n");
+  }
+}
+
+
+static void PrintJSON(
+  const vector<problemResult>& results)
+{
+  printf("{\"problems\": [");
+  for (unsigned i = 0; i < results.size(); i++)
+  {
+    const problemResult& pr = results[i];
+    printf("%s\n  {\"file\": \"%s\", \"plays\": \"%s\", \"deals\": %d, "
+      "\"live\": %d, \"trump\": %d, \"target\": %d, \"runs\": [",
+      i ? "," : "", pr.file.c_str(), pr.plays.c_str(), pr.deals,
+      pr.live, pr.trump, pr.target);
+    for (unsigned j = 0; j < pr.runs.size(); j++)
+    {
+      const runResult& rr = pr.runs[j];
+      printf("%s\n    {\"solver\": \"%s\", \"answer\": \"%s\", "
+        "\"ms\": %.3f, \"peak_rss_kb\": %ld, \"stats\": {",
+        j ? "," : "", rr.solver.c_str(), rr.answer.c_str(),
+        rr.millis, rr.rss);
+      bool first = true;
+      for (auto& st : rr.stats)
+      {
+        printf("%s\"%s\": %lu", first ? "" : ", ",
+          st.first.c_str(), st.second);
+        first = false;
+      }
+      printf("}}");
+    }
+    printf("]}");
+  }
+  printf("\n]}\n");
+}
+
+
+int main(int argc, char * argv[])
+{
+  bool json = false;
+  bool runAN = true, runBDT = true;
+  vector<const char *> args;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--json") == 0)
+      json = true;
+    else if (strcmp(argv[i], "--write") == 0)
+    {
+      if (i + 3 >= argc)
+        return 2;
+      return WriteProblem(argv[i + 1], atoi(argv[i + 2]),
+        atoi(argv[i + 3]), (i + 4 < argc ? atoi(argv[i + 4]) : 0));
+    }
+    else if (strcmp(argv[i], "--solver") == 0 && i + 1 < argc)
+    {
+      runAN = (strcmp(argv[i + 1], "an") == 0);
+      runBDT = (strcmp(argv[i + 1], "bdt") == 0);
+      i++;
+    }
+    else
+      args.push_back(argv[i]);
+  }
+  if (args.empty() || (! runAN && ! runBDT))
+  {
+    printf("usage: jade_bench [--json] [--solver an|bdt] "
+      "problem[:plays] ...\n");
+    return 2;
+  }
+
+  HookUpDDS();
+
+  vector<problemResult> results;
+  for (const char * arg : args)
+  {
+    problemResult pr;
+    if (! RunProblem(arg, runAN, runBDT, pr))
+      return 2;
+    results.push_back(pr);
+  }
+
+  if (json)
+    PrintJSON(results);
+  else
+    PrintTable(results);
+  return 0;
+}
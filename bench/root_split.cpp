@@ -0,0 +1,234 @@
+/*
+   Single-board latency of SolveBoardSplit, which solves the moves
+   at the root of one board on the DDS threads in parallel, against
+   SolveBoard with solutions 3 on one thread.
+
+   Random deals with a given number of cards per hand, on lead. For
+   every thread count that SetResources gives, the time per board of
+   both solvers, and the answers are checked card by card, both for
+   solutions 3 and for solutions 2 with a target.
+
+   SetResources never gives more threads than there are cores, so
+   the timings only go as far as the machine. For more threads, the
+   "proj" column estimates the latency from the time of each root
+   move solved on its own: the moves are shared out longest first,
+   and the busiest thread sets the time.
+
+   Build from the top of the repository:
+
+     g++ -O2 -std=c++11 -DDDS_THREADS_STL -Idds bench/root_split.cpp \
+       $(find dds -name '*.cpp' ! -name Python.cpp) -lpthread -o root_split
+
+     ./root_split [boards] [cards] [threads]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "dll.h"
+
+using namespace std;
+
+
+static void RandomDeal(
+  mt19937& rng,
+  const int cards,
+  deal& dl)
+{
+  vector<int> deck(52);
+  for (int c = 0; c < 52; c++)
+    deck[static_cast<unsigned>(c)] = c;
+  shuffle(deck.begin(), deck.end(), rng);
+
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      dl.remainCards[h][s] = 0;
+
+  for (int i = 0; i < DDS_HANDS * cards; i++)
+  {
+    const int c = deck[static_cast<unsigned>(i)];
+    dl.remainCards[i / cards][c / 13] |= 4u << (c % 13);
+  }
+
+  dl.trump = static_cast<int>(rng() % 5);
+  dl.first = static_cast<int>(rng() % 4);
+  for (int k = 0; k < 3; k++)
+  {
+    dl.currentTrickSuit[k] = 0;
+    dl.currentTrickRank[k] = 0;
+  }
+}
+
+
+static map<int, int> Expand(
+  const futureTricks& fut)
+{
+  // Card (16 * suit + rank) to score, with the equal cards filled in.
+  map<int, int> m;
+  for (int i = 0; i < fut.cards; i++)
+  {
+    m[16 * fut.suit[i] + fut.rank[i]] = fut.score[i];
+    for (int r = 2; r <= 14; r++)
+      if (fut.equals[i] & (1 << r))
+        m[16 * fut.suit[i] + r] = fut.score[i];
+  }
+  return m;
+}
+
+
+static void Check(
+  const int ret,
+  const char * name)
+{
+  if (ret == RETURN_NO_FAULT)
+    return;
+
+  char line[80];
+  ErrorMessage(ret, line);
+  printf("%s: %s\n", name, line);
+  exit(1);
+}
+
+
+static double Micros(
+  chrono::steady_clock::time_point t0,
+  chrono::steady_clock::time_point t1)
+{
+  return chrono::duration<double, micro>(t1 - t0).count();
+}
+
+
+static double Projected(
+  vector<double> times,
+  const int threads)
+{
+  sort(times.begin(), times.end(), greater<double>());
+  vector<double> load(static_cast<unsigned>(threads), 0.);
+  for (double t : times)
+    * min_element(load.begin(), load.end()) += t;
+  return * max_element(load.begin(), load.end());
+}
+
+
+static void Flush(
+  const deal& other,
+  const int threads)
+{
+  // A deal with nothing in common clears the TT of each thread, so
+  // that no solve gets a head start from the one before.
+  futureTricks fut;
+  for (int t = 0; t < threads; t++)
+    Check(SolveBoard(other, 0, 1, 1, &fut, t), "SolveBoard");
+}
+
+
+static vector<double> MoveTimes(
+  const deal& dl,
+  const futureTricks& fut,
+  const deal& other)
+{
+  // The leader's moves, each solved on its own from an empty TT.
+  vector<double> times;
+  futureTricks cf;
+  for (int i = 0; i < fut.cards; i++)
+  {
+    Flush(other, 1);
+    deal child = dl;
+    child.remainCards[dl.first][fut.suit[i]] &= ~(1u << fut.rank[i]);
+    child.currentTrickSuit[0] = fut.suit[i];
+    child.currentTrickRank[0] = fut.rank[i];
+
+    auto t0 = chrono::steady_clock::now();
+    Check(SolveBoard(child, -1, 1, 1, &cf, 0), "SolveBoard");
+    times.push_back(Micros(t0, chrono::steady_clock::now()));
+  }
+  return times;
+}
+
+
+int main(int argc, char * argv[])
+{
+  const int count = (argc > 1 ? atoi(argv[1]) : 20);
+  const int cards = (argc > 2 ? atoi(argv[2]) : 9);
+  const int maxThreads = (argc > 3 ? atoi(argv[3]) : 8);
+
+  mt19937 rng(1);
+  vector<deal> deals(static_cast<unsigned>(count));
+  for (auto& dl : deals)
+    RandomDeal(rng, cards, dl);
+
+  // Each hand a whole suit, so it is unlike any of the deals.
+  deal other;
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      other.remainCards[h][s] = (h == s ? 0x7ffc : 0);
+  other.trump = 4;
+  other.first = 0;
+  for (int k = 0; k < 3; k++)
+  {
+    other.currentTrickSuit[k] = 0;
+    other.currentTrickRank[k] = 0;
+  }
+
+  printf("%d boards, %d cards per hand\n", count, cards);
+  printf("%7s %7s %12s %12s %12s\n",
+    "threads", "actual", "serial ms", "split ms", "proj ms");
+
+  int lastActual = 0;
+  for (int k = 1; k <= maxThreads; k++)
+  {
+    SetResources(0, k);
+    DDSInfo info;
+    GetDDSInfo(&info);
+
+    double serial = 0., split = 0., proj = 0.;
+    for (auto& dl : deals)
+    {
+      futureTricks fs, fp;
+
+      Flush(other, info.noOfThreads);
+      auto t0 = chrono::steady_clock::now();
+      Check(SolveBoard(dl, -1, 3, 1, &fs, 0), "SolveBoard");
+      serial += Micros(t0, chrono::steady_clock::now());
+
+      Flush(other, info.noOfThreads);
+      t0 = chrono::steady_clock::now();
+      Check(SolveBoardSplit(dl, -1, 3, 1, &fp), "SolveBoardSplit");
+      split += Micros(t0, chrono::steady_clock::now());
+
+      proj += Projected(MoveTimes(dl, fs, other), k);
+
+      const map<int, int> ms = Expand(fs);
+      if (ms != Expand(fp))
+      {
+        printf("solutions 3: split and serial differ\n");
+        return 1;
+      }
+
+      // Solutions 2 with a target: the cards that reach it.
+      const int target = max(1, fs.score[0] - static_cast<int>(rng() % 2));
+      Check(SolveBoard(dl, target, 2, 1, &fs, 0), "SolveBoard");
+      Check(SolveBoardSplit(dl, target, 2, 1, &fp), "SolveBoardSplit");
+      if (Expand(fs) != Expand(fp))
+      {
+        printf("target %d: split and serial differ\n", target);
+        return 1;
+      }
+    }
+
+    if (info.noOfThreads == lastActual)
+      printf("%7d %7s %12s %12s %12.2f\n", k, "-", "-", "-",
+        proj / 1000. / count);
+    else
+      printf("%7d %7d %12.2f %12.2f %12.2f\n", k, info.noOfThreads,
+        serial / 1000. / count, split / 1000. / count,
+        proj / 1000. / count);
+    lastActual = info.noOfThreads;
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+/*
+   Micro-benchmark for the card lookup in the large DDS transposition
+   table, on the hit path and on the miss path, for each block scan
+   the build and CPU support.
+
+   One suit distribution gets a block of "fill" entries, each stored
+   with all its cards relevant. A hit looks up the cards of a random
+   stored entry, and a miss looks up random cards that match none.
+   The time includes the lookup of the distribution, which is the
+   same for every scan.
+
+   Build from the top of the repository:
+
+     g++ -O2 -std=c++11 -DDDS_THREADS_STL -Idds bench/tt_lookup.cpp \
+       $(find dds -name '*.cpp' ! -name Python.cpp) -lpthread -o tt_lookup
+
+     ./tt_lookup [lookups]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "dll.h"
+#include "TransTableL.h"
+
+using namespace std;
+
+
+static const int TRICK = 11;
+static const int HAND = 0;
+static const int DIST[DDS_HANDS] = { 0x0343, 0x0433, 0x0334, 0x0343 };
+
+static const char * levelNames[] = { "scalar", "sse2", "avx2" };
+
+
+static void RandomCards(
+  mt19937& rng,
+  unsigned short cards[DDS_SUITS])
+{
+  for (int s = 0; s < DDS_SUITS; s++)
+    cards[s] = static_cast<unsigned short>(rng() & 0x1fff);
+}
+
+
+static double TimeLookups(
+  TransTableL * tt,
+  const vector<unsigned short>& queries,
+  const int lookups,
+  int& found)
+{
+  const int nq = static_cast<int>(queries.size()) / DDS_SUITS;
+  bool lowerFlag;
+  found = 0;
+
+  auto t0 = chrono::steady_clock::now();
+  for (int i = 0; i < lookups; i++)
+  {
+    const unsigned short * q = &queries[(i % nq) * DDS_SUITS];
+    if (tt->Lookup(TRICK, HAND, q, DIST, 4, lowerFlag))
+      found++;
+  }
+  auto t1 = chrono::steady_clock::now();
+
+  return chrono::duration<double, nano>(t1 - t0).count() / lookups;
+}
+
+
+int main(int argc, char * argv[])
+{
+  const int lookups = (argc > 1 ? atoi(argv[1]) : 2000000);
+
+  // Sets up the global tables that the TT constructor needs.
+  SetMaxThreads(0);
+
+  int handLookup[DDS_SUITS][15];
+  for (int s = 0; s < DDS_SUITS; s++)
+    for (int r = 0; r < 15; r++)
+      handLookup[s][r] = (r + s) % DDS_HANDS;
+
+  const int best = TransTableL::SetScanLevel(TT_SCAN_AUTO);
+  const int fills[] = { 8, 32, BLOCKS_PER_ENTRY };
+
+  printf("%-7s %5s %12s %12s\n", "scan", "fill", "hit ns", "miss ns");
+
+  for (int fill : fills)
+  {
+    TransTableL * tt = new TransTableL;
+    tt->SetMemoryDefault(THREADMEM_SMALL_DEF_MB);
+    tt->SetMemoryMaximum(THREADMEM_SMALL_MAX_MB);
+    tt->MakeTT();
+    tt->Init(handLookup);
+    tt->ResetMemory(TT_RESET_NEW_DEAL);
+
+    mt19937 rng(static_cast<unsigned>(fill));
+    vector<unsigned short> hits, misses;
+    unsigned short cards[DDS_SUITS];
+    bool lowerFlag;
+
+    // A Lookup creates the block that the Adds then fill.
+    tt->Lookup(TRICK, HAND, cards, DIST, 4, lowerFlag);
+
+    nodeCardsType node = { 5, 5, 0, 0, { 0, 0, 0, 0 } };
+    for (int i = 0; i < fill; i++)
+    {
+      RandomCards(rng, cards);
+      tt->Add(TRICK, HAND, cards, cards, node, false);
+      hits.insert(hits.end(), cards, cards + DDS_SUITS);
+    }
+
+    while (misses.size() < hits.size())
+    {
+      RandomCards(rng, cards);
+      if (! tt->Lookup(TRICK, HAND, cards, DIST, 4, lowerFlag))
+        misses.insert(misses.end(), cards, cards + DDS_SUITS);
+    }
+
+    for (int level = TT_SCAN_SCALAR; level <= best; level++)
+    {
+      TransTableL::SetScanLevel(level);
+
+      int hitsFound, missesFound;
+      const double hitNs = TimeLookups(tt, hits, lookups, hitsFound);
+      const double missNs = TimeLookups(tt, misses, lookups, missesFound);
+
+      if (hitsFound != lookups || missesFound != 0)
+      {
+        printf("%s: wrong answers (%d hits, %d misses found)\n",
+          levelNames[level], hitsFound, missesFound);
+        return 1;
+      }
+
+      printf("%-7s %5d %12.1f %12.1f\n",
+        levelNames[level], fill, hitNs, missNs);
+    }
+
+    delete tt;
+  }
+
+  TransTableL::SetScanLevel(TT_SCAN_AUTO);
+  return 0;
+}
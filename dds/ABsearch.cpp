@@ -8,7 +8,9 @@
 */
 
 #include <iostream>
+#include <climits>
 #include <sstream>
+#include <cstring>
 #include <assert.h>
 
 #include "TransTable.h"
@@ -58,8 +60,213 @@ void Undo3(
 
 const int handDelta[DDS_SUITS] = { 256, 16, 1, 0 };
 
+// With a time limit, the search looks at the clock every so many
+// trick nodes, which is well under a millisecond.
+const int LIMIT_CLOCK_NODES = 1024;
 
-bool ABsearch(
+
+// The strain and the node type that an alpha-beta function below is
+// compiled for. AB_ANY looks them up at run time on every node,
+// which is the plain search that ABsearch() and the others run.
+// MAXNODE and MINNODE are the node types.
+
+#define AB_ANY -1
+#define AB_NT 0
+#define AB_TRUMP 1
+
+static bool specializedSearch = true;
+
+template <int strain, int node>
+static bool ABsearchT(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp);
+
+template <int strain, int node>
+static bool ABsearch0T(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp);
+
+template <int strain, int node>
+static bool ABsearch1T(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp);
+
+template <int strain, int node>
+static bool ABsearch2T(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp);
+
+template <int strain, int node>
+static bool ABsearch3T(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp);
+
+
+template <int node>
+static inline bool IsMaxNode(
+  ThreadData const * thrp,
+  const int hand)
+{
+  return (node == AB_ANY ?
+    thrp->nodeTypeStore[hand] == MAXNODE : node == MAXNODE);
+}
+
+
+template <int strain>
+static inline int StrainTrump(
+  ThreadData const * thrp)
+{
+  return (strain == AB_NT ? DDS_NOTRUMP : thrp->trump);
+}
+
+
+// The next hand in the trick is on the other side.
+static constexpr int OtherNode(const int node)
+{
+  return (node == AB_ANY ? AB_ANY :
+    (node == MAXNODE ? MINNODE : MAXNODE));
+}
+
+
+// Define DDS_POS_BITBOARD to treat each hand, the aggregate and
+// each depth's win ranks in pos as one 64-bit word, 16 bits per
+// suit, so that updates covering all four suits are single word
+// operations. The words are read and written with memcpy, and a
+// card's bit is made through the same layout, so neither aliasing
+// nor byte order matters.
+
+#ifdef DDS_POS_BITBOARD
+static_assert(sizeof(unsigned long long) ==
+  DDS_SUITS * sizeof(unsigned short int),
+  "pos words must hold exactly four suits");
+
+static inline unsigned long long LoadWord(
+  unsigned short int const * suits)
+{
+  unsigned long long w;
+  memcpy(&w, suits, sizeof(w));
+  return w;
+}
+
+
+static inline void StoreWord(
+  unsigned short int * suits,
+  const unsigned long long w)
+{
+  memcpy(suits, &w, sizeof(w));
+}
+
+
+static inline unsigned long long CardWord(
+  const int s,
+  const int r)
+{
+  unsigned short int suits[DDS_SUITS] = {0, 0, 0, 0};
+  suits[s] = bitMapRank[r];
+  return LoadWord(suits);
+}
+#endif
+
+
+// The win ranks of all four suits at one depth, set from those
+// one level down.
+
+static inline void ClearWinRanks(
+  pos * posPoint,
+  const int depth)
+{
+#ifdef DDS_POS_BITBOARD
+  StoreWord(posPoint->winRanks[depth], 0);
+#else
+  for (int ss = 0; ss < DDS_SUITS; ss++)
+    posPoint->winRanks[depth][ss] = 0;
+#endif
+}
+
+
+static inline void CopyWinRanks(
+  pos * posPoint,
+  const int depth)
+{
+#ifdef DDS_POS_BITBOARD
+  StoreWord(posPoint->winRanks[depth],
+    LoadWord(posPoint->winRanks[depth - 1]));
+#else
+  for (int ss = 0; ss < DDS_SUITS; ss++)
+    posPoint->winRanks[depth][ss] = posPoint->winRanks[depth - 1][ss];
+#endif
+}
+
+
+static inline void MergeWinRanks(
+  pos * posPoint,
+  const int depth)
+{
+#ifdef DDS_POS_BITBOARD
+  StoreWord(posPoint->winRanks[depth],
+    LoadWord(posPoint->winRanks[depth]) |
+    LoadWord(posPoint->winRanks[depth - 1]));
+#else
+  for (int ss = 0; ss < DDS_SUITS; ss++)
+    posPoint->winRanks[depth][ss] |= posPoint->winRanks[depth - 1][ss];
+#endif
+}
+
+
+// Takes a card from a hand, or gives it back.
+
+static inline void RemoveCard(
+  pos * posPoint,
+  const int h,
+  const int s,
+  const int r)
+{
+#ifdef DDS_POS_BITBOARD
+  const unsigned long long bit = CardWord(s, r);
+  StoreWord(posPoint->rankInSuit[h],
+    LoadWord(posPoint->rankInSuit[h]) ^ bit);
+  StoreWord(posPoint->aggr, LoadWord(posPoint->aggr) ^ bit);
+#else
+  posPoint->rankInSuit[h][s] &= (~bitMapRank[r]);
+  posPoint->aggr[s] ^= bitMapRank[r];
+#endif
+  posPoint->handDist[h] -= handDelta[s];
+  posPoint->length[h][s]--;
+}
+
+
+static inline void RestoreCard(
+  pos * posPoint,
+  const int h,
+  const int s,
+  const int r)
+{
+#ifdef DDS_POS_BITBOARD
+  const unsigned long long bit = CardWord(s, r);
+  StoreWord(posPoint->rankInSuit[h],
+    LoadWord(posPoint->rankInSuit[h]) | bit);
+  StoreWord(posPoint->aggr, LoadWord(posPoint->aggr) | bit);
+#else
+  posPoint->rankInSuit[h][s] |= bitMapRank[r];
+  posPoint->aggr[s] |= bitMapRank[r];
+#endif
+  posPoint->handDist[h] += handDelta[s];
+  posPoint->length[h][s]++;
+}
+
+
+template <int strain, int node>
+static bool ABsearchT(
   pos * posPoint,
   const int target,
   const int depth,
@@ -73,7 +280,7 @@ bool ABsearch(
 
   int hand = posPoint->first[depth];
   int tricks = depth >> 2;
-  bool success = (thrp->nodeTypeStore[hand] == MAXNODE ? true : false);
+  bool success = IsMaxNode<node>(thrp, hand);
   bool value = ! success;
 
 #ifdef DDS_TOP_LEVEL
@@ -94,8 +301,7 @@ bool ABsearch(
 
   TIMER_END(TIMER_NO_MOVEGEN, depth);
 
-  for (int ss = 0; ss < DDS_SUITS; ss++)
-    posPoint->winRanks[depth][ss] = 0;
+  ClearWinRanks(posPoint, depth);
 
   while (1)
   {
@@ -113,7 +319,8 @@ bool ABsearch(
     Make0(posPoint, depth, mply);
 
     TIMER_START(TIMER_NO_AB, depth - 1);
-    value = ABsearch1(posPoint, target, depth - 1, thrp);
+    value = ABsearch1T<strain, OtherNode(node)>(
+      posPoint, target, depth - 1, thrp);
     TIMER_END(TIMER_NO_AB, depth - 1);
 
     TIMER_START(TIMER_NO_UNDO, depth);
@@ -122,9 +329,7 @@ bool ABsearch(
 
     if (value == success) /* A cut-off? */
     {
-      for (int ss = 0; ss < DDS_SUITS; ss++)
-        posPoint->winRanks[depth][ss] =
-          posPoint->winRanks[depth - 1][ss];
+      CopyWinRanks(posPoint, depth);
 
       thrp->bestMove[depth] = * mply;
 #ifdef DDS_MOVES
@@ -132,9 +337,7 @@ bool ABsearch(
 #endif
       goto ABexit;
     }
-    for (int ss = 0; ss < DDS_SUITS; ss++)
-      posPoint->winRanks[depth][ss] |=
-        posPoint->winRanks[depth - 1][ss];
+    MergeWinRanks(posPoint, depth);
 
     TIMER_START(TIMER_NO_NEXTMOVE, depth);
     TIMER_END(TIMER_NO_NEXTMOVE, depth);
@@ -151,7 +354,8 @@ ABexit:
 }
 
 
-bool ABsearch0(
+template <int strain, int node>
+static bool ABsearch0T(
   pos * posPoint,
   const int target,
   const int depth,
@@ -163,7 +367,7 @@ bool ABsearch0(
      the value of the subtree is returned.
      This is a specialized AB function for handRelFirst == 0. */
 
-  int trump = thrp->trump;
+  int trump = StrainTrump<strain>(thrp);
   int hand = posPoint->first[depth];
   int tricks = depth >> 2;
 
@@ -171,8 +375,12 @@ bool ABsearch0(
   thrp->nodes++;
 #endif
 
-  for (int ss = 0; ss < DDS_SUITS; ss++)
-    posPoint->winRanks[depth][ss] = 0;
+  // The value does not matter, as a solve that is cut short
+  // throws away what it was searching for.
+  if (thrp->trickNodes >= thrp->limitNodes && LimitReached(thrp))
+    return false;
+
+  ClearWinRanks(posPoint, depth);
 
   if (depth >= 20)
   {
@@ -193,6 +401,8 @@ bool ABsearch0(
 
     if (cardsP)
     {
+      thrp->ttHits++;
+
 #ifdef DDS_AB_HITS
       DumpRetrieved(thrp->fileRetrieved.GetStream(), 
         * posPoint, cardsP, target, depth);
@@ -215,6 +425,7 @@ bool ABsearch0(
       AB_COUNT(AB_MAIN_LOOKUP, scoreFlag, depth);
       return scoreFlag;
     }
+    thrp->ttMisses++;
   }
 
   if (posPoint->tricksMAX >= target)
@@ -248,7 +459,7 @@ bool ABsearch0(
                             trump, res, * thrp);
   TIMER_END(TIMER_NO_QT, depth);
 
-  if (thrp->nodeTypeStore[hand] == MAXNODE)
+  if (IsMaxNode<node>(thrp, hand))
   {
     if (res)
     {
@@ -305,6 +516,8 @@ bool ABsearch0(
 
     if (cardsP)
     {
+      thrp->ttHits++;
+
 #ifdef DDS_AB_HITS
       DumpRetrieved(thrp->fileRetrieved.GetStream(), 
         * posPoint, * cardsP, target, depth);
@@ -327,9 +540,10 @@ bool ABsearch0(
       AB_COUNT(AB_MAIN_LOOKUP, scoreFlag, depth);
       return scoreFlag;
     }
+    thrp->ttMisses++;
   }
 
-  bool success = (thrp->nodeTypeStore[hand] == MAXNODE ? true : false);
+  bool success = IsMaxNode<node>(thrp, hand);
   bool value = ! success;
 
   TIMER_START(TIMER_NO_MOVEGEN, depth);
@@ -345,8 +559,7 @@ bool ABsearch0(
 
   TIMER_END(TIMER_NO_MOVEGEN, depth);
 
-  for (int ss = 0; ss < DDS_SUITS; ss++)
-    posPoint->winRanks[depth][ss] = 0;
+  ClearWinRanks(posPoint, depth);
 
   while (1)
   {
@@ -364,7 +577,8 @@ bool ABsearch0(
     Make0(posPoint, depth, mply);
 
     TIMER_START(TIMER_NO_AB, depth - 1);
-    value = ABsearch1(posPoint, target, depth - 1, thrp);
+    value = ABsearch1T<strain, OtherNode(node)>(
+      posPoint, target, depth - 1, thrp);
     TIMER_END(TIMER_NO_AB, depth - 1);
 
     TIMER_START(TIMER_NO_UNDO, depth);
@@ -373,9 +587,7 @@ bool ABsearch0(
 
     if (value == success) /* A cut-off? */
     {
-      for (int ss = 0; ss < DDS_SUITS; ss++)
-        posPoint->winRanks[depth][ss] =
-          posPoint->winRanks[depth - 1][ss];
+      CopyWinRanks(posPoint, depth);
 
       thrp->bestMove[depth] = * mply;
 #ifdef DDS_MOVES
@@ -383,9 +595,7 @@ bool ABsearch0(
 #endif
       goto ABexit;
     }
-    for (int ss = 0; ss < DDS_SUITS; ss++)
-      posPoint->winRanks[depth][ss] |=
-        posPoint->winRanks[depth - 1][ss];
+    MergeWinRanks(posPoint, depth);
 
     TIMER_START(TIMER_NO_NEXTMOVE, depth);
     TIMER_END(TIMER_NO_NEXTMOVE, depth);
@@ -427,8 +637,8 @@ ABexit:
   first.bestMoveRank = static_cast<char>(thrp->bestMove[depth].rank);
 
   bool flag =
-    ((thrp->nodeTypeStore[hand] == MAXNODE && value) ||
-     (thrp->nodeTypeStore[hand] == MINNODE && !value))
+    ((IsMaxNode<node>(thrp, hand) && value) ||
+     (! IsMaxNode<node>(thrp, hand) && !value))
     ? true : false;
 
   TIMER_START(TIMER_NO_BUILD, depth);
@@ -451,15 +661,16 @@ ABexit:
 }
 
 
-bool ABsearch1(
+template <int strain, int node>
+static bool ABsearch1T(
   pos * posPoint,
   const int target,
   const int depth,
   ThreadData * thrp)
 {
-  int trump = thrp->trump;
+  int trump = StrainTrump<strain>(thrp);
   int hand = handId(posPoint->first[depth], 1);
-  bool success = (thrp->nodeTypeStore[hand] == MAXNODE ? true : false);
+  bool success = IsMaxNode<node>(thrp, hand);
   bool value = ! success;
   int tricks = (depth + 3) >> 2;
 
@@ -481,14 +692,16 @@ bool ABsearch1(
   for (int ss = 0; ss < DDS_SUITS; ss++)
     thrp->lowestWin[depth][ss] = 0;
 
-  thrp->moves.MoveGen123(tricks, 1, * posPoint);
+  if (strain == AB_ANY)
+    thrp->moves.MoveGen123(tricks, 1, * posPoint);
+  else
+    thrp->moves.MoveGen123<1, strain == AB_NT>(tricks, * posPoint);
   if (depth == thrp->iniDepth)
     thrp->moves.Purge(tricks, 1, thrp->forbiddenMoves);
 
   TIMER_END(TIMER_NO_MOVEGEN, depth);
 
-  for (int ss = 0; ss < DDS_SUITS; ss++)
-    posPoint->winRanks[depth][ss] = 0;
+  ClearWinRanks(posPoint, depth);
 
   while (1)
   {
@@ -506,7 +719,8 @@ bool ABsearch1(
     Make1(posPoint, depth, mply);
 
     TIMER_START(TIMER_NO_AB, depth - 1);
-    value = ABsearch2(posPoint, target, depth - 1, thrp);
+    value = ABsearch2T<strain, OtherNode(node)>(
+      posPoint, target, depth - 1, thrp);
     TIMER_END(TIMER_NO_AB, depth - 1);
 
     TIMER_START(TIMER_NO_UNDO, depth);
@@ -515,9 +729,7 @@ bool ABsearch1(
 
     if (value == success) /* A cut-off? */
     {
-      for (int ss = 0; ss < DDS_SUITS; ss++)
-        posPoint->winRanks[depth][ss] =
-          posPoint->winRanks[depth - 1][ss];
+      CopyWinRanks(posPoint, depth);
 
       thrp->bestMove[depth] = * mply;
 #ifdef DDS_MOVES
@@ -526,9 +738,7 @@ bool ABsearch1(
       goto ABexit;
     }
 
-    for (int ss = 0; ss < DDS_SUITS; ss++)
-      posPoint->winRanks[depth][ss] |=
-        posPoint->winRanks[depth - 1][ss];
+    MergeWinRanks(posPoint, depth);
 
     TIMER_START(TIMER_NO_NEXTMOVE, depth);
     TIMER_END(TIMER_NO_NEXTMOVE, depth);
@@ -540,14 +750,15 @@ ABexit:
 }
 
 
-bool ABsearch2(
+template <int strain, int node>
+static bool ABsearch2T(
   pos * posPoint,
   const int target,
   const int depth,
   ThreadData * thrp)
 {
   int hand = handId(posPoint->first[depth], 2);
-  bool success = (thrp->nodeTypeStore[hand] == MAXNODE ? true : false);
+  bool success = IsMaxNode<node>(thrp, hand);
   bool value = ! success;
   int tricks = (depth + 3) >> 2;
 
@@ -559,14 +770,16 @@ bool ABsearch2(
   for (int ss = 0; ss < DDS_SUITS; ss++)
     thrp->lowestWin[depth][ss] = 0;
 
-  thrp->moves.MoveGen123(tricks, 2, * posPoint);
+  if (strain == AB_ANY)
+    thrp->moves.MoveGen123(tricks, 2, * posPoint);
+  else
+    thrp->moves.MoveGen123<2, strain == AB_NT>(tricks, * posPoint);
   if (depth == thrp->iniDepth)
     thrp->moves.Purge(tricks, 2, thrp->forbiddenMoves);
 
   TIMER_END(TIMER_NO_MOVEGEN, depth);
 
-  for (int ss = 0; ss < DDS_SUITS; ss++)
-    posPoint->winRanks[depth][ss] = 0;
+  ClearWinRanks(posPoint, depth);
 
   while (1)
   {
@@ -585,7 +798,8 @@ bool ABsearch2(
     TIMER_END(TIMER_NO_MAKE, depth);
 
     TIMER_START(TIMER_NO_AB, depth - 1);
-    value = ABsearch3(posPoint, target, depth - 1, thrp);
+    value = ABsearch3T<strain, OtherNode(node)>(
+      posPoint, target, depth - 1, thrp);
     TIMER_END(TIMER_NO_AB, depth - 1);
 
     TIMER_START(TIMER_NO_UNDO, depth);
@@ -595,9 +809,7 @@ bool ABsearch2(
 
     if (value == success) /* A cut-off? */
     {
-      for (int ss = 0; ss < DDS_SUITS; ss++)
-        posPoint->winRanks[depth][ss] =
-          posPoint->winRanks[depth - 1][ss];
+      CopyWinRanks(posPoint, depth);
 
       thrp->bestMove[depth] = * mply;
 #ifdef DDS_MOVES
@@ -606,9 +818,7 @@ bool ABsearch2(
       goto ABexit;
     }
 
-    for (int ss = 0; ss < DDS_SUITS; ss++)
-      posPoint->winRanks[depth][ss] |=
-        posPoint->winRanks[depth - 1][ss];
+    MergeWinRanks(posPoint, depth);
 
     TIMER_START(TIMER_NO_NEXTMOVE, depth);
     TIMER_END(TIMER_NO_NEXTMOVE, depth);
@@ -620,7 +830,8 @@ ABexit:
 }
 
 
-bool ABsearch3(
+template <int strain, int node>
+static bool ABsearch3T(
   pos * posPoint,
   const int target,
   const int depth,
@@ -631,7 +842,7 @@ bool ABsearch3(
   unsigned short int makeWinRank[DDS_SUITS];
 
   int hand = handId(posPoint->first[depth], 3);
-  bool success = (thrp->nodeTypeStore[hand] == MAXNODE ? true : false);
+  bool success = IsMaxNode<node>(thrp, hand);
   bool value = ! success;
 
 #ifdef DDS_TOP_LEVEL
@@ -643,14 +854,16 @@ bool ABsearch3(
     thrp->lowestWin[depth][ss] = 0;
   int tricks = (depth + 3) >> 2;
 
-  thrp->moves.MoveGen123(tricks, 3, * posPoint);
+  if (strain == AB_ANY)
+    thrp->moves.MoveGen123(tricks, 3, * posPoint);
+  else
+    thrp->moves.MoveGen123<3, strain == AB_NT>(tricks, * posPoint);
   if (depth == thrp->iniDepth)
     thrp->moves.Purge(tricks, 3, thrp->forbiddenMoves);
 
   TIMER_END(TIMER_NO_MOVEGEN, depth);
 
-  for (int ss = 0; ss < DDS_SUITS; ss++)
-    posPoint->winRanks[depth][ss] = 0;
+  ClearWinRanks(posPoint, depth);
 
   while (1)
   {
@@ -669,17 +882,27 @@ bool ABsearch3(
 
     thrp->trickNodes++; // As handRelFirst == 0
 
-    if (thrp->nodeTypeStore[posPoint->first[depth - 1]] == MAXNODE)
+    const bool nextMax =
+      (thrp->nodeTypeStore[posPoint->first[depth - 1]] == MAXNODE);
+    if (nextMax)
       posPoint->tricksMAX++;
 
     TIMER_START(TIMER_NO_AB, depth - 1);
-    value = ABsearch0(posPoint, target, depth - 1, thrp);
+    if (node == AB_ANY)
+      value = ABsearch0T<strain, AB_ANY>(
+        posPoint, target, depth - 1, thrp);
+    else if (nextMax)
+      value = ABsearch0T<strain, MAXNODE>(
+        posPoint, target, depth - 1, thrp);
+    else
+      value = ABsearch0T<strain, MINNODE>(
+        posPoint, target, depth - 1, thrp);
     TIMER_END(TIMER_NO_AB, depth - 1);
 
     TIMER_START(TIMER_NO_UNDO, depth);
     Undo0(posPoint, depth, * mply, thrp);
 
-    if (thrp->nodeTypeStore[posPoint->first[depth - 1]] == MAXNODE)
+    if (nextMax)
       posPoint->tricksMAX--;
 
     TIMER_END(TIMER_NO_UNDO, depth);
@@ -710,6 +933,129 @@ ABexit:
 }
 
 
+bool ABsearch(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp)
+{
+  return ABsearchT<AB_ANY, AB_ANY>(posPoint, target, depth, thrp);
+}
+
+
+bool ABsearch0(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp)
+{
+  return ABsearch0T<AB_ANY, AB_ANY>(posPoint, target, depth, thrp);
+}
+
+
+bool ABsearch1(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp)
+{
+  return ABsearch1T<AB_ANY, AB_ANY>(posPoint, target, depth, thrp);
+}
+
+
+bool ABsearch2(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp)
+{
+  return ABsearch2T<AB_ANY, AB_ANY>(posPoint, target, depth, thrp);
+}
+
+
+bool ABsearch3(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp)
+{
+  return ABsearch3T<AB_ANY, AB_ANY>(posPoint, target, depth, thrp);
+}
+
+
+#define AB_ENTRIES(strain, node) \
+  { { ABsearchT<strain, node>, ABsearch1T<strain, node>, \
+      ABsearch2T<strain, node>, ABsearch3T<strain, node> }, \
+    { ABsearch0T<strain, node>, ABsearch1T<strain, node>, \
+      ABsearch2T<strain, node>, ABsearch3T<strain, node> } }
+
+// [strain][node][trace][handRelFirst], with AB_ANY in the last row.
+static const ABsearchType ABentries[2][3][2][DDS_HANDS] =
+{
+  {
+    AB_ENTRIES(AB_NT, MINNODE),
+    AB_ENTRIES(AB_NT, MAXNODE),
+    AB_ENTRIES(AB_ANY, AB_ANY)
+  },
+  {
+    AB_ENTRIES(AB_TRUMP, MINNODE),
+    AB_ENTRIES(AB_TRUMP, MAXNODE),
+    AB_ENTRIES(AB_ANY, AB_ANY)
+  }
+};
+
+
+ABsearchType ABsearchEntry(
+  const int handRelFirst,
+  const bool trace,
+  ThreadData const * thrp)
+{
+  const int strain = (thrp->trump == DDS_NOTRUMP ? 0 : 1);
+  int node = 2;
+  if (specializedSearch)
+  {
+    const pos& tpos = thrp->lookAheadPos;
+    const int hand = handId(tpos.first[thrp->iniDepth], handRelFirst);
+    node = thrp->nodeTypeStore[hand];
+  }
+
+  return ABentries[strain][node][trace ? 1 : 0][handRelFirst];
+}
+
+
+bool SetSpecializedAB(const bool on)
+{
+  const bool old = specializedSearch;
+  specializedSearch = on;
+  return old;
+}
+
+
+bool LimitReached(ThreadData * thrp)
+{
+  if (thrp->limitHit)
+    return true;
+
+  const int nodes = thrp->trickNodes;
+  if ((thrp->nodeLimit > 0 && nodes >= thrp->nodeLimit) ||
+      (thrp->timeLimited && 
+       chrono::steady_clock::now() >= thrp->deadline))
+  {
+    // Every later check comes here and fails at once, so the
+    // search unwinds without looking at any more positions.
+    thrp->limitHit = true;
+    thrp->limitNodes = 0;
+    return true;
+  }
+
+  int next = (thrp->nodeLimit > 0 ? thrp->nodeLimit : INT_MAX);
+  if (thrp->timeLimited && next - nodes > LIMIT_CLOCK_NODES)
+    next = nodes + LIMIT_CLOCK_NODES;
+  thrp->limitNodes = next;
+  return false;
+}
+
+
 void Make0(
   pos * posPoint,
   const int depth,
@@ -723,10 +1069,7 @@ void Make0(
   posPoint->first[depth - 1] = h;
   posPoint->move[depth] = * mply;
 
-  posPoint->rankInSuit[h][s] &= (~bitMapRank[r]);
-  posPoint->aggr[s] ^= bitMapRank[r];
-  posPoint->handDist[h] -= handDelta[s];
-  posPoint->length[h][s]--;
+  RemoveCard(posPoint, h, s, r);
 }
 
 
@@ -743,10 +1086,7 @@ void Make1(
   int s = mply->suit;
   int r = mply->rank;
 
-  posPoint->rankInSuit[h][s] &= (~bitMapRank[r]);
-  posPoint->aggr[s] ^= bitMapRank[r];
-  posPoint->handDist[h] -= handDelta[s];
-  posPoint->length[h][s]--;
+  RemoveCard(posPoint, h, s, r);
 }
 
 
@@ -763,10 +1103,7 @@ void Make2(
   int s = mply->suit;
   int r = mply->rank;
 
-  posPoint->rankInSuit[h][s] &= (~bitMapRank[r]);
-  posPoint->aggr[s] ^= bitMapRank[r];
-  posPoint->handDist[h] -= handDelta[s];
-  posPoint->length[h][s]--;
+  RemoveCard(posPoint, h, s, r);
 }
 
 
@@ -801,10 +1138,7 @@ void Make3(
 
   int r = mply->rank;
   int s = mply->suit;
-  posPoint->rankInSuit[h][s] &= (~bitMapRank[r]);
-  posPoint->aggr[s] ^= bitMapRank[r];
-  posPoint->handDist[h] -= handDelta[s];
-  posPoint->length[h][s]--;
+  RemoveCard(posPoint, h, s, r);
 
   // Changes that we may have to undo.
   WinnersType * wp = &thrp->winners[ (depth + 3) >> 2];
@@ -879,10 +1213,7 @@ void Undo0(
   int s = mply.suit;
   int r = mply.rank;
 
-  posPoint->rankInSuit[h][s] |= bitMapRank[r];
-  posPoint->aggr[s] |= bitMapRank[r];
-  posPoint->handDist[h] += handDelta[s];
-  posPoint->length[h][s]++;
+  RestoreCard(posPoint, h, s, r);
 
   // Changes that we now undo.
   WinnersType const * wp = &thrp->winners[ (depth + 3) >> 2];
@@ -921,10 +1252,7 @@ void Undo1(
   int s = mply.suit;
   int r = mply.rank;
 
-  posPoint->rankInSuit[h][s] |= bitMapRank[r];
-  posPoint->aggr[s] |= bitMapRank[r];
-  posPoint->handDist[h] += handDelta[s];
-  posPoint->length[h][s]++;
+  RestoreCard(posPoint, h, s, r);
 }
 
 
@@ -937,10 +1265,7 @@ void Undo2(
   int s = mply.suit;
   int r = mply.rank;
 
-  posPoint->rankInSuit[h][s] |= bitMapRank[r];
-  posPoint->aggr[s] |= bitMapRank[r];
-  posPoint->handDist[h] += handDelta[s];
-  posPoint->length[h][s]++;
+  RestoreCard(posPoint, h, s, r);
 }
 
 
@@ -953,10 +1278,7 @@ void Undo3(
   int s = mply.suit;
   int r = mply.rank;
 
-  posPoint->rankInSuit[h][s] |= bitMapRank[r];
-  posPoint->aggr[s] |= bitMapRank[r];
-  posPoint->handDist[h] += handDelta[s];
-  posPoint->length[h][s]++;
+  RestoreCard(posPoint, h, s, r);
 }
 
 
@@ -44,6 +44,30 @@ bool ABsearch3(
   const int depth,
   ThreadData * thrp);
 
+typedef bool (* ABsearchType)(
+  pos * posPoint,
+  const int target,
+  const int depth,
+  ThreadData * thrp);
+
+// The search to start a solve with, from hand handRelFirst of the
+// current trick: ABsearch (or ABsearch0 when tracing a play) for
+// hand 0, and ABsearch1-3 for the others. Unless turned off, these
+// are versions compiled for the strain and for the node type of
+// the hand to play, rather than looking them up on every node.
+ABsearchType ABsearchEntry(
+  const int handRelFirst,
+  const bool trace,
+  ThreadData const * thrp);
+
+// Returns the previous setting.
+bool SetSpecializedAB(const bool on);
+
+// Whether the solve has run out of trick nodes or time. Called by
+// the search when trickNodes reaches thrp->limitNodes, which it
+// moves on to the next point at which to look at the clock.
+bool LimitReached(ThreadData * thrp);
+
 void Make0(
   pos * posPoint,
   const int depth,
@@ -14,6 +14,8 @@
 #include "Init.h"
 #include "System.h"
 #include "Scheduler.h"
+#include "ABsearch.h"
+#include "QuickTricks.h"
 #include "ThreadMgr.h"
 #include "debug.h"
 
@@ -143,24 +145,25 @@ void STDCALL SetResources(
   }
   else
   {
-    noOfThreads = thrMax;
-    noOfLargeThreads = 0;
-    noOfSmallThreads = thrMax;
-
-
-    // This piece looks like trouble.  It looks if we have S small, L large
-    // and S+L total, we only initialize memory for the first max(S,L) slots
-    // and everything about that is broken?
-    /*
     // We'll have a mixture with as many large threads as possible.
+    // Memory::Resize makes the large ones first and then adds small
+    // ones up to the total, so the two calls below give L + S slots.
     const double d = static_cast<double>(
           THREADMEM_LARGE_MAX_MB - THREADMEM_SMALL_MAX_MB);
 
     noOfThreads = thrMax;
     noOfLargeThreads = static_cast<int>(
       (memMaxMB - thrMax * THREADMEM_SMALL_MAX_MB) / d);
+    noOfLargeThreads = min(noOfLargeThreads, thrMax);
     noOfSmallThreads = thrMax - noOfLargeThreads;
-    */
+  }
+
+  // Even a tiny budget gets one small thread rather than none.
+  if (noOfThreads < 1)
+  {
+    noOfThreads = 1;
+    noOfLargeThreads = 0;
+    noOfSmallThreads = 1;
   }
 
   sysdep.RegisterParams(noOfThreads, memMaxMB);
@@ -195,6 +198,41 @@ int STDCALL SetThreading(
 }
 
 
+int STDCALL SetRelatedBoards(
+  int on)
+{
+  return scheduler.SetRelated(on != 0) ? 1 : 0;
+}
+
+
+int STDCALL SetWorkStealing(
+  int on)
+{
+  return scheduler.SetStealing(on != 0) ? 1 : 0;
+}
+
+
+int STDCALL SetSchedulerModel(
+  int on)
+{
+  return scheduler.SetModel(on != 0) ? 1 : 0;
+}
+
+
+int STDCALL SetSpecializedSearch(
+  int on)
+{
+  return SetSpecializedAB(on != 0) ? 1 : 0;
+}
+
+
+void STDCALL GetSchedulerStats(
+  schedulerStats * statsp)
+{
+  scheduler.GetStats(statsp);
+}
+
+
 void InitConstants()
 {
   // highestRank[aggr] is the highest absolute rank in the
@@ -355,6 +393,9 @@ void InitConstants()
         topside[topBitNo] & botside[ groupData[ris].rank[g - 1] ];
     }
   }
+
+  // The steps of QuickTricks for each way a suit can lie.
+  InitQuickTricks();
 }
 
 
@@ -469,29 +510,9 @@ void SetDeal(
 
 
 void SetDealTables(
+  const deal& dl,
   ThreadData * thrp)
 {
-  unsigned int topBitRank = 1;
-  unsigned int topBitNo = 2;
-
-  // Initialization of the rel structure is inspired by
-  // a solution given by Thomas Andrews.
-
-  // rel[aggr].absRank[absolute rank][suit].hand is the hand
-  // (N = 0, E = 1 etc.) which holds the absolute rank in
-  // the suit characterized by aggr.
-  // rel[aggr].absRank[absolute rank][suit].rank is the
-  // relative rank of that card.
-
-  for (int s = 0; s < DDS_SUITS; s++)
-  {
-    for (int ord = 1; ord <= 13; ord++)
-    {
-      thrp->rel[0].absRank[ord][s].hand = -1;
-      thrp->rel[0].absRank[ord][s].rank = 0;
-    }
-  }
-
   // handLookup[suit][absolute rank] is the hand (N = 0 etc.)
   // holding the absolute rank in suit.
 
@@ -512,35 +533,142 @@ void SetDealTables(
     }
   }
 
-  thrp->transTable->Init(handLookup);
+  // A solve only ever looks up the tables for subsets of the
+  // cards it starts with, including those already played to the
+  // current trick. A suit needs no work if its cards are among
+  // those the tables were last built for, with the same owners.
+
+  unsigned short cards[DDS_SUITS];
+  for (int s = 0; s < DDS_SUITS; s++)
+    cards[s] = static_cast<unsigned short>(
+      thrp->suit[0][s] | thrp->suit[1][s] |
+      thrp->suit[2][s] | thrp->suit[3][s]);
+
+  for (int k = 0; k < thrp->lookAheadPos.handRelFirst; k++)
+    cards[dl.currentTrickSuit[k]] |= bitMapRank[dl.currentTrickRank[k]];
+
+  unsigned short todo[DDS_SUITS];
+  unsigned subsets = 0;
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    bool same = thrp->dealTablesSet &&
+      (cards[s] & ~thrp->dealTablesCards[s]) == 0;
+    for (int r = 2; same && r <= 14; r++)
+      same = ((cards[s] & bitMapRank[r]) == 0 ||
+        handLookup[s][r] == thrp->dealTablesLookup[s][r]);
+
+    todo[s] = (same ? 0 : cards[s]);
+    if (same)
+      continue;
+
+    subsets += 1u << counttable[cards[s]];
+    thrp->dealTablesCards[s] = cards[s];
+    for (int r = 2; r <= 14; r++)
+      thrp->dealTablesLookup[s][r] = handLookup[s][r];
+  }
+
+  if (subsets == 0)
+    return;
+
+  // Initialization of the rel structure is inspired by
+  // a solution given by Thomas Andrews.
 
-  relRanksType * relp;
-  for (unsigned int aggr = 1; aggr < 8192; aggr++)
+  // rel[aggr].absRank[absolute rank][suit].hand is the hand
+  // (N = 0) holding the "absolute rank" in
+  // the suit characterized by aggr.
+  // rel[aggr].absRank[absolute rank][suit].rank is the
+  // relative rank of that card.
+
+  if (! thrp->dealTablesSet || subsets >= 8192)
   {
-    if (aggr >= (topBitRank << 1))
+    // As many entries as a full build, which is then quicker.
+    thrp->transTable->Init(handLookup);
+    thrp->dealTablesSet = true;
+    for (int s = 0; s < DDS_SUITS; s++)
     {
-      /* Next top bit */
-      topBitRank <<= 1;
-      topBitNo++;
+      thrp->dealTablesCards[s] = 0x1fff;
+      for (int r = 2; r <= 14; r++)
+        thrp->dealTablesLookup[s][r] = handLookup[s][r];
+    }
+
+    for (int s = 0; s < DDS_SUITS; s++)
+    {
+      for (int ord = 1; ord <= 13; ord++)
+      {
+        thrp->rel[0].absRank[ord][s].hand = -1;
+        thrp->rel[0].absRank[ord][s].rank = 0;
+      }
     }
 
-    thrp->rel[aggr] = thrp->rel[aggr ^ topBitRank];
-    relp = &thrp->rel[aggr];
+    unsigned int topBitRank = 1;
+    unsigned int topBitNo = 2;
 
-    int weight = counttable[aggr];
-    for (int c = weight; c >= 2; c--)
+    relRanksType * relp;
+    for (unsigned int aggr = 1; aggr < 8192; aggr++)
     {
+      if (aggr >= (topBitRank << 1))
+      {
+        /* Next top bit */
+        topBitRank <<= 1;
+        topBitNo++;
+      }
+
+      thrp->rel[aggr] = thrp->rel[aggr ^ topBitRank];
+      relp = &thrp->rel[aggr];
+
+      int weight = counttable[aggr];
+      for (int c = weight; c >= 2; c--)
+      {
+        for (int s = 0; s < DDS_SUITS; s++)
+        {
+          relp->absRank[c][s].hand = relp->absRank[c - 1][s].hand;
+          relp->absRank[c][s].rank = relp->absRank[c - 1][s].rank;
+        }
+      }
       for (int s = 0; s < DDS_SUITS; s++)
       {
-        relp->absRank[c][s].hand = relp->absRank[c - 1][s].hand;
-        relp->absRank[c][s].rank = relp->absRank[c - 1][s].rank;
+        relp->absRank[1][s].hand =
+          static_cast<signed char>(handLookup[s][topBitNo]);
+        relp->absRank[1][s].rank = static_cast<char>(topBitNo);
       }
     }
-    for (int s = 0; s < DDS_SUITS; s++)
+    return;
+  }
+
+  thrp->transTable->InitSubsets(handLookup, todo);
+
+  // The same for the subsets of todo[s] only, in increasing
+  // order, so that the entry for aggr without its top card is
+  // always ready.
+
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    const unsigned all = todo[s];
+    if (all == 0)
+      continue;
+
+    for (int ord = 1; ord <= 13; ord++)
+    {
+      thrp->rel[0].absRank[ord][s].hand = -1;
+      thrp->rel[0].absRank[ord][s].rank = 0;
+    }
+
+    for (unsigned aggr = (0u - all) & all; aggr != 0;
+        aggr = (aggr - all) & all)
     {
-      relp->absRank[1][s].hand =
+      const int topBitNo = highestRank[aggr];
+      const relRanksType& prev = thrp->rel[aggr ^ bitMapRank[topBitNo]];
+      relRanksType& cur = thrp->rel[aggr];
+
+      int weight = counttable[aggr];
+      for (int c = 13; c > weight; c--)
+        cur.absRank[c][s] = prev.absRank[c][s];
+      for (int c = weight; c >= 2; c--)
+        cur.absRank[c][s] = prev.absRank[c - 1][s];
+
+      cur.absRank[1][s].hand =
         static_cast<signed char>(handLookup[s][topBitNo]);
-      relp->absRank[1][s].rank = static_cast<char>(topBitNo);
+      cur.absRank[1][s].rank = static_cast<char>(topBitNo);
     }
   }
 }
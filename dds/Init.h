@@ -16,7 +16,9 @@
 
 void SetDeal(ThreadData * thrp);
 
-void SetDealTables(ThreadData * thrp);
+void SetDealTables(
+  const deal& dl,
+  ThreadData * thrp);
 
 void InitWinners(
   const deal& dl,
@@ -11,6 +11,7 @@
 #define DDS_MEMORY_H
 
 #include <vector>
+#include <chrono>
 
 #include "TransTable.h"
 #include "TransTableS.h"
@@ -64,6 +65,7 @@ struct ThreadData
 
   pos lookAheadPos; // Recursive alpha-beta data
   bool analysisFlag;
+  bool relatedDeal; // Set by the scheduler for the next solve only
   unsigned short int lowestWin[50][DDS_SUITS];
   WinnersType winners[13];
   moveType forbiddenMoves[14];
@@ -73,11 +75,33 @@ struct ThreadData
   double memUsed;
   int nodes;
   int trickNodes;
+  int ttHits;
+  int ttMisses;
+
+  // Limits on the current solve, which the batch solvers set around
+  // each board. nodeLimit counts trick nodes, and 0 is no limit. The
+  // search only looks at them once trickNodes reaches limitNodes,
+  // see LimitReached(). When a limit is hit, the search is cut short
+  // and boundLower/boundUpper hold what is known of the tricks.
+  int nodeLimit;
+  bool timeLimited;
+  chrono::steady_clock::time_point deadline;
+  int limitNodes;
+  bool limitHit;
+  int boundLower;
+  int boundUpper;
 
   // Constant for a given hand.
   // 960 KB
   relRanksType rel[8192];
 
+  // The cards in each suit that rel and the TT tables were last
+  // built for, and their owners, so that SetDealTables only redoes
+  // what changes. dealTablesSet is false until the first build.
+  unsigned short dealTablesCards[DDS_SUITS];
+  int dealTablesLookup[DDS_SUITS][15];
+  bool dealTablesSet;
+
   TransTable * transTable;
 
   Moves moves;
@@ -334,6 +334,147 @@ int Moves::MoveGen123(
 }
 
 
+template <int relHand>
+inline void Moves::WeightAlloc123(
+  const int findex,
+  const pos& tpos)
+{
+  // The same choice as WeightList, which findex indexes.
+  switch (findex)
+  {
+    case  4: Moves::WeightAllocNTNotvoid1(tpos); break;
+    case  5: Moves::WeightAllocTrumpNotvoid1(tpos); break;
+    case  6: Moves::WeightAllocNTVoid1(tpos); break;
+    case  7: Moves::WeightAllocTrumpVoid1(tpos); break;
+
+    case  8: Moves::WeightAllocNTNotvoid2(tpos); break;
+    case  9: Moves::WeightAllocTrumpNotvoid2(tpos); break;
+    case 10: Moves::WeightAllocNTVoid2(tpos); break;
+    case 11: Moves::WeightAllocTrumpVoid2(tpos); break;
+
+    case 12:
+    case 13: Moves::WeightAllocCombinedNotvoid3(tpos); break;
+    case 14: Moves::WeightAllocNTVoid3(tpos); break;
+    case 15: Moves::WeightAllocTrumpVoid3(tpos); break;
+  }
+}
+
+
+template <int relHand, bool notrump>
+int Moves::MoveGen123(
+  const int tricks,
+  const pos& tpos)
+{
+  trackp = &track[tricks];
+  leadHand = trackp->leadHand;
+  currHand = handId(leadHand, relHand);
+  currTrick = tricks;
+  leadSuit = track[tricks].leadSuit;
+
+  moveGroupType * mp;
+  int removed, g, rank, seq;
+
+  movePlyType& list = moveList[tricks][relHand];
+  mply = list.move;
+
+  for (int s = 0; s < DDS_SUITS; s++)
+    trackp->lowestWin[relHand][s] = 0;
+  numMoves = 0;
+
+  int findex;
+  const int ftest = ((! notrump) &&
+                     (tpos.winner[trump].rank != 0) ? 1 : 0);
+
+  unsigned short ris = tpos.rankInSuit[currHand][leadSuit];
+
+  if (ris != 0)
+  {
+    mp = &groupData[ris];
+    g = mp->lastGroup;
+    removed = trackp->removedRanks[leadSuit];
+
+    while (g >= 0)
+    {
+      rank = mp->rank[g];
+      seq = mp->sequence[g];
+
+      while (g >= 1 && ((mp->gap[g] & removed) == mp->gap[g]))
+        seq |= mp->fullseq[--g];
+
+      mply[numMoves].sequence = seq;
+      mply[numMoves].suit = leadSuit;
+      mply[numMoves].rank = rank;
+
+      numMoves++;
+      g--;
+    }
+
+    findex = 4 * relHand + ftest;
+#ifdef DDS_MOVES
+    MG_REGISTER(RegisterList[findex], relHand);
+#endif
+
+    list.current = 0;
+    list.last = numMoves - 1;
+    if (numMoves == 1)
+      return numMoves;
+
+    Moves::WeightAlloc123<relHand>(findex, tpos);
+
+    Moves::MergeSort();
+    return numMoves;
+  }
+
+  findex = 4 * relHand + ftest + 2;
+
+#ifdef DDS_MOVES
+  MG_REGISTER(RegisterList[findex], relHand);
+#endif
+
+  for (suit = 0; suit < DDS_SUITS; suit++)
+  {
+    ris = tpos.rankInSuit[currHand][suit];
+    if (ris == 0) continue;
+
+    lastNumMoves = numMoves;
+    mp = &groupData[ris];
+    g = mp->lastGroup;
+    removed = trackp->removedRanks[suit];
+
+    while (g >= 0)
+    {
+      rank = mp->rank[g];
+      seq = mp->sequence[g];
+
+      while (g >= 1 && ((mp->gap[g] & removed) == mp->gap[g]))
+        seq |= mp->fullseq[--g];
+
+      mply[numMoves].sequence = seq;
+      mply[numMoves].suit = suit;
+      mply[numMoves].rank = rank;
+
+      numMoves++;
+      g--;
+    }
+
+    Moves::WeightAlloc123<relHand>(findex, tpos);
+  }
+
+  list.current = 0;
+  list.last = numMoves - 1;
+  if (numMoves != 1)
+    Moves::MergeSort();
+  return numMoves;
+}
+
+template int Moves::MoveGen123<1, false>(const int, const pos&);
+template int Moves::MoveGen123<1, true>(const int, const pos&);
+template int Moves::MoveGen123<2, false>(const int, const pos&);
+template int Moves::MoveGen123<2, true>(const int, const pos&);
+template int Moves::MoveGen123<3, false>(const int, const pos&);
+template int Moves::MoveGen123<3, true>(const int, const pos&);
+
+
 void Moves::WeightAllocTrump0(
   const pos& tpos,
   const moveType& bestMove,
@@ -150,6 +150,11 @@ class Moves
     typedef void (Moves::*WeightPtr)(const pos& tpos);
     WeightPtr WeightList[16];
 
+    template <int relHand>
+    void WeightAlloc123(
+      const int findex,
+      const pos& tpos);
+
     inline bool WinningMove(
       const moveType& mvp1,
       const extCard& mvp2,
@@ -203,6 +208,14 @@ class Moves
       const int relHand,
       const pos& tpos);
 
+    // As above, with relHand and the strain fixed at compile time.
+    // The weight function is called directly instead of through
+    // WeightList, and in notrump the trump tests drop out.
+    template <int relHand, bool notrump>
+    int MoveGen123(
+      const int tricks,
+      const pos& tpos);
+
     int GetLength(
       const int trick,
       const int relHand) const;
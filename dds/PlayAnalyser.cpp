@@ -30,6 +30,7 @@ struct playparamType
   int noOfBoards;
   playTracesBin * plp;
   solvedPlays * solvedp;
+  futureTricks * fullp;
   int error;
 };
 
@@ -265,10 +266,92 @@ int STDCALL AnalysePlayPBN(
 }
 
 
+static int AnalysePlayFull(
+  deal dl,
+  const playTraceBin& play,
+  futureTricks * futp,
+  const int thrId)
+{
+  if (play.number < 0 || play.number > 52)
+    return RETURN_PLAY_FAULT;
+
+  ThreadData * thrp = memory.GetPtr(static_cast<unsigned>(thrId));
+
+  int played = 0;
+  while (played < 3 && dl.currentTrickRank[played] != 0)
+    played++;
+
+  for (int card = 0; card < play.number; card++)
+  {
+    int ret = SolveBoardInternal(thrp, dl, -1, 3, 1, &futp[card]);
+    if (ret != RETURN_NO_FAULT)
+      return ret;
+
+    const int suit = play.suit[card];
+    const int rank = play.rank[card];
+    if (suit < 0 || suit > 3 || rank < 2 || rank > 14)
+      return RETURN_PLAY_FAULT;
+
+    const int hand = (dl.first + played) % DDS_HANDS;
+    const unsigned hold = static_cast<unsigned>(1 << rank);
+    if ((dl.remainCards[hand][suit] & hold) == 0)
+      return RETURN_PLAY_FAULT;
+    dl.remainCards[hand][suit] ^= hold;
+
+    if (played < 3)
+    {
+      dl.currentTrickSuit[played] = suit;
+      dl.currentTrickRank[played] = rank;
+      played++;
+      continue;
+    }
+
+    // The trick is complete, and its winner leads to the next one.
+    int best = 0;
+    for (int p = 1; p <= 2; p++)
+    {
+      const int bs = dl.currentTrickSuit[best];
+      const int br = dl.currentTrickRank[best];
+      const int ps = dl.currentTrickSuit[p];
+      if ((ps == bs && dl.currentTrickRank[p] > br) ||
+          (ps != bs && ps == dl.trump))
+        best = p;
+    }
+
+    const int bs = dl.currentTrickSuit[best];
+    if ((suit == bs && rank > dl.currentTrickRank[best]) ||
+        (suit != bs && suit == dl.trump))
+      best = 3;
+
+    dl.first = (dl.first + best) % DDS_HANDS;
+    for (int p = 0; p <= 2; p++)
+    {
+      dl.currentTrickSuit[p] = 0;
+      dl.currentTrickRank[p] = 0;
+    }
+    played = 0;
+  }
+  return RETURN_NO_FAULT;
+}
+
+
 void PlaySingleCommon(
   const int thrId,
   const int bno)
 {
+  if (traceparam.fullp != nullptr)
+  {
+    int res = AnalysePlayFull(
+      playparam.bop->deals[bno],
+      traceparam.plp->plays[bno],
+      traceparam.fullp + 52 * bno,
+      thrId);
+
+    if (res != RETURN_NO_FAULT)
+      playparam.error = res;
+    return;
+  }
+
   solvedPlay solved;
 
   int res = AnalysePlayBin(
@@ -302,14 +385,12 @@ void PlayChunkCommon(const int thrId)
 }
 
 
-int STDCALL AnalyseAllPlaysBin(
+static int AnalyseAllPlaysCommon(
   boards * bop,
   playTracesBin * plp,
   solvedPlays * solvedp,
-  int chunkSize)
+  futureTricks * fullp)
 {
-  UNUSED(chunkSize);
-
   playparam.error = 0;
 
   if (bop->noOfBoards > MAXNOOFBOARDS)
@@ -323,6 +404,7 @@ int STDCALL AnalyseAllPlaysBin(
   playparam.noOfBoards = bop->noOfBoards;
   traceparam.noOfBoards = bop->noOfBoards;
   traceparam.solvedp = solvedp;
+  traceparam.fullp = fullp;
 
   scheduler.RegisterRun(DDS_RUN_TRACE, * bop, * plp);
   sysdep.RegisterRun(DDS_RUN_TRACE, * bop);
@@ -334,7 +416,8 @@ int STDCALL AnalyseAllPlaysBin(
   if (retRun != RETURN_NO_FAULT)
     return retRun;
 
-  solvedp->noOfBoards = bop->noOfBoards;
+  if (solvedp != nullptr)
+    solvedp->noOfBoards = bop->noOfBoards;
 
 #ifdef DDS_SCHEDULER
   scheduler.PrintTiming();
@@ -347,6 +430,28 @@ int STDCALL AnalyseAllPlaysBin(
 }
 
 
+int STDCALL AnalyseAllPlaysBin(
+  boards * bop,
+  playTracesBin * plp,
+  solvedPlays * solvedp,
+  int chunkSize)
+{
+  UNUSED(chunkSize);
+  return AnalyseAllPlaysCommon(bop, plp, solvedp, nullptr);
+}
+
+
+int STDCALL AnalyseAllPlaysFullBin(
+  boards * bop,
+  playTracesBin * plp,
+  futureTricks * solutions,
+  int chunkSize)
+{
+  UNUSED(chunkSize);
+  return AnalyseAllPlaysCommon(bop, plp, nullptr, solutions);
+}
+
+
 int STDCALL AnalyseAllPlaysPBN(
   boardsPBN * bopPBN,
   playTracesPBN * plpPBN,
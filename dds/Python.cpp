@@ -1,11 +1,38 @@
 #include <Python.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
 #include "dll.h"
+#include "dds.h"
 #include "dds_api.h"
 
 static PyObject* _deal_type = NULL;
 static PyObject* _hand_type = NULL;
 static DDS_C_API _dds_c_api;
 
+// DDS keeps its scheduler, thread memory and settings in globals, so
+// only one call may be inside it at a time.  Calls that release the GIL
+// take dds_mutex straight after Py_BEGIN_ALLOW_THREADS and drop it
+// before taking the GIL back.  Calls that keep the GIL use DDS_LOCK,
+// which lets go of the GIL while it waits, so neither side can hold
+// the one lock while waiting for the other.
+static std::mutex dds_mutex;
+
+class DDS_LOCK
+{
+  public:
+    DDS_LOCK() {
+        if (!dds_mutex.try_lock()) {
+            Py_BEGIN_ALLOW_THREADS
+            dds_mutex.lock();
+            Py_END_ALLOW_THREADS
+        }
+    }
+    ~DDS_LOCK() { dds_mutex.unlock(); }
+};
+
 static PyObject*
 dds_error(int r)
 {
@@ -18,6 +45,51 @@ const char* SUITS = "SHDC";
 const char* RANKS = "23456789TJQKA";
 const char* DIRS = "WNES";
 
+// What DDS reports for each deal of the most recent batch call, over
+// all of its chunks, for dds.solve_bounds() and dds.solve_telemetry().
+struct batch_deal {
+    bool complete;
+    int lower, upper;
+    int nodes, tt_hits, tt_misses, wall_us, thread, mem_kb;
+};
+
+static std::vector<batch_deal> batch_deals;
+static bool batch_telemetry = false;
+
+// Reads the bounds and telemetry of the chunk just solved into out, and
+// returns whether telemetry was on.  Call it holding dds_mutex, and copy
+// into batch_deals only with the GIL held.
+static bool
+fetch_batch_chunk(std::vector<batch_deal>& out)
+{
+    solveBounds bounds;
+    solveTelemetry tel;
+    GetSolveBounds(&bounds);
+    GetSolveTelemetry(&tel);
+
+    for (int i=0 ; i<bounds.noOfBoards ; i++) {
+        batch_deal bd = { bounds.complete[i] != 0,
+            bounds.lower[i], bounds.upper[i], 0, 0, 0, 0, 0, 0 };
+        if (i < tel.noOfBoards) {
+            bd.nodes = tel.nodes[i];
+            bd.tt_hits = tel.ttHits[i];
+            bd.tt_misses = tel.ttMisses[i];
+            bd.wall_us = tel.micros[i];
+            bd.thread = tel.thread[i];
+            bd.mem_kb = tel.memoryKB[i];
+        }
+        out.push_back(bd);
+    }
+    return tel.noOfBoards > 0;
+}
+
+static void
+keep_batch_chunk(const std::vector<batch_deal>& chunk, bool telemetry)
+{
+    batch_deals.insert(batch_deals.end(), chunk.begin(), chunk.end());
+    batch_telemetry = telemetry;
+}
+
 #define RETURN_ASSERT   return PyErr_Format(PyExc_AssertionError, "Horror occured at %s:%d", __FILE__, __LINE__)
 
 
@@ -186,28 +258,14 @@ struct CurrentTrick {
 };
 
 
+//
+// Hand i of "WNES" goes to cards[(i + rotate) % 4]; the solving functions
+// use rotate 0, but DDS tables and par expect North first (rotate 3).
+//
 static PyObject*
-python_objects_to_deal(struct deal& dl, PyObject* py_deal, const char* declarer,
-    const char* strain)
+python_deal_to_cards(unsigned int cards[DDS_HANDS][DDS_SUITS],
+    PyObject* py_deal, int rotate)
 {
-    int dec_dir_id = string_to_dir(declarer);
-    if (dec_dir_id == -1)
-        return PyErr_Format(PyExc_ValueError, "Bad declarer '%s'", declarer);
-
-    int strain_id = string_to_strain(strain);
-    if (strain_id == -1)
-        return PyErr_Format(PyExc_ValueError, "Bad strain '%s'", strain);
-
-    // Now let's turn it into DDS format.
-    dl.trump = strain_id;
-    dl.first = (dec_dir_id + 1) % 4;
-    for (int i=0 ; i<3 ; i++) {
-        dl.currentTrickSuit[i] = 0;
-        dl.currentTrickRank[i] = 0;
-    }
-
-    // Load the cards from py_deal to dl.
-
     for (int hid=0 ; hid<4 ; hid++)
     {
         char attr_name[2];
@@ -218,7 +276,7 @@ python_objects_to_deal(struct deal& dl, PyObject* py_deal, const char* declarer,
 
         for (int sid=0 ; sid<4 ; sid++)
         {
-            dl.remainCards[hid][sid] = 0;
+            cards[(hid + rotate) % DDS_HANDS][sid] = 0;
             snprintf(attr_name, sizeof attr_name, "%c", SUITS[sid]);
             PyObject* ranks = PyObject_GetAttrString(hand, attr_name);
             if (ranks == NULL) {
@@ -240,7 +298,7 @@ python_objects_to_deal(struct deal& dl, PyObject* py_deal, const char* declarer,
                     return PyErr_Format(PyExc_ValueError, "Bad rank '%c'",
                         *pyu);
                 }
-                dl.remainCards[hid][sid] |= r;
+                cards[(hid + rotate) % DDS_HANDS][sid] |= r;
                 pyu++;
             }
             Py_DECREF(ranks);
@@ -253,6 +311,31 @@ python_objects_to_deal(struct deal& dl, PyObject* py_deal, const char* declarer,
 }
 
 
+static PyObject*
+python_objects_to_deal(struct deal& dl, PyObject* py_deal, const char* declarer,
+    const char* strain)
+{
+    int dec_dir_id = string_to_dir(declarer);
+    if (dec_dir_id == -1)
+        return PyErr_Format(PyExc_ValueError, "Bad declarer '%s'", declarer);
+
+    int strain_id = string_to_strain(strain);
+    if (strain_id == -1)
+        return PyErr_Format(PyExc_ValueError, "Bad strain '%s'", strain);
+
+    // Now let's turn it into DDS format.
+    dl.trump = strain_id;
+    dl.first = (dec_dir_id + 1) % 4;
+    for (int i=0 ; i<3 ; i++) {
+        dl.currentTrickSuit[i] = 0;
+        dl.currentTrickRank[i] = 0;
+    }
+
+    // Load the cards from py_deal to dl.
+    return python_deal_to_cards(dl.remainCards, py_deal, 0);
+}
+
+
 static PyObject*
 python_tuple_to_deal(struct deal& dl, PyObject* tuple)
 {
@@ -282,6 +365,7 @@ dds_solve_many_deals(PyObject* self, PyObject* args)
     if (iter == NULL)
         return NULL;
 
+    batch_deals.clear();
     PyObject* out_list = PyList_New(0);
     int num_deals = 0;
     while (true) {
@@ -291,7 +375,17 @@ dds_solve_many_deals(PyObject* self, PyObject* args)
 	    // Time to run a chunk!!
 	    struct solvedBoards solves;
 	    boards.noOfBoards = num_deals;
-	    int ret = SolveAllChunksBin(&boards, &solves, 1);
+	    int ret;
+	    std::vector<batch_deal> chunk;
+	    bool telemetry = false;
+	    {
+		DDS_LOCK lock;
+		ret = SolveAllChunksBin(&boards, &solves, 1);
+		if (ret >= 0)
+		    telemetry = fetch_batch_chunk(chunk);
+	    }
+	    if (ret >= 0)
+		keep_batch_chunk(chunk, telemetry);
 	    if (ret < 0) {
 		if (py_deal != NULL)
 		    Py_DECREF(py_deal);
@@ -299,7 +393,14 @@ dds_solve_many_deals(PyObject* self, PyObject* args)
 	    }
 
 	    for (int i=0 ; i<solves.noOfBoards ; i++) {
-		PyObject* val = PyLong_FromLong(deal_tricks(&boards.deals[i]) - solves.solvedBoard[i].score[0]);
+		const int score = solves.solvedBoard[i].score[0];
+		PyObject* val;
+		if (score < 0) {
+		    // Cut short by dds.set_solve_limits()
+		    Py_INCREF(Py_None);
+		    val = Py_None;
+		} else
+		    val = PyLong_FromLong(deal_tricks(&boards.deals[i]) - score);
 		if (val == NULL) {
 		    if (py_deal != NULL)
 			Py_DECREF(py_deal);
@@ -345,7 +446,11 @@ dds_solve_deal(PyObject* self, PyObject* args)
         return py_ret;
 
     struct futureTricks futs;
-    int ret = SolveBoard(dl, -1, 1, 0, &futs, 0);
+    int ret;
+    {
+        DDS_LOCK lock;
+        ret = SolveBoard(dl, -1, 1, 0, &futs, 0);
+    }
     if (ret < 0)
         return dds_error(ret);
 
@@ -475,6 +580,7 @@ dds_solve_many_plays(PyObject* self, PyObject* args)
     if (py_iter == NULL)
 	return NULL;
 
+    batch_deals.clear();
     PyObject* out_list = PyList_New(0);
     if (out_list == NULL)
 	return NULL;
@@ -494,7 +600,17 @@ dds_solve_many_plays(PyObject* self, PyObject* args)
 	    break;
 
 	struct solvedBoards sb;
-	int ret = SolveAllBoards(&boards, &sb);
+	int ret;
+	std::vector<batch_deal> chunk;
+	bool telemetry = false;
+	{
+	    DDS_LOCK lock;
+	    ret = SolveAllBoards(&boards, &sb);
+	    if (ret >= 0)
+		telemetry = fetch_batch_chunk(chunk);
+	}
+	if (ret >= 0)
+	    keep_batch_chunk(chunk, telemetry);
 	if (ret < 0) {
 	    Py_DECREF(py_iter);
 	    Py_DECREF(out_list);
@@ -576,39 +692,32 @@ dds_solve_many_plays(PyObject* self, PyObject* args)
     return out_list;
 }
 
+//
+// The positions before each card of a play history: pos[k] is the deal
+// with the first k cards played.  Also checks that each card is held by
+// the player whose turn it is, and returns the cards in suits and ranks.
+//
 static PyObject*
-dds_analyze_deal_play(PyObject* self, PyObject* args)
+play_history_positions(const struct deal& start, const char* history,
+    std::vector<struct deal>& pos, std::vector<int>& suits,
+    std::vector<int>& ranks)
 {
-    PyObject* py_deal;
-    const char* declarer_dir;
-    const char* strain;
-    const char* history;
-    if (!PyArg_ParseTuple(args, "O!sss", _deal_type, &py_deal,
-        &declarer_dir, &strain, &history))
-    //
-        return NULL;
-
-    struct deal the_deal;
-    python_objects_to_deal(the_deal, py_deal, declarer_dir, strain);
-
     int historyLen = strlen(history);
     if (historyLen > 104)
         return PyErr_Format(PyExc_ValueError, "Play history too long");
     if (historyLen % 2 != 0)
         return PyErr_Format(PyExc_ValueError, "Play history odd length");
 
+    struct deal the_deal = start;
     int player_id = the_deal.first;
-    int goods[52], bads[52];
-    bool was_good[52];
+    pos.clear();
+    suits.clear();
+    ranks.clear();
 
     for (int i=0 ; i<historyLen ; i+=2)
     {
-        struct futureTricks futs;
-        int ret = SolveBoard(the_deal, -1, 3, 0, &futs, 0);
-        if (ret < 0)
-            return dds_error(ret);
+        pos.push_back(the_deal);
 
-        int best_score = futs.score[0];
         int played_suit = char_to_suit(history[i]);
         if (played_suit == -1)
             return PyErr_Format(PyExc_ValueError, "Bad suit '%c' at position %d of history", history[i], i);
@@ -621,38 +730,8 @@ dds_analyze_deal_play(PyObject* self, PyObject* args)
                 "Card '%c%c' at position %d not in player %c's hand",
                 history[i], history[i+1], i, DIRS[player_id]);
 
-        bool found_played = false;
-        goods[i/2] = 0;
-        bads[i/2] = 0;
-        for (int cc=0 ; cc<futs.cards ; cc++)
-        {
-            bool this_is_played = false;
-            if (played_suit == futs.suit[cc]) {
-                if (played_rank == futs.rank[cc] ||
-                    ((1<<played_rank) & futs.equals[cc]) != 0)
-                {
-                    if (found_played) 
-                        RETURN_ASSERT;
-                    this_is_played = true;
-                    found_played = true;
-                }
-            }
-
-            int n = 1 + bitcount_16(futs.equals[cc]);
-            if (futs.score[cc] == best_score) {
-                goods[i/2] += n;
-                if (this_is_played)
-                    was_good[i/2] = true;
-            } else if (futs.score[cc] < best_score) {
-                bads[i/2] += n;
-                if (this_is_played)
-                    was_good[i/2] = false;
-            } else {
-                RETURN_ASSERT;
-            }
-        }
-        if (!found_played)
-            RETURN_ASSERT;
+        suits.push_back(played_suit);
+        ranks.push_back(played_rank);
 
         /// Prepare the board for the next trick!
         the_deal.remainCards[player_id][played_suit] &= ~(1<<played_rank);
@@ -663,13 +742,13 @@ dds_analyze_deal_play(PyObject* self, PyObject* args)
             the_deal.currentTrickRank[cit-1] = played_rank;
             player_id = (player_id+1)%4;
         } else {
-            int i0 = i - 6;
+            int i0 = i/2 - 3;
             int best_j = 0;
-            int best_suit = char_to_suit(history[i0]);
-            int best_rank = char_to_rank_number(history[i0+1]);
+            int best_suit = suits[i0];
+            int best_rank = ranks[i0];
             for (int j=1 ; j<4 ; j++) {
-                int suit = char_to_suit(history[i0+j*2]);
-                int rank = char_to_rank_number(history[i0+j*2+1]);
+                int suit = suits[i0+j];
+                int rank = ranks[i0+j];
 
                 if (suit == best_suit) {
                     if (rank > best_rank) {
@@ -691,13 +770,110 @@ dds_analyze_deal_play(PyObject* self, PyObject* args)
             }
         }
     }
+    return Py_None;
+}
+
+
+//
+// Counts the cards that keep the best result (goods) and those that cost
+// a trick (bads), each of a run of equal cards counting once, and says
+// whether the card played was a good one.  False if the solution does
+// not make sense.
+//
+static bool
+score_play(const struct futureTricks& futs, int played_suit, int played_rank,
+    int& goods, int& bads, bool& was_good)
+{
+    int best_score = futs.score[0];
+    bool found_played = false;
+    goods = 0;
+    bads = 0;
+    for (int cc=0 ; cc<futs.cards ; cc++)
+    {
+        bool this_is_played = false;
+        if (played_suit == futs.suit[cc]) {
+            if (played_rank == futs.rank[cc] ||
+                ((1<<played_rank) & futs.equals[cc]) != 0)
+            {
+                if (found_played)
+                    return false;
+                this_is_played = true;
+                found_played = true;
+            }
+        }
+
+        int n = 1 + bitcount_16(futs.equals[cc]);
+        if (futs.score[cc] == best_score) {
+            goods += n;
+            if (this_is_played)
+                was_good = true;
+        } else if (futs.score[cc] < best_score) {
+            bads += n;
+            if (this_is_played)
+                was_good = false;
+        } else {
+            return false;
+        }
+    }
+    return found_played;
+}
+
+
+static PyObject*
+dds_analyze_deal_play(PyObject* self, PyObject* args)
+{
+    PyObject* py_deal;
+    const char* declarer_dir;
+    const char* strain;
+    const char* history;
+    if (!PyArg_ParseTuple(args, "O!sss", _deal_type, &py_deal,
+        &declarer_dir, &strain, &history))
+    //
+        return NULL;
+
+    struct deal the_deal;
+    if (python_objects_to_deal(the_deal, py_deal, declarer_dir, strain) !=
+        Py_None)
+    {
+        return NULL;
+    }
+
+    std::vector<struct deal> pos;
+    std::vector<int> suits, ranks;
+    if (play_history_positions(the_deal, history, pos, suits, ranks) !=
+        Py_None)
+    {
+        return NULL;
+    }
+
+    int num_plays = (int)pos.size();
+    int goods[52], bads[52];
+    bool was_good[52];
+
+    for (int i=0 ; i<num_plays ; i++)
+    {
+        struct futureTricks futs;
+        int ret;
+        {
+            DDS_LOCK lock;
+            ret = SolveBoard(pos[i], -1, 3, 0, &futs, 0);
+        }
+        if (ret < 0)
+            return dds_error(ret);
+
+        if (!score_play(futs, suits[i], ranks[i], goods[i], bads[i],
+            was_good[i]))
+        {
+            RETURN_ASSERT;
+        }
+    }
 
     // Analysis done!  Prepare the result
-    PyObject* out_list = PyList_New(historyLen/2);
+    PyObject* out_list = PyList_New(num_plays);
     if (out_list == NULL)
         return NULL;
 
-    for (int i=0 ; i<historyLen/2 ; i++) {
+    for (int i=0 ; i<num_plays ; i++) {
         PyObject* py_tupe = Py_BuildValue("iiO", goods[i], bads[i],
             was_good[i] ? Py_True : Py_False);
 
@@ -712,6 +888,115 @@ dds_analyze_deal_play(PyObject* self, PyObject* args)
 }
 
 
+static PyObject*
+dds_analyze_many_plays(PyObject* self, PyObject* args)
+{
+    PyObject* py_list;
+    const char* declarer_dir;
+    const char* strain;
+    const char* history;
+    if (!PyArg_ParseTuple(args, "Osss", &py_list, &declarer_dir, &strain,
+        &history))
+    {
+        return NULL;
+    }
+
+    PyObject* iter = PyObject_GetIter(py_list);
+    if (iter == NULL)
+        return NULL;
+
+    // The starting position of every deal
+    std::vector<struct deal> starts;
+    std::vector<struct deal> pos;
+    std::vector<int> suits, ranks;
+    PyObject* py_deal;
+    while ((py_deal = PyIter_Next(iter)) != NULL) {
+        struct deal the_deal;
+        PyObject* py_ret = Py_None;
+        if (!PyObject_TypeCheck(py_deal, (PyTypeObject*)_deal_type))
+            py_ret = PyErr_Format(PyExc_TypeError,
+                "Expected bridgemoose.Deal objects");
+        else
+            py_ret = python_objects_to_deal(the_deal, py_deal, declarer_dir,
+                strain);
+        if (py_ret == Py_None)
+            py_ret = play_history_positions(the_deal, history, pos, suits,
+                ranks);
+        Py_DECREF(py_deal);
+        if (py_ret != Py_None) {
+            Py_DECREF(iter);
+            return NULL;
+        }
+        starts.push_back(the_deal);
+    }
+    Py_DECREF(iter);
+    if (PyErr_Occurred())
+        return NULL;
+
+    // The deals go through the DDS threads a batch at a time, each deal
+    // played out in order on one thread, so that its TT carries over
+    // from one card to the next.
+    Py_ssize_t num_deals = (Py_ssize_t)starts.size();
+    int num_plays = (int)suits.size();
+    Py_ssize_t num_pos = num_deals * num_plays;
+    std::vector<struct futureTricks> futs(num_deals * 52);
+    int ret = RETURN_NO_FAULT;
+    Py_BEGIN_ALLOW_THREADS
+    dds_mutex.lock();
+    struct boards* boards = new struct boards;
+    struct playTracesBin* traces = new struct playTracesBin;
+    for (int j=0 ; j<MAXNOOFBOARDS ; j++) {
+        traces->plays[j].number = num_plays;
+        for (int i=0 ; i<num_plays ; i++) {
+            traces->plays[j].suit[i] = suits[i];
+            traces->plays[j].rank[i] = ranks[i];
+        }
+    }
+    for (Py_ssize_t start=0 ; start<num_deals && num_plays > 0 && ret >= 0 ;
+        start += MAXNOOFBOARDS)
+    {
+        int n = (int)std::min<Py_ssize_t>(MAXNOOFBOARDS, num_deals - start);
+        for (int j=0 ; j<n ; j++)
+            boards->deals[j] = starts[start + j];
+        boards->noOfBoards = n;
+        traces->noOfBoards = n;
+        ret = AnalyseAllPlaysFullBin(boards, traces, &futs[52 * start], 1);
+    }
+    delete traces;
+    delete boards;
+    dds_mutex.unlock();
+    Py_END_ALLOW_THREADS
+    if (ret < 0)
+        return dds_error(ret);
+
+    // goods, bads and was_good for each play of each deal
+    std::vector<unsigned char> out(num_pos * 3);
+    for (Py_ssize_t k=0 ; k<num_pos ; k++) {
+        int p = (int)(k % num_plays);
+        int goods, bads;
+        bool was_good;
+        if (!score_play(futs[52 * (k / num_plays) + p], suits[p], ranks[p],
+            goods, bads, was_good))
+            RETURN_ASSERT;
+        out[3*k] = (unsigned char)goods;
+        out[3*k+1] = (unsigned char)bads;
+        out[3*k+2] = was_good ? 1 : 0;
+    }
+
+    // As in calc_tables, memoryview cannot take a zero in its shape
+    PyObject* raw = PyBytes_FromStringAndSize(
+        out.empty() ? "" : (const char*)&out[0], out.size());
+    PyObject* view = raw == NULL ? NULL : PyMemoryView_FromObject(raw);
+    Py_XDECREF(raw);
+    if (view == NULL || num_pos == 0)
+        return view;
+    PyObject* shaped = PyObject_CallMethod(view, "cast", "s(nii)", "B",
+        num_deals, num_plays, 3);
+    Py_DECREF(view);
+    return shaped;
+}
+
+
 static PyObject*
 dds_play_menu(PyObject* self, PyObject* args)
 {
@@ -746,7 +1031,11 @@ dds_play_menu(PyObject* self, PyObject* args)
 	return py_err;
 
     struct futureTricks ft;
-    int ret = SolveBoardPBN(board, 0, 2, 0, &ft, 0);
+    int ret;
+    {
+	DDS_LOCK lock;
+	ret = SolveBoardPBN(board, 0, 2, 0, &ft, 0);
+    }
     if (ret < 0)
 	return dds_error(ret);
 
@@ -773,6 +1062,720 @@ dds_play_menu(PyObject* self, PyObject* args)
 }
 
 
+//
+// Card numbers for the packed menus, as in bridgemoose.card.bit_pack:
+// 13 * suit + rank, with clubs 0 and the deuce 0.
+//
+static int packed_card(int dds_suit, int dds_rank)
+{
+    return 13 * (3 - dds_suit) + dds_rank - 2;
+}
+
+
+// Solves each board of the chunk on its own with SolveBoardSplit, which
+// shares its root moves out across the DDS threads, and keeps the exact
+// result of each as its bounds.  Call it holding dds_mutex.
+static int
+solve_split_chunk(struct boardsPBN* boards, struct solvedBoards* solves,
+    std::vector<batch_deal>& out)
+{
+    solves->noOfBoards = boards->noOfBoards;
+    for (int i=0 ; i<boards->noOfBoards ; i++) {
+	struct futureTricks& ft = solves->solvedBoard[i];
+	int ret = SolveBoardSplitPBN(boards->deals[i], boards->target[i],
+	    boards->solutions[i], boards->mode[i], &ft);
+	if (ret < 0)
+	    return ret;
+	int best = ft.cards > 0 ? ft.score[0] : 0;
+	batch_deal bd = { true, best, best, 0, 0, 0, 0, 0, 0 };
+	out.push_back(bd);
+    }
+    return RETURN_NO_FAULT;
+}
+
+
+static PyObject*
+dds_play_menu_many(PyObject* self, PyObject* args)
+{
+    PyObject* py_list;
+    const char* play_dir;
+    const char* strain;
+    const char* trick_so_far;
+    int split = 0;
+
+    if (!PyArg_ParseTuple(args, "Osss|p", &py_list, &play_dir, &strain,
+	&trick_so_far, &split))
+    {
+	return NULL;
+    }
+
+    CurrentTrick ct;
+    PyObject* py_err = ct.from_string(trick_so_far);
+    if (py_err != Py_None)
+	return py_err;
+
+    int play_dir_id = string_to_dir(play_dir);
+    if (play_dir_id == -1)
+        return PyErr_Format(PyExc_ValueError, "Bad play direction '%s'", play_dir);
+
+    int strain_id = string_to_strain(strain);
+    if (strain_id == -1)
+        return PyErr_Format(PyExc_ValueError, "Bad strain '%s'", strain);
+
+    PyObject* py_iter = PyObject_GetIter(py_list);
+    if (py_iter == NULL)
+	return NULL;
+
+    // 52 bytes per deal in each: the tricks for the player on play after
+    // each legal card, and the top card of its run of equals
+    std::vector<unsigned char> tricks, tops;
+    batch_deals.clear();
+    struct boardsPBN* boards = new struct boardsPBN;
+    struct solvedBoards* solves = new struct solvedBoards;
+    while (true)
+    {
+	PyObject* err = NULL;
+	int load_result = load_boards_pbn(py_iter, *boards, ct.suit,
+	    ct.rank, strain_id, (play_dir_id + (4 - ct.nonZero)) % 4, &err);
+	if (load_result < 0) {
+	    delete solves;
+	    delete boards;
+	    return err;
+	}
+	if (boards->noOfBoards == 0)
+	    break;
+
+	int ret;
+	std::vector<batch_deal> chunk;
+	bool telemetry = false;
+	Py_BEGIN_ALLOW_THREADS
+	dds_mutex.lock();
+	if (split)
+	    ret = solve_split_chunk(boards, solves, chunk);
+	else {
+	    ret = SolveAllBoards(boards, solves);
+	    if (ret >= 0)
+		telemetry = fetch_batch_chunk(chunk);
+	}
+	dds_mutex.unlock();
+	Py_END_ALLOW_THREADS
+	if (ret >= 0)
+	    keep_batch_chunk(chunk, telemetry);
+	if (ret < 0) {
+	    Py_DECREF(py_iter);
+	    delete solves;
+	    delete boards;
+	    return dds_error(ret);
+	}
+
+	size_t base = tricks.size();
+	tricks.resize(base + 52 * solves->noOfBoards, 0xff);
+	tops.resize(base + 52 * solves->noOfBoards, 0xff);
+	for (int i=0 ; i<solves->noOfBoards ; i++) {
+	    const struct futureTricks& ft = solves->solvedBoard[i];
+	    unsigned char* tr = &tricks[base + 52 * i];
+	    unsigned char* tp = &tops[base + 52 * i];
+	    for (int cc=0 ; cc<ft.cards ; cc++) {
+		int top = packed_card(ft.suit[cc], ft.rank[cc]);
+		tr[top] = (unsigned char)ft.score[cc];
+		tp[top] = (unsigned char)top;
+		for (int r=0 ; r<13 ; r++) {
+		    if ((4<<r) & ft.equals[cc]) {
+			int c = packed_card(ft.suit[cc], r+2);
+			tr[c] = (unsigned char)ft.score[cc];
+			tp[c] = (unsigned char)top;
+		    }
+		}
+	    }
+	}
+
+	if (load_result == 1)
+	    break;
+    }
+    Py_DECREF(py_iter);
+    delete solves;
+    delete boards;
+    if (PyErr_Occurred())
+	return NULL;
+
+    // Two read-only (deals, 52) memoryviews; as in calc_tables,
+    // memoryview cannot take a zero in its shape, so no deals stays 1-d
+    Py_ssize_t num_deals = tricks.size() / 52;
+    std::vector<unsigned char>* columns[2] = { &tricks, &tops };
+    PyObject* views[2] = { NULL, NULL };
+    for (int k=0 ; k<2 ; k++) {
+	std::vector<unsigned char>& v = *columns[k];
+	PyObject* raw = PyBytes_FromStringAndSize(
+	    v.empty() ? "" : (const char*)&v[0], v.size());
+	PyObject* view = raw == NULL ? NULL : PyMemoryView_FromObject(raw);
+	Py_XDECREF(raw);
+	if (view != NULL && num_deals > 0) {
+	    views[k] = PyObject_CallMethod(view, "cast", "s(ni)", "B",
+		num_deals, 52);
+	    Py_DECREF(view);
+	} else
+	    views[k] = view;
+	if (views[k] == NULL) {
+	    Py_XDECREF(views[0]);
+	    return NULL;
+	}
+    }
+    return Py_BuildValue("NN", views[0], views[1]);
+}
+
+
+// vulnerable in the DDS Par() sense: 0 None, 1 Both, 2 NS, 3 EW
+static int string_to_vul(const char* s)
+{
+    char up[8];
+    int n = 0;
+    for ( ; s[n] && n < 7 ; n++)
+        up[n] = toupper((unsigned char)s[n]);
+    up[n] = '\0';
+    if (s[n])
+        return -1;
+
+    if (!strcmp(up, "") || !strcmp(up, "-") || !strcmp(up, "NONE"))
+        return 0;
+    if (!strcmp(up, "BOTH") || !strcmp(up, "B") || !strcmp(up, "ALL") ||
+        !strcmp(up, "NSEW"))
+        return 1;
+    if (!strcmp(up, "NS"))
+        return 2;
+    if (!strcmp(up, "EW"))
+        return 3;
+    return -1;
+}
+
+
+static PyObject*
+par_to_python(const struct parResultsMaster& pres)
+{
+    const char* seats[6] = { "N", "E", "S", "W", "NS", "EW" };
+    const char* denoms = "NSHDC";
+
+    PyObject* contracts = PyList_New(pres.number);
+    if (contracts == NULL)
+        return NULL;
+    for (int k=0 ; k<pres.number ; k++) {
+        const struct contractType& ct = pres.contracts[k];
+        char text[24];
+        if (ct.seats < 0 || ct.seats > 5 || ct.denom < 0 || ct.denom > 4) {
+            Py_DECREF(contracts);
+            RETURN_ASSERT;
+        }
+        int n = snprintf(text, sizeof text, "%s %d%c", seats[ct.seats],
+            ct.level, denoms[ct.denom]);
+        if (ct.underTricks > 0)
+            snprintf(text + n, sizeof text - n, "x-%d", ct.underTricks);
+        else if (ct.overTricks > 0)
+            snprintf(text + n, sizeof text - n, "+%d", ct.overTricks);
+
+        PyObject* py_text = PyUnicode_FromString(text);
+        if (py_text == NULL) {
+            Py_DECREF(contracts);
+            return NULL;
+        }
+        PyList_SET_ITEM(contracts, k, py_text);
+    }
+    return Py_BuildValue("iN", pres.score, contracts);
+}
+
+
+static PyObject*
+dds_calc_tables(PyObject* self, PyObject* args, PyObject* kwds)
+{
+    static const char* kwlist[] = { "deals", "strains", "par_vul",
+        "par_dealer", NULL };
+    PyObject* py_list;
+    const char* strains = "SHDCN";
+    const char* par_vul = NULL;
+    const char* par_dealer = "N";
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|szs", (char**)kwlist,
+        &py_list, &strains, &par_vul, &par_dealer))
+    {
+        return NULL;
+    }
+
+    int strain_ids[DDS_STRAINS];
+    int trump_filter[DDS_STRAINS] = { 1, 1, 1, 1, 1 };
+    int num_strains = (int)strlen(strains);
+    if (num_strains < 1 || num_strains > DDS_STRAINS)
+        return PyErr_Format(PyExc_ValueError, "Bad strains '%s'", strains);
+    for (int i=0 ; i<num_strains ; i++) {
+        char one[2] = { strains[i], '\0' };
+        strain_ids[i] = string_to_strain(one);
+        if (strain_ids[i] < 0 || !trump_filter[strain_ids[i]])
+            return PyErr_Format(PyExc_ValueError, "Bad strains '%s'", strains);
+        trump_filter[strain_ids[i]] = 0;
+    }
+
+    int vul = -1;
+    int dealer = 0;
+    if (par_vul != NULL) {
+        vul = string_to_vul(par_vul);
+        if (vul < 0)
+            return PyErr_Format(PyExc_ValueError, "Bad vulnerability '%s'",
+                par_vul);
+        if (num_strains != DDS_STRAINS)
+            return PyErr_Format(PyExc_ValueError,
+                "Par needs all five strains");
+        int d = string_to_dir(par_dealer);
+        if (d < 0)
+            return PyErr_Format(PyExc_ValueError, "Bad dealer '%s'",
+                par_dealer);
+        dealer = (d + 3) % DDS_HANDS;
+    }
+
+    PyObject* iter = PyObject_GetIter(py_list);
+    if (iter == NULL)
+        return NULL;
+
+    PyObject* pars = NULL;
+    if (vul >= 0 && (pars = PyList_New(0)) == NULL) {
+        Py_DECREF(iter);
+        return NULL;
+    }
+
+    // CalcAllTables takes at most MAXNOOFTABLES * DDS_STRAINS boards
+    const int chunk = MAXNOOFTABLES * DDS_STRAINS / num_strains;
+    std::vector<unsigned char> tricks;
+    struct ddTableDeals tables;
+    struct ddTablesRes results;
+    struct allParResults unused_pars;
+    bool done = false;
+
+    while (!done) {
+        tables.noOfTables = 0;
+        while (tables.noOfTables < chunk) {
+            PyObject* py_deal = PyIter_Next(iter);
+            if (py_deal == NULL) {
+                done = true;
+                break;
+            }
+            PyObject* py_ret = Py_None;
+            if (!PyObject_TypeCheck(py_deal, (PyTypeObject*)_deal_type))
+                py_ret = PyErr_Format(PyExc_TypeError,
+                    "Expected bridgemoose.Deal objects");
+            else
+                py_ret = python_deal_to_cards(
+                    tables.deals[tables.noOfTables].cards, py_deal, 3);
+            Py_DECREF(py_deal);
+            if (py_ret != Py_None) {
+                Py_DECREF(iter);
+                Py_XDECREF(pars);
+                return NULL;
+            }
+            tables.noOfTables++;
+        }
+        if (PyErr_Occurred()) {
+            Py_DECREF(iter);
+            Py_XDECREF(pars);
+            return NULL;
+        }
+        if (tables.noOfTables == 0)
+            break;
+
+        int ret;
+        Py_BEGIN_ALLOW_THREADS
+        dds_mutex.lock();
+        ret = CalcAllTables(&tables, -1, trump_filter, &results, &unused_pars);
+        dds_mutex.unlock();
+        Py_END_ALLOW_THREADS
+        if (ret != RETURN_NO_FAULT) {
+            Py_DECREF(iter);
+            Py_XDECREF(pars);
+            return dds_error(ret);
+        }
+
+        for (int t=0 ; t<tables.noOfTables ; t++) {
+            for (int i=0 ; i<num_strains ; i++)
+                for (int hid=0 ; hid<DDS_HANDS ; hid++)
+                    tricks.push_back((unsigned char) results.results[t].
+                        resTable[strain_ids[i]][(hid + 3) % DDS_HANDS]);
+
+            if (pars == NULL)
+                continue;
+            struct parResultsMaster pres;
+            {
+                DDS_LOCK lock;
+                ret = DealerParBin(&results.results[t], &pres, dealer, vul);
+            }
+            PyObject* py_par = (ret == RETURN_NO_FAULT) ?
+                par_to_python(pres) : dds_error(ret);
+            if (py_par == NULL || PyList_Append(pars, py_par) < 0) {
+                Py_XDECREF(py_par);
+                Py_DECREF(iter);
+                Py_DECREF(pars);
+                return NULL;
+            }
+            Py_DECREF(py_par);
+        }
+    }
+    Py_DECREF(iter);
+
+    // A read-only (deals, strains, declarers) memoryview over the bytes;
+    // memoryview cannot take a zero in its shape, so no deals stays 1-d
+    Py_ssize_t num_deals = tricks.size() / (num_strains * DDS_HANDS);
+    PyObject* raw = PyBytes_FromStringAndSize(
+        tricks.empty() ? "" : (const char*)&tricks[0], tricks.size());
+    PyObject* view = raw == NULL ? NULL : PyMemoryView_FromObject(raw);
+    Py_XDECREF(raw);
+    PyObject* out = view;
+    if (view != NULL && num_deals > 0) {
+        out = PyObject_CallMethod(view, "cast", "s(nii)", "B", num_deals,
+            num_strains, DDS_HANDS);
+        Py_DECREF(view);
+    }
+    if (out == NULL) {
+        Py_XDECREF(pars);
+        return NULL;
+    }
+
+    if (pars == NULL)
+        return out;
+    return Py_BuildValue("NN", out, pars);
+}
+
+
+//
+// A per-deal column for solve_many_packed: one int for every deal, or a
+// buffer of one byte per deal.
+//
+struct ByteColumn {
+    Py_buffer view;
+    bool has_view;
+    int value;
+
+    ByteColumn() : has_view(false),value(0) {}
+    ~ByteColumn() {
+        if (has_view)
+            PyBuffer_Release(&view);
+    }
+
+    bool load(PyObject* obj, Py_ssize_t n, const char* name, int limit) {
+        if (PyLong_Check(obj)) {
+            value = (int)PyLong_AsLong(obj);
+            if (value == -1 && PyErr_Occurred())
+                return false;
+            if (value < 0 || value >= limit) {
+                PyErr_Format(PyExc_ValueError, "Bad %s %d", name, value);
+                return false;
+            }
+            return true;
+        }
+        if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS) < 0)
+            return false;
+        has_view = true;
+        if (view.itemsize != 1 || view.len != n) {
+            PyErr_Format(PyExc_ValueError,
+                "%s needs one byte for each of %zd deals", name, n);
+            return false;
+        }
+        const unsigned char* p = (const unsigned char*)view.buf;
+        for (Py_ssize_t i=0 ; i<n ; i++) {
+            if (p[i] >= limit) {
+                PyErr_Format(PyExc_ValueError, "Bad %s %d for deal %zd",
+                    name, p[i], i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int operator[](Py_ssize_t i) const {
+        return has_view ? ((const unsigned char*)view.buf)[i] : value;
+    }
+};
+
+
+static PyObject*
+dds_solve_many_packed(PyObject* self, PyObject* args)
+{
+    PyObject* py_hands;
+    PyObject* py_strains;
+    PyObject* py_leaders;
+    PyObject* py_out;
+    if (!PyArg_ParseTuple(args, "OOOO", &py_hands, &py_strains, &py_leaders,
+        &py_out))
+    {
+        return NULL;
+    }
+
+    Py_buffer hands;
+    if (PyObject_GetBuffer(py_hands, &hands, PyBUF_C_CONTIGUOUS) < 0)
+        return NULL;
+    if (hands.itemsize != 8 || hands.len % (8 * DDS_HANDS) != 0) {
+        PyBuffer_Release(&hands);
+        return PyErr_Format(PyExc_ValueError,
+            "hands needs four 64 bit masks per deal");
+    }
+    Py_ssize_t num_deals = hands.len / (8 * DDS_HANDS);
+
+    Py_buffer out;
+    if (PyObject_GetBuffer(py_out, &out, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE)
+        < 0)
+    {
+        PyBuffer_Release(&hands);
+        return NULL;
+    }
+    if (out.itemsize != 1 || out.len != num_deals) {
+        PyBuffer_Release(&out);
+        PyBuffer_Release(&hands);
+        return PyErr_Format(PyExc_ValueError,
+            "out needs one byte for each of %zd deals", num_deals);
+    }
+
+    ByteColumn strains, leaders;
+    if (!strains.load(py_strains, num_deals, "strain", DDS_STRAINS) ||
+        !leaders.load(py_leaders, num_deals, "leader", DDS_HANDS))
+    {
+        PyBuffer_Release(&out);
+        PyBuffer_Release(&hands);
+        return NULL;
+    }
+
+    const uint64_t* masks = (const uint64_t*)hands.buf;
+    for (Py_ssize_t i=0 ; i<num_deals ; i++) {
+        uint64_t seen = 0;
+        for (int h=0 ; h<DDS_HANDS ; h++) {
+            uint64_t m = masks[i * DDS_HANDS + h];
+            if ((m & ~0x7ffc7ffc7ffc7ffcull) || (m & seen)) {
+                PyBuffer_Release(&out);
+                PyBuffer_Release(&hands);
+                return PyErr_Format(PyExc_ValueError,
+                    "Bad or repeated cards in deal %zd", i);
+            }
+            seen |= m;
+        }
+    }
+
+    unsigned char* tricks = (unsigned char*)out.buf;
+    int ret = RETURN_NO_FAULT;
+    std::vector<batch_deal> chunks;
+    bool telemetry = false;
+    batch_deals.clear();
+    Py_BEGIN_ALLOW_THREADS
+    dds_mutex.lock();
+    struct boards* boards = new struct boards;
+    struct solvedBoards* solves = new struct solvedBoards;
+    for (Py_ssize_t start=0 ; start<num_deals && ret >= 0 ;
+        start += MAXNOOFBOARDS)
+    {
+        int n = (int)std::min<Py_ssize_t>(MAXNOOFBOARDS, num_deals - start);
+        for (int j=0 ; j<n ; j++) {
+            struct deal& dl = boards->deals[j];
+            const uint64_t* m = masks + (start + j) * DDS_HANDS;
+            dl.trump = strains[start + j];
+            dl.first = leaders[start + j];
+            for (int k=0 ; k<3 ; k++) {
+                dl.currentTrickSuit[k] = 0;
+                dl.currentTrickRank[k] = 0;
+            }
+            for (int h=0 ; h<DDS_HANDS ; h++)
+                for (int su=0 ; su<DDS_SUITS ; su++)
+                    dl.remainCards[h][su] =
+                        (unsigned int)(m[h] >> (16 * su)) & 0x7ffc;
+            boards->target[j] = -1;
+            boards->solutions[j] = 1;
+            boards->mode[j] = 0;
+        }
+        boards->noOfBoards = n;
+        ret = SolveAllChunksBin(boards, solves, 1);
+        if (ret >= 0)
+            telemetry = fetch_batch_chunk(chunks);
+        for (int j=0 ; ret >= 0 && j<n ; j++)
+            tricks[start + j] = (unsigned char)solves->solvedBoard[j].score[0];
+    }
+    delete solves;
+    delete boards;
+    dds_mutex.unlock();
+    Py_END_ALLOW_THREADS
+    keep_batch_chunk(chunks, telemetry);
+
+    PyBuffer_Release(&out);
+    PyBuffer_Release(&hands);
+    if (ret < 0)
+        return dds_error(ret);
+    return PyLong_FromSsize_t(num_deals);
+}
+
+
+static PyObject*
+dds_set_related_boards(PyObject* self, PyObject* args)
+{
+    int on;
+    if (!PyArg_ParseTuple(args, "p", &on))
+        return NULL;
+    DDS_LOCK lock;
+    return PyBool_FromLong(SetRelatedBoards(on));
+}
+
+
+static PyObject*
+dds_set_work_stealing(PyObject* self, PyObject* args)
+{
+    int on;
+    if (!PyArg_ParseTuple(args, "p", &on))
+        return NULL;
+    DDS_LOCK lock;
+    return PyBool_FromLong(SetWorkStealing(on));
+}
+
+
+static PyObject*
+dds_set_scheduler_model(PyObject* self, PyObject* args)
+{
+    int on;
+    if (!PyArg_ParseTuple(args, "p", &on))
+        return NULL;
+    DDS_LOCK lock;
+    return PyBool_FromLong(SetSchedulerModel(on));
+}
+
+
+static PyObject*
+dds_set_solve_limits(PyObject* self, PyObject* args)
+{
+    int ms = 0, nodes = 0;
+    if (!PyArg_ParseTuple(args, "|ii", &ms, &nodes))
+        return NULL;
+    if (ms < 0 || nodes < 0)
+        return PyErr_Format(PyExc_ValueError,
+            "ms and nodes must not be negative");
+
+    int old_ms, old_nodes;
+    DDS_LOCK lock;
+    GetSolveLimits(&old_ms, &old_nodes);
+    SetSolveLimits(ms, nodes);
+    return Py_BuildValue("(ii)", old_ms, old_nodes);
+}
+
+
+static PyObject*
+dds_solve_bounds(PyObject* self, PyObject* args)
+{
+    DDS_LOCK lock;
+    const Py_ssize_t n = (Py_ssize_t)batch_deals.size();
+    PyObject* out = PyList_New(n);
+    if (out == NULL)
+        return NULL;
+    for (Py_ssize_t i=0 ; i<n ; i++) {
+        const batch_deal& bd = batch_deals[i];
+        PyObject* item = Py_BuildValue("(Oii)",
+            bd.complete ? Py_True : Py_False, bd.lower, bd.upper);
+        if (item == NULL) {
+            Py_DECREF(out);
+            return NULL;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+    return out;
+}
+
+
+static PyObject*
+dds_set_solve_telemetry(PyObject* self, PyObject* args)
+{
+    int on;
+    if (!PyArg_ParseTuple(args, "p", &on))
+        return NULL;
+    DDS_LOCK lock;
+    return PyBool_FromLong(SetSolveTelemetry(on));
+}
+
+
+static PyObject*
+dds_solve_telemetry(PyObject* self, PyObject* args)
+{
+    DDS_LOCK lock;
+    const Py_ssize_t n = batch_telemetry ? (Py_ssize_t)batch_deals.size() : 0;
+    const char* names[] = { "nodes", "tt_hits", "tt_misses", "wall_us",
+        "thread", "mem_kb" };
+    int batch_deal::* fields[] = { &batch_deal::nodes, &batch_deal::tt_hits,
+        &batch_deal::tt_misses, &batch_deal::wall_us, &batch_deal::thread,
+        &batch_deal::mem_kb };
+
+    PyObject* out = PyDict_New();
+    if (out == NULL)
+        return NULL;
+    for (int f=0 ; f<6 ; f++) {
+        PyObject* list = PyList_New(n);
+        if (list == NULL || PyDict_SetItemString(out, names[f], list) < 0) {
+            Py_XDECREF(list);
+            Py_DECREF(out);
+            return NULL;
+        }
+        Py_DECREF(list);
+        for (Py_ssize_t i=0 ; i<n ; i++) {
+            PyObject* val = PyLong_FromLong(batch_deals[i].*fields[f]);
+            if (val == NULL) {
+                Py_DECREF(out);
+                return NULL;
+            }
+            PyList_SET_ITEM(list, i, val);
+        }
+    }
+    return out;
+}
+
+
+static PyObject*
+dds_set_resources(PyObject* self, PyObject* args)
+{
+    int threads = 0, mem_mb = 0;
+    if (!PyArg_ParseTuple(args, "|ii", &threads, &mem_mb))
+        return NULL;
+    if (threads < 0 || mem_mb < 0)
+        return PyErr_Format(PyExc_ValueError,
+            "threads and mem_mb must not be negative");
+
+    DDSInfo info;
+    {
+        DDS_LOCK lock;
+        SetResources(mem_mb, threads);
+        GetDDSInfo(&info);
+    }
+    int small = 0, large = 0;
+    sscanf(info.threadSizes, "%d S, %d L", &small, &large);
+    return Py_BuildValue("{s:i,s:i,s:i,s:i}", "threads", info.noOfThreads,
+        "large_threads", large, "small_threads", small,
+        "tt_max_mb", large * THREADMEM_LARGE_MAX_MB +
+            small * THREADMEM_SMALL_MAX_MB);
+}
+
+
+static PyObject*
+dds_scheduler_stats(PyObject* self, PyObject* args)
+{
+    schedulerStats stats;
+    {
+        DDS_LOCK lock;
+        GetSchedulerStats(&stats);
+    }
+
+    PyObject* boards = PyList_New(stats.noOfThreads);
+    PyObject* busy = PyList_New(stats.noOfThreads);
+    if (boards == NULL || busy == NULL) {
+        Py_XDECREF(boards);
+        Py_XDECREF(busy);
+        return NULL;
+    }
+    for (int t=0 ; t<stats.noOfThreads ; t++) {
+        PyList_SET_ITEM(boards, t, PyLong_FromLong(stats.boards[t]));
+        PyList_SET_ITEM(busy, t, PyLong_FromLongLong(stats.busyMicros[t]));
+    }
+    return Py_BuildValue("{s:N,s:N,s:i,s:i,s:i,s:i,s:O,s:d,s:d}",
+        "boards", boards, "busy_us", busy, "steals", stats.noOfSteals,
+        "batch_boards", stats.noOfBoards,
+        "duplicates", stats.noOfDuplicates,
+        "timed_boards", stats.noOfTimedBoards,
+        "model_ready", stats.modelReady ? Py_True : Py_False,
+        "mean_abs_log_error", stats.meanAbsLogError,
+        "log_correlation", stats.logCorrelation);
+}
+
+
 const char* solve_deal_desc =
 "Solve a single deal\n"
 "Takes three parameters:\n"
@@ -787,7 +1790,8 @@ const char* solve_many_deals_desc =
 "   1. A bridgemoose.Deal object\n"
 "   2. Declarer (string 'W','N','E', or 'S')\n"
 "   3. Strain (string 'C','D','H','S', or 'N')\n"
-"Returns a list of integer number of tricks\n";
+"Returns a list of integer number of tricks, or None for a deal cut\n"
+"   short by dds.set_solve_limits()\n";
 
 const char* solve_many_plays_desc =
 "Solve many plays\n"
@@ -819,6 +1823,19 @@ const char* analyze_deal_play_desc =
 "of type (int, int, bool)\n";
 
 
+const char* analyze_many_plays_desc =
+"Analyze the same plays on many deals at once\n"
+"Takes four parameters:\n"
+"   1. An iterable of bridgemoose.Deal objects\n"
+"   2. Declarer (string 'W','N','E', or 'S')\n"
+"   3. Strain (string 'C','D','H','S', or 'N')\n"
+"   4. The play history as for analyze_deal_play, e.g. 'S4SJSQSAC4D2CKC5'\n"
+"The deals are shared out across the DDS threads in one call.\n"
+"Returns a (deals, plays, 3) memoryview of bytes holding, for each play,\n"
+"   the numbers of good and of bad moves and 1 if the play was good,\n"
+"   the same as the tuples from analyze_deal_play\n";
+
+
 const char* play_menu_desc =
 "Play Menu\n"
 "Takes four parameters:\n"
@@ -832,15 +1849,176 @@ const char* play_menu_desc =
 "Moves in the same tuple are equivalent.\n";
 
 
+const char* play_menu_many_desc =
+"Play menus for many deals at once, packed\n"
+"Takes four parameters, and an optional fifth:\n"
+"   1. A list of 4-tuples, where each item is a (partial) hand in string\n"
+"      format, starting with West.\n"
+"   2. The direction of the player on play ('W','N','E', or 'S')\n"
+"   3. Strain ('C','D','H','S', or 'N')\n"
+"   4. Trick so far; a string like 'C5CT' of up to 3 cards\n"
+"   5. split (default False); see below\n"
+"The deals are solved across the DDS threads.  With split, each deal is\n"
+"   solved in turn, with its legal cards shared out across the threads\n"
+"   instead, which is faster when there are fewer deals than threads;\n"
+"   dds.solve_telemetry() then has no figures for them.\n"
+"Returns two (deals, 52) memoryviews of bytes, (tricks, tops), indexed\n"
+"   by card number as in bridgemoose.card.bit_pack: 13 * suit + rank,\n"
+"   with clubs 0 and the deuce 0.  For each legal card, tricks holds the\n"
+"   tricks for the player on play and tops the number of the highest\n"
+"   card it is equivalent to; both are 255 for every other card\n";
+
+const char* solve_many_packed_desc =
+"Solve many deals held in buffers, without Python objects per deal\n"
+"Takes four parameters:\n"
+"   1. hands: a contiguous buffer of 64 bit masks, four per deal in\n"
+"      'WNES' order, laid out like jade's hand64_t: suit s in bits\n"
+"      16*s+2 .. 16*s+14 by rank, suits in 'CDHS' order\n"
+"   2. strains: 0-3 for 'CDHS', 4 for notrump; an int for every deal or\n"
+"      a buffer of one byte per deal\n"
+"   3. leaders: 0-3 for 'WNES'; an int or a buffer as for strains\n"
+"   4. out: a writable buffer of one byte per deal, which receives the\n"
+"      tricks taken by the side on lead\n"
+"Returns the number of deals solved.  numpy uint64 and uint8 arrays are\n"
+"fine for all of these.\n";
+
+const char* set_related_boards_desc =
+"Turn related-boards mode on or off for batch solves\n"
+"Takes one parameter, a bool.  In related mode, boards which share the\n"
+"   cards of one partnership are solved together on one thread, keeping\n"
+"   its transposition table.  Results are unchanged.\n"
+"Returns the previous setting\n";
+
+const char* set_work_stealing_desc =
+"Turn work stealing on or off for batch solves\n"
+"Takes one parameter, a bool.  With it on, each thread starts with its\n"
+"   own queue of boards, and an idle thread takes half of the queue with\n"
+"   the most predicted work left.  Results are unchanged.\n"
+"Returns the previous setting\n";
+
+const char* set_scheduler_model_desc =
+"Let the fitted solve-time model order batch solves\n"
+"Takes one parameter, a bool.  The scheduler fits solve times to those\n"
+"   of earlier batches either way; with this on, it sorts a batch by\n"
+"   the fit once that is calibrated for every strain in the batch,\n"
+"   instead of by built-in constants.  Results are unchanged.\n"
+"Returns the previous setting\n";
+
+const char* set_solve_limits_desc =
+"Limit the work of each call to the batch solver\n"
+"Takes two optional parameters:\n"
+"   1. ms (default 0), the milliseconds from the start of each call\n"
+"   2. nodes (default 0), the search nodes (tricks) per deal\n"
+"   0 is no limit.  A call takes up to 200 deals, so solve_many_packed\n"
+"   and the others make one call for every 200.\n"
+"A deal that runs out keeps only the cards that were finished:\n"
+"   solve_many_deals gives None for it, solve_many_packed 255, and\n"
+"   solve_many_plays and play_menu_many leave out the other cards.\n"
+"Returns the previous (ms, nodes)\n";
+
+const char* solve_bounds_desc =
+"Trick bounds for the deals of the most recent solve_many_deals,\n"
+"   solve_many_plays, play_menu_many or solve_many_packed\n"
+"Returns a list with a tuple (complete, lower, upper) per deal, where\n"
+"   the side to play takes from lower to upper tricks.  complete is\n"
+"   False for a deal that dds.set_solve_limits() cut short.  For the\n"
+"   others, lower and upper are equal unless solved for a target.\n";
+
+const char* set_solve_telemetry_desc =
+"Turn per-deal telemetry on or off for batch solves\n"
+"Takes one parameter, a bool.  With it on, DDS times each deal and keeps\n"
+"   its search figures for dds.solve_telemetry().  Results are unchanged.\n"
+"Returns the previous setting\n";
+
+const char* solve_telemetry_desc =
+"Per-deal figures for the deals of the most recent solve_many_deals,\n"
+"   solve_many_plays, play_menu_many or solve_many_packed\n"
+"Returns a dict of lists, one entry per deal: 'nodes' (search nodes, one\n"
+"   per trick), 'tt_hits' and 'tt_misses' (transposition table lookups),\n"
+"   'wall_us' (wall time in microseconds), 'thread' (the DDS thread that\n"
+"   solved it) and 'mem_kb' (the memory that thread held at the end).\n"
+"A deal that repeats an earlier one exactly is copied, with its figures.\n"
+"The lists are empty if telemetry was off.\n";
+
+const char* set_resources_desc =
+"Set the number of DDS threads and the memory their TTs may use\n"
+"Takes two optional parameters:\n"
+"   1. threads (default 0), at most this many threads; 0 for one per core\n"
+"   2. mem_mb (default 0), the memory budget in MB; 0 for 70% of free\n"
+"      memory.  As in DDS's SetResources, the TTs may use up to 30% more,\n"
+"      since few threads ever reach their maximum size.\n"
+"Each thread gets a large TT (up to 160 MB) or a small one (up to 30 MB),\n"
+"   with as many large ones as the budget allows.  A budget too small for\n"
+"   one small TT per thread means fewer threads, but never none.\n"
+"Must not be called while a solve is running in another Python thread.\n"
+"Returns a dict with 'threads', 'large_threads', 'small_threads' and\n"
+"   'tt_max_mb', the most the TTs can grow to\n";
+
+const char* scheduler_stats_desc =
+"Thread loads from the most recent batch solve\n"
+"Returns a dict with lists 'boards' and 'busy_us' (thread CPU time in\n"
+"   microseconds), one entry per thread, and 'steals', the number of\n"
+"   times a thread took work from another thread's queue.\n"
+"Also how well the fit to earlier batches' times predicted this one,\n"
+"   over the 'timed_boards' that were solved rather than copied and\n"
+"   that it was calibrated for: 'mean_abs_log_error', the mean of\n"
+"   |ln(predicted/actual)|, and 'log_correlation'.  'model_ready' is True\n"
+"   if the fit ordered the batch (see dds.set_scheduler_model).\n"
+"'batch_boards' is the number of boards in the batch, and 'duplicates'\n"
+"   how many of them repeated an earlier board exactly and were copied.\n";
+
+const char* calc_tables_desc =
+"Double dummy tables for many deals\n"
+"Takes one to four parameters:\n"
+"   1. An iterable of bridgemoose.Deal objects\n"
+"   2. strains (default 'SHDCN'), the strains wanted and their order\n"
+"   3. par_vul (default None), if given also work out par; one of\n"
+"      'None', 'NS', 'EW' or 'Both'.  Needs all five strains.\n"
+"   4. par_dealer (default 'N'), the dealer for par\n"
+"Returns a (deals, strains, 4) memoryview of tricks for each declarer\n"
+"   in 'WNES' order.  numpy.asarray() of it makes no copy.\n"
+"With par_vul, returns (tables, pars) where each par is a tuple\n"
+"   (score for NS, list of contracts such as 'NS 4S+1' or 'EW 5Cx-2')\n";
+
+
 static PyMethodDef DdsMethods[] = {
     {"solve_deal", dds_solve_deal, METH_VARARGS, solve_deal_desc},
     {"solve_many_deals", dds_solve_many_deals, METH_VARARGS, solve_many_deals_desc},
     {"solve_many_plays", dds_solve_many_plays, METH_VARARGS, solve_many_plays_desc},
     {"analyze_deal_play", dds_analyze_deal_play, METH_VARARGS, analyze_deal_play_desc},
+    {"analyze_many_plays", dds_analyze_many_plays, METH_VARARGS, analyze_many_plays_desc},
     {"play_menu", dds_play_menu, METH_VARARGS, play_menu_desc},
+    {"play_menu_many", dds_play_menu_many, METH_VARARGS, play_menu_many_desc},
+    {"solve_many_packed", dds_solve_many_packed, METH_VARARGS, solve_many_packed_desc},
+    {"calc_tables", (PyCFunction)(void(*)(void))dds_calc_tables,
+        METH_VARARGS | METH_KEYWORDS, calc_tables_desc},
+    {"set_related_boards", dds_set_related_boards, METH_VARARGS, set_related_boards_desc},
+    {"set_work_stealing", dds_set_work_stealing, METH_VARARGS, set_work_stealing_desc},
+    {"set_scheduler_model", dds_set_scheduler_model, METH_VARARGS, set_scheduler_model_desc},
+    {"set_solve_limits", dds_set_solve_limits, METH_VARARGS, set_solve_limits_desc},
+    {"solve_bounds", dds_solve_bounds, METH_NOARGS, solve_bounds_desc},
+    {"set_solve_telemetry", dds_set_solve_telemetry, METH_VARARGS, set_solve_telemetry_desc},
+    {"solve_telemetry", dds_solve_telemetry, METH_NOARGS, solve_telemetry_desc},
+    {"set_resources", dds_set_resources, METH_VARARGS, set_resources_desc},
+    {"scheduler_stats", dds_scheduler_stats, METH_NOARGS, scheduler_stats_desc},
     {NULL, NULL, 0, NULL}
 };
 
+// jade reaches DDS through the capsule, with the GIL held
+static int STDCALL
+capsule_solve_all_boards_bin(struct boards* bop, struct solvedBoards* solvedp)
+{
+    DDS_LOCK lock;
+    return SolveAllBoardsBin(bop, solvedp);
+}
+
+static int STDCALL
+capsule_set_related_boards(int on)
+{
+    DDS_LOCK lock;
+    return SetRelatedBoards(on);
+}
+
 static struct PyModuleDef ddsmodule = {
     PyModuleDef_HEAD_INIT,
     "bridgemoose.dds",
@@ -863,7 +2041,8 @@ PyInit_dds(void)
         return NULL;
 
     _dds_c_api.pErrorMessage = ErrorMessage;
-    _dds_c_api.pSolveAllBoardsBin = SolveAllBoardsBin;
+    _dds_c_api.pSolveAllBoardsBin = capsule_solve_all_boards_bin;
+    _dds_c_api.pSetRelatedBoards = capsule_set_related_boards;
 
     SetMaxThreads(0);
 
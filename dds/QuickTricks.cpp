@@ -13,72 +13,132 @@
 #include "QuickTricks.h"
 
 
-int QtricksLeadHandNT(
-  const int hand,
-  pos& tpos,
-  const int cutoff,
-  const int depth,
-  const int countLho,
-  const int countRho,
-  int& lhoTrumpRanks,
-  int& rhoTrumpRanks,
-  const bool commPartner,
-  const int commSuit,
-  const int countOwn,
-  const int countPart,
-  const int suit,
-  const int qtricks,
-  const int trump,
-  int& res);
+// When the top card of a suit is with the hand on lead or with its
+// partner, the quick tricks in the suit come in a few steps, each
+// taking one or more tricks and marking the ranks they use. Which
+// steps are taken depends only on who holds the second best card,
+// on the lengths of the four hands up to three cards, and on
+// whether each opponent is out of trumps. So the steps are worked
+// out once in InitQuickTricks for every combination, for the two
+// leading hands and the two kinds of suit, and QuickTricks only
+// follows them.
+
+#define QT_ONE 0
+#define QT_OWN_LESS_1 1
+#define QT_OWN_LESS_2 2
+#define QT_PART_LESS_1 3
+#define QT_PART_LESS_2 4
+#define QT_MAX_LESS_2 5
+#define QT_AMOUNT 0x07
+
+#define QT_MARK_WINNER 0x08
+#define QT_MARK_SECOND 0x10
+#define QT_MARK_COMM 0x20
+#define QT_DROP_TRUMPS 0x40
+
+// The steps end by going on with the same suit (0), with the next
+// suit (2), or by trying the third best card in the suit used to
+// reach partner. That last one may take a further trick as well,
+// and may mark the communication card too.
+#define QT_END_SAME 0
+#define QT_END_NEXT 2
+#define QT_END_THIRD 3
+#define QT_END_MORE 0x10
+#define QT_END_COMM 0x20
+
+#define QT_SECOND_OWN 0
+#define QT_SECOND_PART 1
+#define QT_SECOND_LHO 2
+#define QT_SECOND_OTHER 3
+
+#define QT_LEAD_TRUMP 0
+#define QT_LEAD_NT 1
+#define QT_PART_TRUMP 2
+#define QT_PART_NT 3
+
+#define QT_KEYS 4096
+
+struct qtStepsType
+{
+  unsigned char noOfSteps;
+  unsigned char end;
+  unsigned char step[4];
+};
 
-int QtricksLeadHandTrump(
-  const int hand,
-  pos& tpos,
-  const int cutoff,
-  const int depth,
-  const int countLho,
-  const int countRho,
-  const int lhoTrumpRanks,
-  const int rhoTrumpRanks,
-  const int countOwn,
-  const int countPart,
-  const int suit,
-  const int qtricks,
-  int& res);
+static qtStepsType qtSteps[4][QT_KEYS];
+
+// The trump suit first, then the others in order.
+static const int qtSuitOrder[DDS_STRAINS][DDS_SUITS] =
+{
+  { 0, 1, 2, 3 },
+  { 1, 0, 2, 3 },
+  { 2, 0, 1, 3 },
+  { 3, 0, 1, 2 },
+  { 0, 1, 2, 3 }
+};
+
+static const int qtSecond[DDS_HANDS] =
+{
+  QT_SECOND_OWN, QT_SECOND_LHO, QT_SECOND_PART, QT_SECOND_OTHER
+};
+
+
+static void MakeLeadTrump(
+  const int key,
+  qtStepsType& st);
+
+static void MakeLeadNT(
+  const int key,
+  qtStepsType& st);
+
+static void MakePartnerTrump(
+  const int key,
+  qtStepsType& st);
+
+static void MakePartnerNT(
+  const int key,
+  qtStepsType& st);
 
-int QuickTricksPartnerHandTrump(
+static int FollowSteps(
+  const qtStepsType& st,
   const int hand,
   pos& tpos,
   const int cutoff,
   const int depth,
-  const int countLho,
-  const int countRho,
-  const int lhoTrumpRanks,
-  const int rhoTrumpRanks,
   const int countOwn,
   const int countPart,
   const int suit,
   const int qtricks,
   const int commSuit,
   const int commRank,
+  const bool dropTrumps,
+  int& lhoTrumpRanks,
+  int& rhoTrumpRanks,
   int& res,
   const ThreadData& thrd);
 
-int QuickTricksPartnerHandNT(
+static int QuickTricksKey(
+  const pos& tpos,
   const int hand,
-  pos& tpos,
-  const int cutoff,
-  const int depth,
+  const int suit,
   const int countLho,
   const int countRho,
   const int countOwn,
   const int countPart,
-  const int suit,
-  const int qtricks,
-  const int commSuit,
-  const int commRank,
-  int& res,
-  const ThreadData& thrd);
+  const int lhoTrumpRanks,
+  const int rhoTrumpRanks);
+
+
+void InitQuickTricks()
+{
+  for (int key = 0; key < QT_KEYS; key++)
+  {
+    MakeLeadTrump(key, qtSteps[QT_LEAD_TRUMP][key]);
+    MakeLeadNT(key, qtSteps[QT_LEAD_NT][key]);
+    MakePartnerTrump(key, qtSteps[QT_PART_TRUMP][key]);
+    MakePartnerNT(key, qtSteps[QT_PART_NT][key]);
+  }
+}
 
 
 int QuickTricks(
@@ -90,7 +150,7 @@ int QuickTricks(
   bool& result,
   const ThreadData& thrd)
 {
-  int suit, commRank = 0, commSuit = -1;
+  int commRank = 0, commSuit = -1;
   int res;
   int lhoTrumpRanks = 0, rhoTrumpRanks = 0;
   int cutoff, lowestQtricks = 0;
@@ -185,15 +245,13 @@ int QuickTricks(
 
   if (trump != DDS_NOTRUMP)
   {
-    suit = trump;
     lhoTrumpRanks = len[lho[hand]][trump];
     rhoTrumpRanks = len[rho[hand]][trump];
   }
-  else
-    suit = 0;
 
-  do
+  for (int k = 0; k < DDS_SUITS; k++)
   {
+    const int suit = qtSuitOrder[trump][k];
     int countOwn = len[hand][suit];
     int countLho = len[lho[hand]][suit];
     int countRho = len[rho[hand]][suit];
@@ -202,29 +260,9 @@ int QuickTricks(
 
     if (!opps && (countPart == 0))
     {
+      /* Continue with next suit. */
       if (countOwn == 0)
-      {
-        /* Continue with next suit. */
-        if ((trump != DDS_NOTRUMP) && (trump != suit))
-        {
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
-        }
-        else
-        {
-          if ((trump != DDS_NOTRUMP) && (trump == suit))
-          {
-            if (trump == 0)
-              suit = 1;
-            else
-              suit = 0;
-          }
-          else
-            suit++;
-        }
         continue;
-      }
 
       /* Long tricks when only leading hand have cards in the suit. */
       if ((trump != DDS_NOTRUMP) && (trump != suit))
@@ -234,17 +272,6 @@ int QuickTricks(
           qtricks += countOwn;
           if (qtricks >= cutoff)
             return qtricks;
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
-          continue;
-        }
-        else
-        {
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
-          continue;
         }
       }
       else
@@ -252,22 +279,8 @@ int QuickTricks(
         qtricks += countOwn;
         if (qtricks >= cutoff)
           return qtricks;
-
-        if ((trump != DDS_NOTRUMP) && (suit == trump))
-        {
-          if (trump == 0)
-            suit = 1;
-          else
-            suit = 0;
-        }
-        else
-        {
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
-        }
-        continue;
       }
+      continue;
     }
     else
     {
@@ -326,18 +339,6 @@ int QuickTricks(
 
               if (qtricks >= cutoff)
                 return qtricks;
-
-              suit++;
-              if ((trump != DDS_NOTRUMP) && (suit == trump))
-                suit++;
-              continue;
-            }
-            else
-            {
-              suit++;
-              if ((trump != DDS_NOTRUMP) && (suit == trump))
-                suit++;
-              continue;
             }
           }
           else
@@ -348,22 +349,8 @@ int QuickTricks(
 
             if (qtricks >= cutoff)
               return qtricks;
-
-            if ((trump != DDS_NOTRUMP) && (suit == trump))
-            {
-              if (trump == 0)
-                suit = 1;
-              else
-                suit = 0;
-            }
-            else
-            {
-              suit++;
-              if ((trump != DDS_NOTRUMP) && (suit == trump))
-                suit++;
-            }
-            continue;
           }
+          continue;
         }
         else
         {
@@ -410,63 +397,37 @@ int QuickTricks(
     }
 
     if (winner[suit].rank == 0)
-    {
-      if ((trump != DDS_NOTRUMP) && (suit == trump))
-      {
-        if (trump == 0)
-          suit = 1;
-        else
-          suit = 0;
-      }
-      else
-      {
-        suit++;
-        if ((trump != DDS_NOTRUMP) && (suit == trump))
-          suit++;
-      }
       continue;
-    }
 
     if (winner[suit].hand == hand)
     {
+      const int key = QuickTricksKey(tpos, hand, suit, countLho,
+        countRho, countOwn, countPart, lhoTrumpRanks, rhoTrumpRanks);
+
       if ((trump != DDS_NOTRUMP) && (trump != suit))
       {
-        qtricks = QtricksLeadHandTrump(hand, tpos, cutoff, depth,
-          countLho, countRho, lhoTrumpRanks, rhoTrumpRanks,
-          countOwn, countPart, suit, qtricks, res);
+        qtricks = FollowSteps(qtSteps[QT_LEAD_TRUMP][key], hand, tpos,
+          cutoff, depth, countOwn, countPart, suit, qtricks,
+          commSuit, commRank, false, lhoTrumpRanks, rhoTrumpRanks,
+          res, thrd);
 
         if (res == 1)
           return qtricks;
         else if (res == 2)
-        {
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
           continue;
-        }
       }
       else
       {
-        qtricks = QtricksLeadHandNT(hand, tpos, cutoff, depth,
-          countLho, countRho, lhoTrumpRanks, rhoTrumpRanks,
-          commPartner, commSuit, countOwn, countPart,
-          suit, qtricks, trump, res);
+        qtricks = FollowSteps(qtSteps[QT_LEAD_NT][key], hand, tpos,
+          cutoff, depth, countOwn, countPart, suit, qtricks,
+          commSuit, commRank,
+          (trump == suit) && ((! commPartner) || (suit != commSuit)),
+          lhoTrumpRanks, rhoTrumpRanks, res, thrd);
 
         if (res == 1)
           return qtricks;
         else if (res == 2)
-        {
-          if ((trump != DDS_NOTRUMP) && (trump == suit))
-          {
-            if (trump == 0)
-              suit = 1;
-            else
-              suit = 0;
-          }
-          else
-            suit++;
           continue;
-        }
       }
     }
 
@@ -481,44 +442,32 @@ int QuickTricks(
         if (commPartner)
         {
           /* There is communication with the partner */
+          const int key = QuickTricksKey(tpos, hand, suit, countLho,
+            countRho, countOwn, countPart, lhoTrumpRanks, rhoTrumpRanks);
+
           if ((trump != DDS_NOTRUMP) && (trump != suit))
           {
-            qtricks = QuickTricksPartnerHandTrump(hand, tpos,
-              cutoff, depth, countLho, countRho,
-              lhoTrumpRanks, rhoTrumpRanks, countOwn,
-              countPart, suit, qtricks, commSuit, commRank, res, thrd);
+            qtricks = FollowSteps(qtSteps[QT_PART_TRUMP][key], hand,
+              tpos, cutoff, depth, countOwn, countPart, suit, qtricks,
+              commSuit, commRank, false, lhoTrumpRanks, rhoTrumpRanks,
+              res, thrd);
 
             if (res == 1)
               return qtricks;
             else if (res == 2)
-            {
-              suit++;
-              if ((trump != DDS_NOTRUMP) && (suit == trump))
-                suit++;
               continue;
-            }
           }
           else
           {
-            qtricks = QuickTricksPartnerHandNT(hand, tpos, cutoff,
-              depth, countLho, countRho, countOwn, countPart,
-              suit, qtricks, commSuit, commRank, res, thrd);
+            qtricks = FollowSteps(qtSteps[QT_PART_NT][key], hand,
+              tpos, cutoff, depth, countOwn, countPart, suit, qtricks,
+              commSuit, commRank, false, lhoTrumpRanks, rhoTrumpRanks,
+              res, thrd);
 
             if (res == 1)
               return qtricks;
             else if (res == 2)
-            {
-              if ((trump != DDS_NOTRUMP) && (trump == suit))
-              {
-                if (trump == 0)
-                  suit = 1;
-                else
-                  suit = 0;
-              }
-              else
-                suit++;
               continue;
-            }
           }
         }
       }
@@ -539,9 +488,6 @@ int QuickTricks(
           lowestQtricks = 1;
           if (1 >= cutoff)
             return 1;
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
           continue;
         }
         else if ((countRho == 0) && (countLho == 0))
@@ -560,9 +506,6 @@ int QuickTricks(
                 return 1;
             }
           }
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
           continue;
         }
         else if (countLho == 0)
@@ -571,20 +514,11 @@ int QuickTricks(
               ris[partner[hand]][trump])
           {
             lowestQtricks = 1;
-            for (int rr = 14; rr >= 2; rr--)
-            {
-              if ((ris[partner[hand]][trump] & bitMapRank[rr]) != 0)
-              {
-                tpos.winRanks[depth][trump] |= bitMapRank[rr];
-                break;
-              }
-            }
+            tpos.winRanks[depth][trump] |=
+              bitMapRank[highestRank[ris[partner[hand]][trump]]];
             if (1 >= cutoff)
               return 1;
           }
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
           continue;
         }
         else if (countRho == 0)
@@ -593,20 +527,11 @@ int QuickTricks(
               ris[partner[hand]][trump])
           {
             lowestQtricks = 1;
-            for (int rr = 14; rr >= 2; rr--)
-            {
-              if ((ris[partner[hand]][trump] & bitMapRank[rr]) != 0)
-              {
-                tpos.winRanks[depth][trump] |= bitMapRank[rr];
-                break;
-              }
-            }
+            tpos.winRanks[depth][trump] |=
+              bitMapRank[highestRank[ris[partner[hand]][trump]]];
             if (1 >= cutoff)
               return 1;
           }
-          suit++;
-          if ((trump != DDS_NOTRUMP) && (suit == trump))
-            suit++;
           continue;
         }
       }
@@ -614,22 +539,7 @@ int QuickTricks(
 
     if (qtricks >= cutoff)
       return qtricks;
-
-    if ((trump != DDS_NOTRUMP) && (suit == trump))
-    {
-      if (trump == 0)
-        suit = 1;
-      else
-        suit = 0;
-    }
-    else
-    {
-      suit++;
-      if ((trump != DDS_NOTRUMP) && (suit == trump))
-        suit++;
-    }
   }
-  while (suit <= 3);
 
   if (qtricks == 0)
   {
@@ -662,412 +572,355 @@ int QuickTricks(
 }
 
 
-int QtricksLeadHandTrump(
-  const int hand,
-  pos& tpos,
-  const int cutoff,
-  const int depth,
-  const int countLho,
-  const int countRho,
-  const int lhoTrumpRanks,
-  const int rhoTrumpRanks,
-  const int countOwn,
-  const int countPart,
-  const int suit,
-  const int qtricks,
-  int& res)
+// The Make functions are the old step-by-step code for the two
+// hands and the two kinds of suit, with the lengths cut off at
+// three and each trick recorded as a step instead of taken.
+
+#define QT_KEY_SECOND(key) ((key) & 3)
+#define QT_KEY_LHO(key) (((key) >> 2) & 3)
+#define QT_KEY_RHO(key) (((key) >> 4) & 3)
+#define QT_KEY_OWN(key) (((key) >> 6) & 3)
+#define QT_KEY_PART(key) (((key) >> 8) & 3)
+#define QT_KEY_LHO_VOID(key) (((key) >> 10) & 1)
+#define QT_KEY_RHO_VOID(key) (((key) >> 11) & 1)
+
+
+static void Step(
+  qtStepsType& st,
+  const int step)
 {
-  /* res=0 Continue with same suit.
-     res=1 Cutoff.
-     res=2 Continue with next suit. */
+  st.step[st.noOfSteps++] = static_cast<unsigned char>(step);
+}
 
-  res = 1;
-  int qt = qtricks;
-  if (((countLho != 0) ||
-       (lhoTrumpRanks == 0)) &&
-      ((countRho != 0) || (rhoTrumpRanks == 0)))
-  {
-    tpos.winRanks[depth][suit] |=
-      bitMapRank[tpos.winner[suit].rank];
-    qt++;
-    if (qt >= cutoff)
-      return qt;
 
-    if ((countLho <= 1) &&
-        (countRho <= 1) &&
-        (countPart <= 1) &&
-        (lhoTrumpRanks == 0) &&
-        (rhoTrumpRanks == 0))
+static void MakeLeadTrump(
+  const int key,
+  qtStepsType& st)
+{
+  const int second = QT_KEY_SECOND(key);
+  const int countLho = QT_KEY_LHO(key);
+  const int countRho = QT_KEY_RHO(key);
+  const int countOwn = QT_KEY_OWN(key);
+  const int countPart = QT_KEY_PART(key);
+  const bool lhoVoid = (QT_KEY_LHO_VOID(key) != 0);
+  const bool rhoVoid = (QT_KEY_RHO_VOID(key) != 0);
+
+  st.noOfSteps = 0;
+  st.end = QT_END_NEXT;
+
+  if ((countLho != 0 || lhoVoid) && (countRho != 0 || rhoVoid))
+  {
+    Step(st, QT_ONE | QT_MARK_WINNER);
+    if (countLho <= 1 && countRho <= 1 && countPart <= 1 &&
+        lhoVoid && rhoVoid)
     {
-      qt += countOwn - 1;
-      if (qt >= cutoff)
-        return qt;
-      res = 2;
-      return qt;
+      Step(st, QT_OWN_LESS_1);
+      return;
     }
   }
 
-  if (tpos.secondBest[suit].hand == hand)
+  if (second == QT_SECOND_OWN)
   {
-    if ((lhoTrumpRanks == 0) && (rhoTrumpRanks == 0))
+    if (lhoVoid && rhoVoid)
     {
-      tpos.winRanks[depth][suit] |=
-        bitMapRank[tpos.secondBest[suit].rank];
-      qt++;
-      if (qt >= cutoff)
-        return qt;
-      if ((countLho <= 2) && (countRho <= 2) && (countPart <= 2))
+      Step(st, QT_ONE | QT_MARK_SECOND);
+      if (countLho <= 2 && countRho <= 2 && countPart <= 2)
       {
-        qt += countOwn - 2;
-        if (qt >= cutoff)
-          return qt;
-        res = 2;
-        return qt;
+        Step(st, QT_OWN_LESS_2);
+        return;
       }
     }
   }
-  else if ((tpos.secondBest[suit].hand == partner[hand])
-           && (countOwn > 1) && (countPart > 1))
+  else if (second == QT_SECOND_PART && countOwn > 1 && countPart > 1)
   {
-    /* Second best at partner and suit length of own
-       hand and partner > 1 */
-    if ((lhoTrumpRanks == 0) && (rhoTrumpRanks == 0))
+    // Second best at partner and suit length of own hand and
+    // partner > 1
+    if (lhoVoid && rhoVoid)
     {
-      tpos.winRanks[depth][suit] |=
-        bitMapRank[tpos.secondBest[suit].rank];
-      qt++;
-      if (qt >= cutoff)
-        return qt;
-      if ((countLho <= 2) &&
-          (countRho <= 2) &&
-          ((countPart <= 2) || (countOwn <= 2)))
+      Step(st, QT_ONE | QT_MARK_SECOND);
+      if (countLho <= 2 && countRho <= 2 &&
+          (countPart <= 2 || countOwn <= 2))
       {
-        qt += max(countOwn - 2, countPart - 2);
-        if (qt >= cutoff)
-          return qt;
-        res = 2;
-        return qt;
+        Step(st, QT_MAX_LESS_2);
+        return;
       }
     }
   }
-  res = 0;
-  return qt;
+  st.end = QT_END_SAME;
 }
 
-int QtricksLeadHandNT(
-  const int hand,
-  pos& tpos,
-  const int cutoff,
-  const int depth,
-  const int countLho,
-  const int countRho,
-  int& lhoTrumpRanks,
-  int& rhoTrumpRanks,
-  const bool commPartner,
-  const int commSuit,
-  const int countOwn,
-  const int countPart,
-  const int suit,
-  const int qtricks,
-  const int trump,
-  int& res)
-{
-  /* res=0 Continue with same suit.
-     res=1 Cutoff.
-     res=2 Continue with next suit. */
-
-  res = 1;
-  int qt = qtricks;
-  tpos.winRanks[depth][suit] |=
-    bitMapRank[tpos.winner[suit].rank];
 
-  qt++;
-  if (qt >= cutoff)
-    return qt;
-  if ((trump == suit) && ((!commPartner) || (suit != commSuit)))
+static void MakeLeadNT(
+  const int key,
+  qtStepsType& st)
+{
+  const int second = QT_KEY_SECOND(key);
+  const int countLho = QT_KEY_LHO(key);
+  const int countRho = QT_KEY_RHO(key);
+  const int countOwn = QT_KEY_OWN(key);
+  const int countPart = QT_KEY_PART(key);
+
+  st.noOfSteps = 0;
+  st.end = QT_END_NEXT;
+
+  // In the trump suit of a trump contract, each of these tricks
+  // takes a trump from the opponents (QT_DROP_TRUMPS).
+  Step(st, QT_ONE | QT_MARK_WINNER | QT_DROP_TRUMPS);
+  if (countLho <= 1 && countRho <= 1 && countPart <= 1)
   {
-    lhoTrumpRanks = max(0, lhoTrumpRanks - 1);
-    rhoTrumpRanks = max(0, rhoTrumpRanks - 1);
+    Step(st, QT_OWN_LESS_1);
+    return;
   }
 
-  if ((countLho <= 1) && (countRho <= 1) && (countPart <= 1))
+  if (second == QT_SECOND_OWN)
   {
-    qt += countOwn - 1;
-    if (qt >= cutoff)
-      return qt;
-    res = 2;
-    return qt;
-  }
-
-  if (tpos.secondBest[suit].hand == hand)
-  {
-    tpos.winRanks[depth][suit] |=
-      bitMapRank[tpos.secondBest[suit].rank];
-    qt++;
-    if (qt >= cutoff)
-      return qt;
-    if ((trump == suit) && ((!commPartner) || (suit != commSuit)))
+    Step(st, QT_ONE | QT_MARK_SECOND | QT_DROP_TRUMPS);
+    if (countLho <= 2 && countRho <= 2 && countPart <= 2)
     {
-      lhoTrumpRanks = max(0, lhoTrumpRanks - 1);
-      rhoTrumpRanks = max(0, rhoTrumpRanks - 1);
-    }
-    if ((countLho <= 2) && (countRho <= 2) && (countPart <= 2))
-    {
-      qt += countOwn - 2;
-      if (qt >= cutoff)
-        return qt;
-      res = 2;
-      return qt;
+      Step(st, QT_OWN_LESS_2);
+      return;
     }
   }
-  else if ((tpos.secondBest[suit].hand == partner[hand])
-           && (countOwn > 1) && (countPart > 1))
+  else if (second == QT_SECOND_PART && countOwn > 1 && countPart > 1)
   {
-    /* Second best at partner and suit length of own
-       hand and partner > 1 */
-    tpos.winRanks[depth][suit] |=
-      bitMapRank[tpos.secondBest[suit].rank];
-    qt++;
-    if (qt >= cutoff)
-      return qt;
-    if ((trump == suit) && ((!commPartner) || (suit != commSuit)))
+    // Second best at partner and suit length of own hand and
+    // partner > 1
+    Step(st, QT_ONE | QT_MARK_SECOND | QT_DROP_TRUMPS);
+    if (countLho <= 2 && countRho <= 2 &&
+        (countPart <= 2 || countOwn <= 2))
     {
-      lhoTrumpRanks = max(0, lhoTrumpRanks - 1);
-      rhoTrumpRanks = max(0, rhoTrumpRanks - 1);
-    }
-    if ((countLho <= 2) &&
-        (countRho <= 2) &&
-        ((countPart <= 2) || (countOwn <= 2)))
-    {
-      qt += max(countOwn - 2, countPart - 2);
-      if (qt >= cutoff)
-        return qt;
-      res = 2;
-      return qt;
+      Step(st, QT_MAX_LESS_2);
+      return;
     }
   }
-
-  res = 0;
-  return qt;
+  st.end = QT_END_SAME;
 }
 
 
-int QuickTricksPartnerHandTrump(
-  const int hand,
-  pos& tpos,
-  const int cutoff,
-  const int depth,
-  const int countLho,
-  const int countRho,
-  const int lhoTrumpRanks,
-  const int rhoTrumpRanks,
-  const int countOwn,
-  const int countPart,
-  const int suit,
-  const int qtricks,
-  const int commSuit,
-  const int commRank,
-  int& res,
-  const ThreadData& thrd)
+static void MakePartnerTrump(
+  const int key,
+  qtStepsType& st)
 {
-  /* res=0 Continue with same suit.
-     res=1 Cutoff.
-     res=2 Continue with next suit. */
-
-  res = 1;
-  int qt = qtricks;
-  if (((countLho != 0) || (lhoTrumpRanks == 0)) &&
-      ((countRho != 0) || (rhoTrumpRanks == 0)))
+  const int second = QT_KEY_SECOND(key);
+  const int countLho = QT_KEY_LHO(key);
+  const int countRho = QT_KEY_RHO(key);
+  const int countOwn = QT_KEY_OWN(key);
+  const int countPart = QT_KEY_PART(key);
+  const bool lhoVoid = (QT_KEY_LHO_VOID(key) != 0);
+  const bool rhoVoid = (QT_KEY_RHO_VOID(key) != 0);
+
+  st.noOfSteps = 0;
+  st.end = QT_END_NEXT;
+
+  if ((countLho != 0 || lhoVoid) && (countRho != 0 || rhoVoid))
   {
-    tpos.winRanks[depth][suit] |=
-      bitMapRank[tpos.winner[suit].rank];
-
-    tpos.winRanks[depth][commSuit] |= bitMapRank[commRank];
-
-    qt++; /* A trick can be taken */
-    if (qt >= cutoff)
-      return qt;
-    if ((countLho <= 1) &&
-        (countRho <= 1) &&
-        (countOwn <= 1) &&
-        (lhoTrumpRanks == 0) &&
-        (rhoTrumpRanks == 0))
+    Step(st, QT_ONE | QT_MARK_WINNER | QT_MARK_COMM);
+    if (countLho <= 1 && countRho <= 1 && countOwn <= 1 &&
+        lhoVoid && rhoVoid)
     {
-      qt += countPart - 1;
-      if (qt >= cutoff)
-        return qt;
-      res = 2;
-      return qt;
+      Step(st, QT_PART_LESS_1);
+      return;
     }
   }
 
-  if (tpos.secondBest[suit].hand == partner[hand])
+  if (second == QT_SECOND_PART)
   {
-    /* Second best found in partners hand */
-    if ((lhoTrumpRanks == 0) && (rhoTrumpRanks == 0))
+    // Second best found in partners hand
+    if (lhoVoid && rhoVoid)
     {
-      /* Opponents have no trump */
-      tpos.winRanks[depth][suit] |=
-        bitMapRank[tpos.secondBest[suit].rank];
-
-      tpos.winRanks[depth][commSuit] |= bitMapRank[commRank];
-      qt++;
-      if (qt >= cutoff)
-        return qt;
-      if ((countLho <= 2) && (countRho <= 2) && (countOwn <= 2))
+      // Opponents have no trump
+      Step(st, QT_ONE | QT_MARK_SECOND | QT_MARK_COMM);
+      if (countLho <= 2 && countRho <= 2 && countOwn <= 2)
       {
-        qt += countPart - 2;
-        if (qt >= cutoff)
-          return qt;
-        res = 2;
-        return qt;
+        Step(st, QT_PART_LESS_2);
+        return;
       }
     }
   }
-  else if ((tpos.secondBest[suit].hand == hand) &&
-           (countPart > 1) &&
-           (countOwn > 1))
+  else if (second == QT_SECOND_OWN && countPart > 1 && countOwn > 1)
   {
-    /* Second best found in own hand and suit lengths of own hand
-       and partner > 1*/
-
-    if ((lhoTrumpRanks == 0) && (rhoTrumpRanks == 0))
+    // Second best found in own hand and suit lengths of own hand
+    // and partner > 1
+    if (lhoVoid && rhoVoid)
     {
-      /* Opponents have no trump */
-      tpos.winRanks[depth][suit] |=
-        bitMapRank[tpos.secondBest[suit].rank];
-
-      tpos.winRanks[depth][commSuit] |= bitMapRank[commRank];
-
-      qt++;
-      if (qt >= cutoff)
-        return qt;
-      if ((countLho <= 2) &&
-          (countRho <= 2) &&
-          ((countOwn <= 2) || (countPart <= 2)))
+      // Opponents have no trump
+      Step(st, QT_ONE | QT_MARK_SECOND | QT_MARK_COMM);
+      if (countLho <= 2 && countRho <= 2 &&
+          (countOwn <= 2 || countPart <= 2))
       {
-        qt += max(countPart - 2, countOwn - 2);
-        if (qt >= cutoff)
-          return qt;
-        res = 2;
-        return qt;
+        Step(st, QT_MAX_LESS_2);
+        return;
       }
     }
   }
-  else if ((suit == commSuit) &&
-           (tpos.secondBest[suit].hand == lho[hand]) &&
-           ((countLho >= 2) || (lhoTrumpRanks == 0)) &&
-           ((countRho >= 2) || (rhoTrumpRanks == 0)))
+  else if (second == QT_SECOND_LHO &&
+           (countLho >= 2 || lhoVoid) &&
+           (countRho >= 2 || rhoVoid))
   {
-    unsigned short ranks = 0;
-    for (int h = 0; h < DDS_HANDS; h++)
-      ranks |= tpos.rankInSuit[h][suit];
+    st.end = QT_END_THIRD | QT_END_COMM;
+    if (countOwn <= 2 && countLho <= 2 && countRho <= 2 &&
+        lhoVoid && rhoVoid)
+      st.end |= QT_END_MORE;
+    return;
+  }
+  st.end = QT_END_SAME;
+}
 
-    if (thrd.rel[ranks].absRank[3][suit].hand == partner[hand])
-    {
-      tpos.winRanks[depth][suit] |= bitMapRank[
-        static_cast<int>(thrd.rel[ranks].absRank[3][suit].rank) ];
 
-      tpos.winRanks[depth][commSuit] |= bitMapRank[commRank];
+static void MakePartnerNT(
+  const int key,
+  qtStepsType& st)
+{
+  const int second = QT_KEY_SECOND(key);
+  const int countLho = QT_KEY_LHO(key);
+  const int countRho = QT_KEY_RHO(key);
+  const int countOwn = QT_KEY_OWN(key);
+  const int countPart = QT_KEY_PART(key);
 
-      qt++;
-      if (qt >= cutoff)
-        return qt;
-      if ((countOwn <= 2) &&
-          (countLho <= 2) &&
-          (countRho <= 2) &&
-          (lhoTrumpRanks == 0) &&
-          (rhoTrumpRanks == 0))
-      {
-        qt += countPart - 2;
-        if (qt >= cutoff)
-          return qt;
-      }
+  st.noOfSteps = 0;
+  st.end = QT_END_NEXT;
+
+  Step(st, QT_ONE | QT_MARK_WINNER | QT_MARK_COMM);
+  if (countLho <= 1 && countRho <= 1 && countOwn <= 1)
+  {
+    Step(st, QT_PART_LESS_1);
+    return;
+  }
+
+  if (second == QT_SECOND_PART)
+  {
+    // Second best found in partners hand
+    Step(st, QT_ONE | QT_MARK_SECOND);
+    if (countLho <= 2 && countRho <= 2 && countOwn <= 2)
+    {
+      Step(st, QT_PART_LESS_2);
+      return;
     }
   }
-  res = 0;
-  return qt;
+  else if (second == QT_SECOND_OWN && countPart > 1 && countOwn > 1)
+  {
+    // Second best found in own hand and own and partner's suit
+    // length > 1
+    Step(st, QT_ONE | QT_MARK_SECOND);
+    if (countLho <= 2 && countRho <= 2 &&
+        (countOwn <= 2 || countPart <= 2))
+    {
+      Step(st, QT_MAX_LESS_2);
+      return;
+    }
+  }
+  else if (second == QT_SECOND_LHO)
+  {
+    st.end = QT_END_THIRD;
+    if (countOwn <= 2 && countLho <= 2 && countRho <= 2)
+      st.end |= QT_END_MORE;
+    return;
+  }
+  st.end = QT_END_SAME;
+}
+
+
+static int QuickTricksKey(
+  const pos& tpos,
+  const int hand,
+  const int suit,
+  const int countLho,
+  const int countRho,
+  const int countOwn,
+  const int countPart,
+  const int lhoTrumpRanks,
+  const int rhoTrumpRanks)
+{
+  const int sh = tpos.secondBest[suit].hand;
+  const int second = (sh < 0 ? QT_SECOND_OTHER : qtSecond[(sh - hand) & 3]);
+
+  return second |
+    (min(countLho, 3) << 2) |
+    (min(countRho, 3) << 4) |
+    (min(countOwn, 3) << 6) |
+    (min(countPart, 3) << 8) |
+    ((lhoTrumpRanks == 0 ? 1 : 0) << 10) |
+    ((rhoTrumpRanks == 0 ? 1 : 0) << 11);
 }
 
 
-int QuickTricksPartnerHandNT(
+static int FollowSteps(
+  const qtStepsType& st,
   const int hand,
   pos& tpos,
   const int cutoff,
   const int depth,
-  const int countLho,
-  const int countRho,
   const int countOwn,
   const int countPart,
   const int suit,
   const int qtricks,
   const int commSuit,
   const int commRank,
+  const bool dropTrumps,
+  int& lhoTrumpRanks,
+  int& rhoTrumpRanks,
   int& res,
   const ThreadData& thrd)
 {
+  /* res=0 Continue with same suit.
+     res=1 Cutoff.
+     res=2 Continue with next suit. */
+
   res = 1;
   int qt = qtricks;
+  unsigned short * wr = tpos.winRanks[depth];
 
-  tpos.winRanks[depth][suit] |=
-    bitMapRank[tpos.winner[suit].rank];
-
-  tpos.winRanks[depth][commSuit] |= bitMapRank[commRank];
-
-  qt++;
-  if (qt >= cutoff)
-    return qt;
-  if ((countLho <= 1) && (countRho <= 1) && (countOwn <= 1))
-  {
-    qt += countPart - 1;
-    if (qt >= cutoff)
-      return qt;
-    res = 2;
-    return qt;
-  }
-
-  if (tpos.secondBest[suit].hand == partner[hand])
+  for (int i = 0; i < st.noOfSteps; i++)
   {
-    /* Second best found in partners hand */
-    tpos.winRanks[depth][suit] |=
-      bitMapRank[tpos.secondBest[suit].rank];
-
-    qt++;
-    if (qt >= cutoff)
-      return qt;
-    if ((countLho <= 2) && (countRho <= 2) && (countOwn <= 2))
+    const int step = st.step[i];
+    if (step & QT_MARK_WINNER)
+      wr[suit] |= bitMapRank[tpos.winner[suit].rank];
+    if (step & QT_MARK_SECOND)
+      wr[suit] |= bitMapRank[tpos.secondBest[suit].rank];
+    if (step & QT_MARK_COMM)
+      wr[commSuit] |= bitMapRank[commRank];
+
+    switch (step & QT_AMOUNT)
     {
-      qt += countPart - 2;
-      if (qt >= cutoff)
-        return qt;
-      res = 2;
-      return qt;
+      case QT_ONE:
+        qt++;
+        break;
+      case QT_OWN_LESS_1:
+        qt += countOwn - 1;
+        break;
+      case QT_OWN_LESS_2:
+        qt += countOwn - 2;
+        break;
+      case QT_PART_LESS_1:
+        qt += countPart - 1;
+        break;
+      case QT_PART_LESS_2:
+        qt += countPart - 2;
+        break;
+      default:
+        qt += max(countOwn - 2, countPart - 2);
+        break;
     }
-  }
-  else if ((tpos.secondBest[suit].hand == hand)
-           && (countPart > 1) && (countOwn > 1))
-  {
-    /* Second best found in own hand and own and
-       partner's suit length > 1 */
-    tpos.winRanks[depth][suit] |=
-      bitMapRank[tpos.secondBest[suit].rank];
 
-    qt++;
     if (qt >= cutoff)
       return qt;
-    if ((countLho <= 2) &&
-        (countRho <= 2) &&
-        ((countOwn <= 2) || (countPart <= 2)))
+
+    if ((step & QT_DROP_TRUMPS) && dropTrumps)
     {
-      qt += max(countPart - 2, countOwn - 2);
-      if (qt >= cutoff)
-        return qt;
-      res = 2;
-      return qt;
+      lhoTrumpRanks = max(0, lhoTrumpRanks - 1);
+      rhoTrumpRanks = max(0, rhoTrumpRanks - 1);
     }
   }
-  else if ((suit == commSuit) &&
-           (tpos.secondBest[suit].hand == lho[hand]))
+
+  if ((st.end & 0x0f) != QT_END_THIRD)
+  {
+    res = st.end;
+    return qt;
+  }
+
+  // The third best card is partner's, so a second trick can be
+  // taken after crossing in the communication suit.
+  if (suit == commSuit)
   {
     unsigned short ranks = 0;
     for (int h = 0; h < DDS_HANDS; h++)
@@ -1075,15 +928,16 @@ int QuickTricksPartnerHandNT(
 
     if (thrd.rel[ranks].absRank[3][suit].hand == partner[hand])
     {
-      tpos.winRanks[depth][suit] |= bitMapRank[
+      wr[suit] |= bitMapRank[
         static_cast<int>(thrd.rel[ranks].absRank[3][suit].rank) ];
+      if (st.end & QT_END_COMM)
+        wr[commSuit] |= bitMapRank[commRank];
+
       qt++;
       if (qt >= cutoff)
         return qt;
-      if ((countOwn <= 2) && (countLho <= 2) && (countRho <= 2))
+      if (st.end & QT_END_MORE)
       {
-        // TODO: Is the fix to qt correct?
-        // qtricks += countPart - 2;
         qt += countPart - 2;
         if (qt >= cutoff)
           return qt;
@@ -14,6 +14,8 @@
 #include "Memory.h"
 
 
+void InitQuickTricks();
+
 int QuickTricks(
   pos& tpos,
   const int hand,
@@ -12,14 +12,61 @@
 #include <iomanip>
 #include <sstream>
 #include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
 
 #include "Scheduler.h"
 
 
+// CPU time of the calling thread where the platform has it, so that
+// loads are comparable even when threads outnumber cores.
+
+static long long ThreadMicros()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#else
+  return chrono::duration_cast<chrono::microseconds>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+static unsigned HashHands(
+  const deal& dl,
+  const int hFirst,
+  const int hStep)
+{
+  unsigned h = 0;
+  for (int hand = hFirst; hand < DDS_HANDS; hand += hStep)
+    for (int s = 0; s < DDS_SUITS; s++)
+      h = (h * 0x01000193) ^ (dl.remainCards[hand][s] >> 2);
+  return h;
+}
+
+
 Scheduler::Scheduler()
 {
   numThreads = 0;
   numHands = 0;
+  relatedMode = false;
+  relatedPair = -1;
+  stealMode = false;
+  stealing = false;
+  numSteals = 0;
+  modelMode = false;
+
+  runMode = DDS_RUN_SOLVE;
+  timedBoards = 0;
+  numDuplicates = 0;
+  dupRefs = nullptr;
+  modelUsed = false;
+  meanAbsLogError = 0.;
+  logCorrelation = 0.;
+  Scheduler::ResetModel();
 
   Scheduler::InitHighCards();
 
@@ -107,8 +154,14 @@ void Scheduler::Reset()
   {
     threadGroup[t] = -1;
     threadCurrGroup[t] = -1;
+    threadToHand[t] = -1;
+    threadHead[t] = -1;
+    threadBusy[t] = 0;
+    threadBoards[t] = 0;
   }
 
+  numSteals = 0;
+
   currGroup = -1;
 }
 
@@ -124,6 +177,15 @@ void Scheduler::RegisterThreads(
   threadGroup.resize(nu);
   threadCurrGroup.resize(nu);
   threadToHand.resize(nu);
+  threadHead.resize(nu);
+  threadMark.resize(nu);
+  threadBusy.resize(nu);
+  threadBoards.resize(nu);
+
+  queues.resize(nu);
+  for (unsigned t = 0; t < nu; t++)
+    if (! queues[t])
+      queues[t].reset(new queueType);
 
 #ifdef DDS_SCHEDULER
   timeThread.Init("Threads", numThreads);
@@ -144,13 +206,77 @@ void Scheduler::RegisterRun(
 }
 
 
+void Scheduler::RegisterRun(
+  const enum RunMode mode,
+  const boards& bds,
+  const vector<int>& crossrefs)
+{
+  dupRefs = &crossrefs;
+  Scheduler::RegisterRun(mode, bds);
+  dupRefs = nullptr;
+}
+
+
+bool Scheduler::SetRelated(const bool on)
+{
+  const bool old = relatedMode;
+  relatedMode = on;
+  return old;
+}
+
+
+bool Scheduler::SetStealing(const bool on)
+{
+  const bool old = stealMode;
+  stealMode = on;
+  return old;
+}
+
+
+bool Scheduler::SetModel(const bool on)
+{
+  const bool old = modelMode;
+  modelMode = on;
+  return old;
+}
+
+
+void Scheduler::GetStats(schedulerStats * statsp) const
+{
+  statsp->noOfThreads = min(numThreads, MAXNOOFSTATTHREADS);
+  statsp->noOfSteals = numSteals;
+  statsp->noOfTimedBoards = timedBoards;
+  statsp->noOfBoards = numHands;
+  statsp->noOfDuplicates = numDuplicates;
+  statsp->modelReady = (modelUsed ? 1 : 0);
+  statsp->meanAbsLogError = meanAbsLogError;
+  statsp->logCorrelation = logCorrelation;
+
+  for (unsigned t = 0; t < static_cast<unsigned>(statsp->noOfThreads); t++)
+  {
+    statsp->boards[t] = threadBoards[t];
+    statsp->busyMicros[t] = threadBusy[t];
+  }
+}
+
+
 void Scheduler::RegisterRun(
   const enum RunMode mode,
   const boards& bds)
 {
   Scheduler::Reset();
 
+  runMode = mode;
   numHands = bds.noOfBoards;
+  modelUsed = false;
+
+  // Related boards only pay off when the TT survives from one
+  // board to the next, which is the case for plain solving.
+
+  if (relatedMode && mode == DDS_RUN_SOLVE)
+    Scheduler::ChooseRelatedPair(bds);
+  else
+    relatedPair = -1;
 
   // First split the hands according to strain and hash key.
   // This will lead to a few random collisions as well.
@@ -162,7 +288,16 @@ void Scheduler::RegisterRun(
 
   Scheduler::FinetuneGroups();
 
+  if (relatedPair != -1)
+    Scheduler::OrderRelatedGroups();
+
   Scheduler::SortHands(mode);
+
+  // With one thread there is nobody to steal from.
+
+  stealing = (stealMode && numThreads > 1);
+  if (stealing)
+    Scheduler::SeedQueues();
 }
 
 
@@ -184,30 +319,63 @@ void Scheduler::MakeGroups(const boards& bds)
   deal const * dl;
   listType * lp;
 
+  numDuplicates = 0;
+
   for (int b = 0; b < numHands; b++)
   {
+    // Duplicates stay out of the groups, and out of the time model.
+    if (dupRefs != nullptr && (* dupRefs)[static_cast<unsigned>(b)] != -1)
+    {
+      hands[b].copied = true;
+      hands[b].selectFlag = 0;
+      hands[b].pred = 0.;
+      numDuplicates++;
+      continue;
+    }
+
     dl = &bds.deals[b];
 
     int strain = dl->trump;
+    int key;
 
-    unsigned dlXor =
-      dl->remainCards[0][0] ^
-      dl->remainCards[1][1] ^
-      dl->remainCards[2][2] ^
-      dl->remainCards[3][3];
-
-    int key = static_cast<int>(((dlXor >> 2) ^ (dlXor >> 6)) & 0x7f);
-
-    hands[b].spareKey = static_cast<int>(
-                          (dl->remainCards[1][0] << 17) ^
-                          (dl->remainCards[2][1] << 11) ^
-                          (dl->remainCards[3][2] << 5) ^
-                          (dl->remainCards[0][3] >> 2));
+    if (relatedPair == -1)
+    {
+      unsigned dlXor =
+        dl->remainCards[0][0] ^
+        dl->remainCards[1][1] ^
+        dl->remainCards[2][2] ^
+        dl->remainCards[3][3];
+
+      key = static_cast<int>(((dlXor >> 2) ^ (dlXor >> 6)) & 0x7f);
+
+      hands[b].spareKey = static_cast<int>(
+                            (dl->remainCards[1][0] << 17) ^
+                            (dl->remainCards[2][1] << 11) ^
+                            (dl->remainCards[3][2] << 5) ^
+                            (dl->remainCards[0][3] >> 2));
+    }
+    else
+    {
+      // Only the fixed partnership decides the group, so the
+      // other two hands may differ within it.
+      unsigned pairHash = HashHands(* dl, relatedPair, 2);
+
+      key = static_cast<int>(
+              ((pairHash >> 7) ^ (pairHash >> 14) ^ (pairHash >> 21))
+              & 0x7f);
+      hands[b].spareKey = static_cast<int>(pairHash & 0x7fffffff);
+    }
 
     for (int h = 0; h < DDS_HANDS; h++)
       for (int s = 0; s < DDS_SUITS; s++)
         hands[b].remainCards[h][s] = dl->remainCards[h][s];
 
+    int cards = 0;
+    for (int h = 0; h < DDS_HANDS; h++)
+      for (int s = 0; s < DDS_SUITS; s++)
+        cards += counttable[dl->remainCards[h][s] >> 2];
+
+    hands[b].tricks = (cards + 3) / 4;
     hands[b].NTflag = (strain == 4 ? 1 : 0);
     hands[b].first = dl->first;
     hands[b].strain = strain;
@@ -266,11 +434,7 @@ void Scheduler::FinetuneGroups()
       {
         // It is now extremely likely that it is a repeat hand,
         // but we have to be sure.
-        match = true;
-        for (int h = 0; h < DDS_HANDS && match; h++)
-          for (int s = 0; s < DDS_SUITS && match; s++)
-            if (hands[b1].remainCards[h][s] != hands[b2].remainCards[h][s])
-              match = false;
+        match = Scheduler::SameHand(b1, b2);
       }
 
       if (match)
@@ -391,9 +555,112 @@ void Scheduler::FinetuneGroups()
 }
 
 
+void Scheduler::ChooseRelatedPair(const boards& bds)
+{
+  // Use whichever partnership is shared by more boards. Ties go
+  // to N/S, as a declaring side is the usual fixed one.
+
+  vector<unsigned> keys(static_cast<unsigned>(numHands));
+  int distinct[2];
+
+  for (int p = 0; p < 2; p++)
+  {
+    for (int b = 0; b < numHands; b++)
+      keys[static_cast<unsigned>(b)] = HashHands(bds.deals[b], p, 2);
+
+    sort(keys.begin(), keys.end());
+    distinct[p] = static_cast<int>(
+      unique(keys.begin(), keys.end()) - keys.begin());
+  }
+
+  relatedPair = (distinct[1] < distinct[0] ? 1 : 0);
+}
+
+
+void Scheduler::OrderRelatedGroups()
+{
+  // Within a group, sort the deals by the other partnership's
+  // cards, a suit at a time. Identical deals end up next to each
+  // other, as GetNumber wants, and neighbours tend to share the
+  // layout of the first suits, so that SetDealTables has less to
+  // redo from one board to the next.
+
+  for (int g = 0; g < numGroups; g++)
+  {
+    listType * lp = &list[group[g].strain][group[g].hash];
+    if (lp->length < 3)
+      continue;
+
+    sortLen = 0;
+    for (int index = lp->first; index != -1; index = hands[index].next)
+    {
+      sortList[sortLen].number = index;
+      sortLen++;
+    }
+
+    sortType st;
+    for (int i = 1; i < sortLen; i++)
+    {
+      st = sortList[i];
+      int j = i;
+      for (; j && Scheduler::LayoutBefore(st.number,
+          sortList[j - 1].number); --j)
+        sortList[j] = sortList[j - 1];
+      sortList[j] = st;
+    }
+
+    lp->first = sortList[0].number;
+    lp->last = sortList[sortLen - 1].number;
+    for (int i = 0; i < sortLen - 1; i++)
+      hands[sortList[i].number].next = sortList[i + 1].number;
+    hands[lp->last].next = -1;
+  }
+}
+
+
+bool Scheduler::LayoutBefore(
+  const int hno1,
+  const int hno2) const
+{
+  const int other = 1 - relatedPair;
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    for (int h = other; h < DDS_HANDS; h += 2)
+    {
+      const unsigned c1 = hands[hno1].remainCards[h][s];
+      const unsigned c2 = hands[hno2].remainCards[h][s];
+      if (c1 != c2)
+        return c1 < c2;
+    }
+  }
+  return false;
+}
+
+
 bool Scheduler::SameHand(
   const int hno1,
   const int hno2) const
+{
+  // "Same" is about grouping, so in related mode only the fixed
+  // partnership is compared.
+
+  if (relatedPair != -1)
+  {
+    for (int h = relatedPair; h < DDS_HANDS; h += 2)
+      for (int s = 0; s < DDS_SUITS; s++)
+        if (hands[hno1].remainCards[h][s] != hands[hno2].remainCards[h][s])
+          return false;
+
+    return true;
+  }
+
+  return Scheduler::SameDeal(hno1, hno2);
+}
+
+
+bool Scheduler::SameDeal(
+  const int hno1,
+  const int hno2) const
 {
   for (int h = 0; h < DDS_HANDS; h++)
     for (int s = 0; s < DDS_SUITS; s++)
@@ -437,6 +704,19 @@ void Scheduler::SortSolve()
   handType * hp;
   int strain, key, index;
 
+  // The fitted times are in microseconds and the constants below
+  // are not, so the two must not be sorted against each other. The
+  // model only orders the batch if it is turned on and calibrated
+  // for every kind of strain in it.
+
+  bool present[2] = {false, false};
+  for (int g = 0; g < numGroups; g++)
+    present[group[g].strain == 4 ? 1 : 0] = true;
+
+  modelUsed = modelMode &&
+    (! present[0] || model[0].ready) &&
+    (! present[1] || model[1].ready);
+
   for (int g = 0; g < numGroups; g++)
   {
     strain = group[g].strain;
@@ -445,25 +725,27 @@ void Scheduler::SortSolve()
     index = lp->first;
     hp = &hands[index];
 
-    // Taking into account repeat times saves 1-2%.
+    // Once calibrated, the fitted time of every board is kept, the
+    // first one with a cold TT, so that FinishRun can score the model
+    // whether or not it was used. Exact duplicates never get here, so
+    // a board on the same deal and leader still differs in its
+    // current trick and is really solved, if quickly.
 
-    int repeatNo = 0;
-    int firstPrev = -1;
-    group[g].pred = 0;
-    do
+    double sum = 0.;
+    bool warm = false;
+    for (int i = index; i != -1; i = hands[i].next)
     {
-      // Skip complete duplicates, as we won't solve them again.
-      if (hands[index].first != firstPrev)
-      {
-        group[g].pred += SORT_SOLVE_TIMES[hp->NTflag][repeatNo];
-        if (repeatNo < 7)
-          repeatNo++;
-        firstPrev = hands[index].first;
-      }
+      hands[i].pred = (model[hp->NTflag].ready ?
+        Scheduler::ModelTime(i, warm) : 0.);
+      sum += hands[i].pred;
+      warm = true;
+    }
 
-      index = hands[index].next;
+    if (modelUsed)
+    {
+      group[g].pred = static_cast<int>(min(sum, 1.e9));
+      continue;
     }
-    while (index != -1);
 
     // Taking into account fanout saves 4-6%.
 
@@ -478,6 +760,22 @@ void Scheduler::SortSolve()
     else
       fanoutFactor = slist[3] * exp( (fanout - slist[1]) / slist[4] );
 
+    // Taking into account repeat times saves 1-2%. Complete
+    // duplicates were dropped before scheduling, so every board
+    // here is solved and gets its time.
+
+    int repeatNo = 0;
+    group[g].pred = 0;
+    do
+    {
+      group[g].pred += SORT_SOLVE_TIMES[hp->NTflag][repeatNo];
+      if (repeatNo < 7)
+        repeatNo++;
+
+      index = hands[index].next;
+    }
+    while (index != -1);
+
     group[g].pred = static_cast<int>(
       (fanoutFactor * static_cast<double>(group[g].pred)));
   }
@@ -721,6 +1019,13 @@ int Scheduler::Fanout(const deal& dl) const
 schedType Scheduler::GetNumber(const int thrId)
 {
   const unsigned tu = static_cast<unsigned>(thrId);
+
+  // A thread asks for its next board when it is done with the last.
+  Scheduler::ChargeTime(tu);
+
+  if (stealing)
+    return Scheduler::GetNumberStealing(thrId);
+
   int g = threadGroup[tu];
   listType * lp;
   schedType st;
@@ -767,6 +1072,8 @@ schedType Scheduler::GetNumber(const int thrId)
   st.number = lp->first;
   lp->first = hands[lp->first].next;
 
+  st.related = (relatedPair != -1 && group[g].repeatNo > 0);
+
   if (group[g].repeatNo == 0)
   {
     group[g].head = st.number;
@@ -776,6 +1083,15 @@ schedType Scheduler::GetNumber(const int thrId)
     hands[st.number].selectFlag =
       (hands[st.number].strain == 4 ? 1 : 0);
   }
+  else if (relatedPair != -1 &&
+    ! Scheduler::SameDeal(st.number, group[g].head))
+  {
+    // A different deal for the same partnership. It becomes the
+    // head for any repeats of itself, which follow it directly.
+    group[g].head = st.number;
+    st.repeatOf = -1;
+    hands[st.number].selectFlag = 0;
+  }
   else
   {
     st.repeatOf = group[g].head;
@@ -789,6 +1105,7 @@ schedType Scheduler::GetNumber(const int thrId)
       hands[st.number].selectFlag = 0;
   }
 
+  Scheduler::MarkBoard(st.number, group[g].repeatNo > 0, st.repeatOf);
   hands[st.number].repeatNo = group[g].repeatNo++;
 
   threadToHand[tu] = st.number;
@@ -800,6 +1117,371 @@ schedType Scheduler::GetNumber(const int thrId)
 }
 
 
+void Scheduler::ChargeTime(const unsigned tu)
+{
+  const long long now = ThreadMicros();
+  const int b = threadToHand[tu];
+
+  if (b != -1)
+  {
+    hands[b].actual = now - threadMark[tu];
+    threadBusy[tu] += hands[b].actual;
+    threadBoards[tu]++;
+    threadToHand[tu] = -1;
+  }
+
+  threadMark[tu] = now;
+}
+
+
+void Scheduler::SeedQueues()
+{
+  // Groups arrive sorted by decreasing predicted time. Each goes
+  // whole to the queue with the least predicted time so far, so the
+  // queues start out balanced and groups keep their TT locality.
+
+  for (unsigned t = 0; t < static_cast<unsigned>(numThreads); t++)
+  {
+    queues[t]->front = 0;
+    queues[t]->back = 0;
+    queues[t]->load = 0;
+  }
+
+  for (int g = 0; g < numGroups; g++)
+  {
+    unsigned best = 0;
+    for (unsigned t = 1; t < static_cast<unsigned>(numThreads); t++)
+      if (queues[t]->load < queues[best]->load)
+        best = t;
+
+    queueType * qp = queues[best].get();
+    listType * lp = &list[group[g].strain][group[g].hash];
+
+    long long share = group[g].pred / lp->length;
+    long long rest = group[g].pred - share * lp->length;
+
+    for (int index = lp->first; index != -1; index = hands[index].next)
+    {
+      hands[index].groupNo = g;
+      hands[index].weight = share + rest;
+      rest = 0;
+      qp->boards[qp->back++] = index;
+    }
+    qp->load += group[g].pred;
+  }
+}
+
+
+int Scheduler::PopQueue(const unsigned tu)
+{
+  queueType * qp = queues[tu].get();
+  lock_guard<mutex> guard(qp->lock);
+
+  if (qp->front == qp->back)
+    return -1;
+
+  const int b = qp->boards[qp->front++];
+  qp->load -= hands[b].weight;
+  return b;
+}
+
+
+int Scheduler::StealQueue(const unsigned tu)
+{
+  int stolen[MAXNOOFBOARDS];
+
+  while (1)
+  {
+    // Find the heaviest queue.
+    int victim = -1;
+    long long most = -1;
+
+    for (unsigned t = 0; t < static_cast<unsigned>(numThreads); t++)
+    {
+      if (t == tu)
+        continue;
+
+      queueType * qp = queues[t].get();
+      lock_guard<mutex> guard(qp->lock);
+      if (qp->back > qp->front && qp->load > most)
+      {
+        victim = static_cast<int>(t);
+        most = qp->load;
+      }
+    }
+
+    if (victim == -1)
+      return -1;
+
+    // Take the back half, which is the cheapest end. Our own queue
+    // is only locked afterwards, so two thieves cannot deadlock.
+
+    int n;
+    long long load = 0;
+    {
+      queueType * qp = queues[static_cast<unsigned>(victim)].get();
+      lock_guard<mutex> guard(qp->lock);
+
+      n = (qp->back - qp->front + 1) / 2;
+      qp->back -= n;
+      for (int i = 0; i < n; i++)
+      {
+        stolen[i] = qp->boards[qp->back + i];
+        load += hands[stolen[i]].weight;
+      }
+      qp->load -= load;
+    }
+
+    if (n == 0)
+      continue;
+
+    numSteals++;
+
+    {
+      queueType * qp = queues[tu].get();
+      lock_guard<mutex> guard(qp->lock);
+
+      for (int i = 0; i < n; i++)
+        qp->boards[i] = stolen[i];
+      qp->front = 0;
+      qp->back = n;
+      qp->load = load;
+    }
+
+    // Another thief may get here first, in which case look again.
+    const int b = Scheduler::PopQueue(tu);
+    if (b != -1)
+      return b;
+  }
+}
+
+
+schedType Scheduler::GetNumberStealing(const int thrId)
+{
+  const unsigned tu = static_cast<unsigned>(thrId);
+  schedType st;
+
+  int b = Scheduler::PopQueue(tu);
+  if (b == -1)
+    b = Scheduler::StealQueue(tu);
+
+  st.number = b;
+  st.repeatOf = -1;
+  st.related = false;
+
+  if (b == -1)
+    return st;
+
+  // Repeats and related boards are only used within one thread's
+  // run of a group, as in GetNumber.
+
+  const int g = hands[b].groupNo;
+  const bool warm = (g == threadCurrGroup[tu]);
+  if (! warm)
+  {
+    threadCurrGroup[tu] = g;
+    threadHead[tu] = b;
+    hands[b].selectFlag = (hands[b].strain == 4 ? 1 : 0);
+  }
+  else if (relatedPair != -1 && ! Scheduler::SameDeal(b, threadHead[tu]))
+  {
+    threadHead[tu] = b;
+    st.related = true;
+    hands[b].selectFlag = 0;
+  }
+  else
+  {
+    st.repeatOf = threadHead[tu];
+    st.related = (relatedPair != -1);
+    hands[b].selectFlag = 0;
+  }
+
+  Scheduler::MarkBoard(b, warm, st.repeatOf);
+  threadToHand[tu] = b;
+  return st;
+}
+
+
+void Scheduler::MarkBoard(
+  const int b,
+  const bool warm,
+  const int repeatOf)
+{
+  // Mirrors the copy test in CalcChunkCommon, so that copies do
+  // not count as solve times. Solve runs drop their duplicates
+  // before scheduling, so every board handed out is solved.
+  hands[b].warm = warm;
+  hands[b].copied = (runMode == DDS_RUN_CALC && repeatOf != -1);
+}
+
+
+void Scheduler::ResetModel()
+{
+  for (int nt = 0; nt < 2; nt++)
+  {
+    modelType& m = model[nt];
+    for (int i = 0; i < MODEL_FEATURES; i++)
+    {
+      for (int j = 0; j < MODEL_FEATURES; j++)
+        m.xtx[i][j] = 0.;
+      m.xty[i] = 0.;
+      m.coef[i] = 0.;
+    }
+    m.samples = 0.;
+    m.ready = false;
+  }
+}
+
+
+void Scheduler::Features(
+  const int b,
+  const bool warm,
+  double x[]) const
+{
+  x[0] = 1.;
+  x[1] = static_cast<double>(hands[b].tricks);
+  x[2] = hands[b].fanout / 10.;
+  x[3] = (warm ? 1. : 0.);
+}
+
+
+double Scheduler::ModelTime(
+  const int b,
+  const bool warm) const
+{
+  const modelType& m = model[hands[b].NTflag];
+  double x[MODEL_FEATURES];
+  Scheduler::Features(b, warm, x);
+
+  double y = 0.;
+  for (int i = 0; i < MODEL_FEATURES; i++)
+    y += m.coef[i] * x[i];
+
+  // Keep a wild extrapolation from overflowing the group sums.
+  return exp(min(y, 20.));
+}
+
+
+// Each sample is worth this much less for every later sample, so
+// the fit mostly reflects the last thousand boards or so.
+#define MODEL_DECAY 0.999
+
+// Samples of a kind before the fit replaces the constants.
+#define MODEL_MIN_SAMPLES 40.
+
+void Scheduler::FitModel(modelType& m)
+{
+  // Solve (X'X + lambda I) c = X'y by Gaussian elimination. The
+  // small ridge term keeps the system solvable while a feature
+  // has not varied yet, for instance with only cold boards.
+
+  double a[MODEL_FEATURES][MODEL_FEATURES + 1];
+  for (int i = 0; i < MODEL_FEATURES; i++)
+  {
+    for (int j = 0; j < MODEL_FEATURES; j++)
+      a[i][j] = m.xtx[i][j] + (i == j ? 1.e-3 * (m.samples + 1.) : 0.);
+    a[i][MODEL_FEATURES] = m.xty[i];
+  }
+
+  for (int col = 0; col < MODEL_FEATURES; col++)
+  {
+    int piv = col;
+    for (int r = col + 1; r < MODEL_FEATURES; r++)
+      if (fabs(a[r][col]) > fabs(a[piv][col]))
+        piv = r;
+    if (fabs(a[piv][col]) < 1.e-12)
+      return;
+
+    for (int j = 0; j <= MODEL_FEATURES; j++)
+      swap(a[col][j], a[piv][j]);
+
+    for (int r = 0; r < MODEL_FEATURES; r++)
+    {
+      if (r == col)
+        continue;
+      const double f = a[r][col] / a[col][col];
+      for (int j = col; j <= MODEL_FEATURES; j++)
+        a[r][j] -= f * a[col][j];
+    }
+  }
+
+  for (int i = 0; i < MODEL_FEATURES; i++)
+    m.coef[i] = a[i][MODEL_FEATURES] / a[i][i];
+
+  m.ready = (m.samples >= MODEL_MIN_SAMPLES);
+}
+
+
+void Scheduler::FinishRun()
+{
+  if (runMode != DDS_RUN_SOLVE)
+    return;
+
+  // First score the model's predictions for this batch, which are
+  // the only ones in microseconds.
+
+  double sumAbs = 0., sp = 0., sa = 0., spp = 0., saa = 0., spa = 0.;
+  int n = 0;
+
+  for (int b = 0; b < numHands; b++)
+  {
+    const handType& h = hands[b];
+    if (h.copied || h.pred <= 0.)
+      continue;
+
+    const double lp = log(h.pred);
+    const double la = log(static_cast<double>(max(h.actual, 1LL)));
+    sumAbs += fabs(lp - la);
+    sp += lp;
+    sa += la;
+    spp += lp * lp;
+    saa += la * la;
+    spa += lp * la;
+    n++;
+  }
+
+  timedBoards = n;
+  meanAbsLogError = (n > 0 ? sumAbs / n : 0.);
+
+  logCorrelation = 0.;
+  if (n > 1)
+  {
+    const double vp = spp - sp * sp / n;
+    const double va = saa - sa * sa / n;
+    if (vp > 0. && va > 0.)
+      logCorrelation = (spa - sp * sa / n) / sqrt(vp * va);
+  }
+
+  // Then learn from the times.
+
+  bool seen[2] = {false, false};
+  for (int b = 0; b < numHands; b++)
+  {
+    const handType& h = hands[b];
+    if (h.copied)
+      continue;
+
+    modelType& m = model[h.NTflag];
+    double x[MODEL_FEATURES];
+    Scheduler::Features(b, h.warm, x);
+    const double y = log(static_cast<double>(max(h.actual, 1LL)));
+
+    for (int i = 0; i < MODEL_FEATURES; i++)
+    {
+      for (int j = 0; j < MODEL_FEATURES; j++)
+        m.xtx[i][j] = MODEL_DECAY * m.xtx[i][j] + x[i] * x[j];
+      m.xty[i] = MODEL_DECAY * m.xty[i] + x[i] * y;
+    }
+    m.samples = MODEL_DECAY * m.samples + 1.;
+    seen[h.NTflag] = true;
+  }
+
+  for (int nt = 0; nt < 2; nt++)
+    if (seen[nt])
+      Scheduler::FitModel(model[nt]);
+}
+
+
 int Scheduler::NumGroups() const
 {
   return numGroups;
@@ -11,6 +11,8 @@
 #define DDS_SCHEDULER_H
 
 #include <atomic>
+#include <memory>
+#include <mutex>
 
 #include "dds.h"
 #include "TimeStatList.h"
@@ -20,6 +22,10 @@ using namespace std;
 
 #define HASH_MAX 200
 
+// Features of the online solve-time model: constant, tricks left,
+// fanout / 10, and whether the thread's TT is warm from the group.
+#define MODEL_FEATURES 4
+
 #ifdef DDS_SCHEDULER
   #define START_BLOCK_TIMER scheduler.StartBlockTimer()
   #define END_BLOCK_TIMER scheduler.EndBlockTimer()
@@ -37,6 +43,7 @@ struct schedType
 {
   int number;
   int repeatOf;
+  bool related; // Same partnership as the thread's previous board
 };
 
 
@@ -82,6 +89,47 @@ class Scheduler
       int thread;
       int selectFlag;
       int time;
+      int groupNo;
+      long long weight;
+      long long actual;
+      int tricks;
+      bool warm;
+      bool copied;
+      double pred;
+    };
+
+    // Least-squares fit of log(microseconds) on the features, one
+    // per suit/NT. Older batches are decayed so the fit follows the
+    // deals actually being solved.
+    struct modelType
+    {
+      double xtx[MODEL_FEATURES][MODEL_FEATURES];
+      double xty[MODEL_FEATURES];
+      double coef[MODEL_FEATURES];
+      double samples;
+      bool ready;
+    };
+
+    modelType model[2];
+    enum RunMode runMode;
+
+    int timedBoards;
+    int numDuplicates;
+    vector<int> const * dupRefs;
+    bool modelUsed;
+    double meanAbsLogError;
+    double logCorrelation;
+
+    // In work-stealing mode each thread owns a queue of boards. The
+    // owner takes from the front, and idle threads steal from the
+    // back of the queue with the most predicted time left.
+    struct queueType
+    {
+      mutex lock;
+      int boards[MAXNOOFBOARDS];
+      int front;
+      int back;
+      long long load;
     };
 
     handType hands[MAXNOOFBOARDS];
@@ -100,10 +148,30 @@ class Scheduler
     vector<int> threadGroup;
     vector<int> threadCurrGroup;
     vector<int> threadToHand;
+    vector<int> threadHead;
+
+    bool stealMode;
+    bool stealing;
+
+    // Whether the fitted model may order the batches, and whether it
+    // ordered the current one.
+    bool modelMode;
+    vector<unique_ptr<queueType>> queues;
+    atomic<int> numSteals;
+
+    // Thread CPU time at the start of each thread's current board.
+    vector<long long> threadMark;
+    vector<long long> threadBusy;
+    vector<int> threadBoards;
 
     int numThreads;
     int numHands;
 
+    // In related mode, boards are grouped by the cards of one
+    // partnership only (0 is N/S, 1 is E/W), or -1 when off.
+    bool relatedMode;
+    int relatedPair;
+
     vector<int> highCards;
 
     void InitHighCards();
@@ -122,10 +190,50 @@ class Scheduler
 
     void FinetuneGroups();
 
+    void ChooseRelatedPair(const boards& bds);
+
+    void OrderRelatedGroups();
+
+    void SeedQueues();
+
+    int PopQueue(const unsigned tu);
+
+    int StealQueue(const unsigned tu);
+
+    schedType GetNumberStealing(const int thrId);
+
+    void MarkBoard(
+      const int b,
+      const bool warm,
+      const int repeatOf);
+
+    void Features(
+      const int b,
+      const bool warm,
+      double x[]) const;
+
+    double ModelTime(
+      const int b,
+      const bool warm) const;
+
+    void FitModel(modelType& m);
+
+    void ChargeTime(const unsigned tu);
+
     bool SameHand(
       const int hno1,
       const int hno2) const;
 
+    bool SameDeal(
+      const int hno1,
+      const int hno2) const;
+
+    // Orders deals by the cards of the partnership other than
+    // relatedPair, suit by suit.
+    bool LayoutBefore(
+      const int hno1,
+      const int hno2) const;
+
     void SortSolve(),
          SortCalc(),
          SortTrace();
@@ -167,6 +275,18 @@ class Scheduler
     void RegisterThreads(
       const int n);
 
+    bool SetRelated(const bool on);
+
+    bool SetStealing(const bool on);
+
+    bool SetModel(const bool on);
+
+    void GetStats(schedulerStats * statsp) const;
+
+    void FinishRun();
+
+    void ResetModel();
+
     void RegisterRun(
       const enum RunMode mode,
       const boards& bds,
@@ -176,6 +296,13 @@ class Scheduler
       const enum RunMode mode,
       const boards& bds);
 
+    // Boards with crossrefs[b] != -1 are copies of another board
+    // and are never handed out.
+    void RegisterRun(
+      const enum RunMode mode,
+      const boards& bds,
+      const vector<int>& crossrefs);
+
     schedType GetNumber(const int thrId);
 
     int NumGroups() const;
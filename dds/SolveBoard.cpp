@@ -8,6 +8,10 @@
 */
 
 
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
 #include "SolverIF.h"
 #include "SolveBoard.h"
 #include "System.h"
@@ -19,6 +23,16 @@
 
 paramType param;
 
+// Set by SetSolveLimits, and applied to every batch. The deadline
+// is for the current batch.
+static int limitMillis = 0;
+static int limitNodes = 0;
+static chrono::steady_clock::time_point limitDeadline;
+static solveBounds bounds;
+
+static bool telemetryOn = false;
+static solveTelemetry telemetry;
+
 extern System sysdep;
 extern Memory memory;
 extern Scheduler scheduler;
@@ -32,12 +46,56 @@ bool SameBoard(
   const unsigned index1,
   const unsigned index2);
 
+unsigned long long HashBoard(
+  const boards& bds,
+  const unsigned index);
+
+int BoardRangeChecks(
+  const deal& dl,
+  const int target,
+  const int solutions,
+  const int mode);
+
+struct splitMoveType
+{
+  // The root score is base + sign * (child score).
+  int base;
+  int sign;
+  int childTricks;
+
+  // -1 if the move needs no search, otherwise its board in the batch.
+  int board;
+  bool reached;
+
+  int winBit[DDS_SUITS];
+};
+
+void SplitPlayCard(
+  const deal& dl,
+  const int suit,
+  const int rank,
+  deal& child,
+  splitMoveType& sm);
+
+void SetBounds(
+  const int bno,
+  const futureTricks& fut,
+  ThreadData const * thrp);
+
 
 void SolveSingleCommon(
   const int thrId,
   const int bno)
 {
   futureTricks fut;
+  ThreadData * thrp = memory.GetPtr(static_cast<unsigned>(thrId));
+  thrp->nodeLimit = limitNodes;
+  thrp->timeLimited = (limitMillis > 0);
+  thrp->deadline = limitDeadline;
+
+  chrono::steady_clock::time_point t0;
+  if (telemetryOn)
+    t0 = chrono::steady_clock::now();
 
   START_THREAD_TIMER(thrId);
   int res = SolveBoard(
@@ -50,9 +108,80 @@ void SolveSingleCommon(
   END_THREAD_TIMER(thrId);
 
   if (res == 1)
+  {
     param.solvedp->solvedBoard[bno] = fut;
+    SetBounds(bno, fut, thrp);
+  }
   else
     param.error = res;
+
+  if (telemetryOn)
+  {
+    telemetry.nodes[bno] = thrp->trickNodes;
+    telemetry.ttHits[bno] = thrp->ttHits;
+    telemetry.ttMisses[bno] = thrp->ttMisses;
+    telemetry.micros[bno] = static_cast<int>(
+      chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - t0).count());
+    telemetry.thread[bno] = thrId;
+    telemetry.memoryKB[bno] = static_cast<int>(thrp->memUsed);
+  }
+
+  // Solves outside the batch, such as SolveBoard, have no limits.
+  thrp->nodeLimit = 0;
+  thrp->timeLimited = false;
+  thrp->limitNodes = 0;
+  thrp->limitHit = false;
+}
+
+
+void SetBounds(
+  const int bno,
+  const futureTricks& fut,
+  ThreadData const * thrp)
+{
+  const deal& dl = param.bop->deals[bno];
+  const int target = param.bop->target[bno];
+  const int solutions = param.bop->solutions[bno];
+
+  int cards = 0;
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      cards += counttable[dl.remainCards[h][s] >> 2];
+  const int tricks = (cards + 3) >> 2;
+
+  int lower, upper;
+  if (thrp->limitHit)
+  {
+    lower = thrp->boundLower;
+    upper = thrp->boundUpper;
+  }
+  else if (fut.score[0] == -2 || (target == 0 && solutions < 3))
+  {
+    // No score, only cards.
+    lower = 0;
+    upper = tricks;
+  }
+  else if (target == -1 || solutions == 3)
+  {
+    lower = fut.score[0];
+    upper = fut.score[0];
+  }
+  else if (fut.cards > 0 && fut.score[0] >= target)
+  {
+    lower = target;
+    upper = tricks;
+  }
+  else
+  {
+    // Either no trick at all, or -1 for fewer than the target.
+    lower = 0;
+    upper = (fut.score[0] == -1 ? target - 1 : 0);
+  }
+
+  bounds.complete[bno] = (thrp->limitHit ? 0 : 1);
+  bounds.lower[bno] = lower;
+  bounds.upper[bno] = upper;
 }
 
 
@@ -63,10 +192,23 @@ void CopySolveSingle(const vector<int>& crossrefs)
     if (crossrefs[i] == -1)
       continue;
 
-    START_THREAD_TIMER(thrId);
     param.solvedp->solvedBoard[i] = 
       param.solvedp->solvedBoard[crossrefs[i]];
-    END_THREAD_TIMER(thrId);
+
+    const int j = crossrefs[i];
+    bounds.complete[i] = bounds.complete[j];
+    bounds.lower[i] = bounds.lower[j];
+    bounds.upper[i] = bounds.upper[j];
+
+    if (telemetryOn)
+    {
+      telemetry.nodes[i] = telemetry.nodes[j];
+      telemetry.ttHits[i] = telemetry.ttHits[j];
+      telemetry.ttMisses[i] = telemetry.ttMisses[j];
+      telemetry.micros[i] = telemetry.micros[j];
+      telemetry.thread[i] = telemetry.thread[j];
+      telemetry.memoryKB[i] = telemetry.memoryKB[j];
+    }
   }
 }
 
@@ -84,25 +226,13 @@ void SolveChunkCommon(
     if (index == -1)
       break;
 
-    // This is not a perfect repeat detector, as the hands in
-    // a group might have declarers N, S, N, N. Then the second
-    // N would not reuse the first N. However, must reuses are
-    // reasonably adjacent, and this is just an optimization anyway.
+    // Exact repeats never get here, as SolveAllBoardsN takes them
+    // out before the run and copies their results afterwards.
+    // Repeats of the deal with another leader or target are solved,
+    // but on the same thread, so the TT carries over.
 
-    if (st.repeatOf != -1 &&
-        param.bop->deals[index ].first ==
-        param.bop->deals[st.repeatOf].first)
-    {
-      START_THREAD_TIMER(thrId);
-      param.solvedp->solvedBoard[index] = 
-        param.solvedp->solvedBoard[st.repeatOf];
-      END_THREAD_TIMER(thrId);
-      continue;
-    }
-    else
-    {
-      SolveSingleCommon(thrId, index);
-    }
+    memory.GetPtr(static_cast<unsigned>(thrId))->relatedDeal = st.related;
+    SolveSingleCommon(thrId, index);
   }
 }
 
@@ -120,12 +250,22 @@ int SolveAllBoardsN(
   param.solvedp = &solved;
   param.noOfBoards = bds.noOfBoards;
 
-  scheduler.RegisterRun(DDS_RUN_SOLVE, bds);
-  sysdep.RegisterRun(DDS_RUN_SOLVE, bds);
+  // Only the first of a set of identical boards is solved.
+  vector<int> uniques;
+  vector<int> crossrefs;
+  DetectSolveDuplicates(bds, uniques, crossrefs);
+
+  scheduler.RegisterRun(DDS_RUN_SOLVE, bds, crossrefs);
+  sysdep.RegisterRun(DDS_RUN_SOLVE, bds, crossrefs);
 
   for (int k = 0; k < MAXNOOFBOARDS; k++)
     solved.solvedBoard[k].cards = 0;
 
+  bounds.noOfBoards = bds.noOfBoards;
+  telemetry.noOfBoards = (telemetryOn ? bds.noOfBoards : 0);
+  limitDeadline = chrono::steady_clock::now() +
+    chrono::milliseconds(limitMillis);
+
   START_BLOCK_TIMER;
   int retRun = sysdep.RunThreads();
   END_BLOCK_TIMER;
@@ -133,6 +273,10 @@ int SolveAllBoardsN(
   if (retRun != RETURN_NO_FAULT)
     return retRun;
 
+  CopySolveSingle(crossrefs);
+
+  scheduler.FinishRun();
+
   solved.noOfBoards = param.noOfBoards;
 
 #ifdef DDS_SCHEDULER 
@@ -171,6 +315,270 @@ int STDCALL SolveBoardPBN(
 }
 
 
+int STDCALL SolveBoardSplitPBN(
+  dealPBN dlpbn, 
+  int target,
+  int solutions, 
+  int mode, 
+  futureTricks * futp)
+{
+  deal dl;
+  if (ConvertFromPBN(dlpbn.remainCards, dl.remainCards) != RETURN_NO_FAULT)
+    return RETURN_PBN_FAULT;
+
+  for (int k = 0; k <= 2; k++)
+  {
+    dl.currentTrickRank[k] = dlpbn.currentTrickRank[k];
+    dl.currentTrickSuit[k] = dlpbn.currentTrickSuit[k];
+  }
+  dl.first = dlpbn.first;
+  dl.trump = dlpbn.trump;
+
+  return SolveBoardSplit(dl, target, solutions, mode, futp);
+}
+
+
+int STDCALL SolveBoardSplit(
+  deal dl,
+  int target,
+  int solutions,
+  int mode,
+  futureTricks * futp)
+{
+  // Each root move is played out and the resulting positions are
+  // solved as one batch, so that the threads share the root. The
+  // children are solved from scratch, each on the thread that the
+  // scheduler gives it, so the total work is higher than for a
+  // serial solve, which reuses its TT from one move to the next.
+
+  int ret = BoardRangeChecks(dl, target, solutions, mode);
+  if (ret != RETURN_NO_FAULT)
+    return ret;
+
+  if (target == 0 && solutions < 3)
+    return SolveBoard(dl, target, solutions, mode, futp, 0);
+
+  // Target 0 only generates the moves, and checks the deal.
+  futureTricks moves;
+  ret = SolveBoard(dl, 0, 2, 1, &moves, 0);
+  if (ret != RETURN_NO_FAULT)
+    return ret;
+
+  if (moves.cards < 2)
+    return SolveBoard(dl, target, solutions, mode, futp, 0);
+
+  const bool exact = (target == -1 || solutions == 3);
+
+  boards bo;
+  solvedBoards solved;
+  splitMoveType sm[13];
+  bo.noOfBoards = 0;
+
+  for (int m = 0; m < moves.cards; m++)
+  {
+    deal child;
+    SplitPlayCard(dl, moves.suit[m], moves.rank[m], child, sm[m]);
+
+    // With a target, the child only has to reach the target that
+    // makes the root move reach its own, and some need no search.
+    int childTarget = -1;
+    if (! exact)
+    {
+      childTarget = (sm[m].sign > 0 ? target - sm[m].base :
+        sm[m].base - target + 1);
+
+      if (childTarget <= 0 || childTarget > sm[m].childTricks)
+      {
+        const bool childReached = (childTarget <= 0);
+        sm[m].reached = (sm[m].sign > 0 ? childReached : ! childReached);
+        sm[m].board = -1;
+        continue;
+      }
+    }
+
+    const int b = bo.noOfBoards++;
+    bo.deals[b] = child;
+    bo.target[b] = childTarget;
+    bo.solutions[b] = 1;
+    bo.mode[b] = 1;
+    sm[m].board = b;
+  }
+
+  if (bo.noOfBoards > 0)
+  {
+    // The children are parts of one answer, so none may be cut short.
+    const int oldMillis = limitMillis;
+    const int oldNodes = limitNodes;
+    limitMillis = 0;
+    limitNodes = 0;
+    ret = SolveAllBoardsBin(&bo, &solved);
+    limitMillis = oldMillis;
+    limitNodes = oldNodes;
+    if (ret != RETURN_NO_FAULT)
+      return ret;
+  }
+
+  int score[13], order[13];
+  int nodes = 0;
+
+  for (int m = 0; m < moves.cards; m++)
+  {
+    order[m] = m;
+    if (sm[m].board == -1)
+      continue;
+
+    const futureTricks& cf = solved.solvedBoard[sm[m].board];
+    nodes += cf.nodes;
+
+    if (exact)
+      score[m] = sm[m].base + sm[m].sign * cf.score[0];
+    else
+    {
+      // The last trick comes back with one card and its real score
+      // whatever the target.
+      const bool childReached = 
+        (cf.cards > 0 && cf.score[0] >= bo.target[sm[m].board]);
+      sm[m].reached = (sm[m].sign > 0 ? childReached : ! childReached);
+    }
+
+    for (int s = 0; s < DDS_SUITS; s++)
+      sm[m].winBit[s] |= (cf.cards > 0 ? cf.winRanks[0][s] : 0);
+  }
+
+  int n = 0;
+  if (exact)
+  {
+    stable_sort(order, order + moves.cards, [&score](int a, int b)
+    {
+      return score[a] > score[b];
+    });
+
+    if (solutions == 3)
+      n = moves.cards;
+    else if (solutions == 1)
+      n = 1;
+    else
+      while (n < moves.cards && score[order[n]] == score[order[0]])
+        n++;
+  }
+  else
+  {
+    for (int m = 0; m < moves.cards; m++)
+    {
+      if (sm[m].reached)
+      {
+        score[m] = target;
+        order[n++] = m;
+      }
+    }
+    if (solutions == 1 && n > 1)
+      n = 1;
+  }
+
+  futp->nodes = nodes;
+  futp->cards = n;
+  for (int i = 0; i < n; i++)
+  {
+    const int m = order[i];
+    futp->suit[i] = moves.suit[m];
+    futp->rank[i] = moves.rank[m];
+    futp->equals[i] = moves.equals[m];
+    futp->score[i] = score[m];
+    for (int s = 0; s < DDS_SUITS; s++)
+      futp->winRanks[i][s] = sm[m].winBit[s];
+  }
+
+  if (n == 0)
+    futp->score[0] = (target > 1 ? -1 : 0);
+
+  return RETURN_NO_FAULT;
+}
+
+
+void SplitPlayCard(
+  const deal& dl,
+  const int suit,
+  const int rank,
+  deal& child,
+  splitMoveType& sm)
+{
+  int cardCount = 0;
+  for (int h = 0; h < DDS_HANDS; h++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      cardCount += counttable[dl.remainCards[h][s] >> 2];
+
+  const int handRelFirst = (48 - (cardCount - 4)) % 4;
+  const int handToPlay = handId(dl.first, handRelFirst);
+  int tricks = 0;
+  for (int s = 0; s < DDS_SUITS; s++)
+    tricks += counttable[dl.remainCards[handToPlay][s] >> 2];
+
+  child = dl;
+  child.remainCards[handToPlay][suit] &= ~(1u << rank);
+
+  for (int s = 0; s < DDS_SUITS; s++)
+    sm.winBit[s] = 0;
+
+  if (handRelFirst < 3)
+  {
+    // The next hand has not played to the trick either, and it is
+    // on the other side.
+    child.currentTrickSuit[handRelFirst] = suit;
+    child.currentTrickRank[handRelFirst] = rank;
+    sm.base = tricks;
+    sm.sign = -1;
+    sm.childTricks = tricks;
+    return;
+  }
+
+  int suits[DDS_HANDS], ranks[DDS_HANDS];
+  for (int k = 0; k < 3; k++)
+  {
+    suits[k] = dl.currentTrickSuit[k];
+    ranks[k] = dl.currentTrickRank[k];
+  }
+  suits[3] = suit;
+  ranks[3] = rank;
+
+  int win = 0;
+  for (int k = 1; k < DDS_HANDS; k++)
+  {
+    if (suits[k] == suits[win])
+    {
+      if (ranks[k] > ranks[win])
+        win = k;
+    }
+    else if (suits[k] == dl.trump)
+      win = k;
+  }
+
+  // The winning rank only matters if it beat another card in its suit.
+  for (int k = 0; k < DDS_HANDS; k++)
+    if (k != win && suits[k] == suits[win])
+      sm.winBit[suits[win]] = 1 << ranks[win];
+
+  const int winner = handId(dl.first, win);
+  child.first = winner;
+  for (int k = 0; k < 3; k++)
+  {
+    child.currentTrickSuit[k] = 0;
+    child.currentTrickRank[k] = 0;
+  }
+
+  sm.childTricks = tricks - 1;
+  if ((winner & 1) == (handToPlay & 1))
+  {
+    sm.base = 1;
+    sm.sign = 1;
+  }
+  else
+  {
+    sm.base = tricks - 1;
+    sm.sign = -1;
+  }
+}
+
+
 int STDCALL SolveAllBoards(
   boardsPBN * bop, 
   solvedBoards * solvedp)
@@ -251,32 +659,112 @@ int STDCALL SolveAllChunksBin(
 }
 
 
+void STDCALL SetSolveLimits(
+  int milliseconds,
+  int nodes)
+{
+  limitMillis = max(0, milliseconds);
+  limitNodes = max(0, nodes);
+}
+
+
+void STDCALL GetSolveLimits(
+  int * milliseconds,
+  int * nodes)
+{
+  * milliseconds = limitMillis;
+  * nodes = limitNodes;
+}
+
+
+void STDCALL GetSolveBounds(
+  solveBounds * boundsp)
+{
+  * boundsp = bounds;
+}
+
+
+int STDCALL SetSolveTelemetry(
+  int on)
+{
+  const bool old = telemetryOn;
+  telemetryOn = (on != 0);
+  return old ? 1 : 0;
+}
+
+
+void STDCALL GetSolveTelemetry(
+  solveTelemetry * telemetryp)
+{
+  * telemetryp = telemetry;
+}
+
+
 void DetectSolveDuplicates(
   const boards& bds,
   vector<int>& uniques,
   vector<int>& crossrefs)
 {
+  // Each board is looked up by a hash of everything that SameBoard
+  // compares. A hash collision between different boards only costs
+  // a missed duplicate, as the later board is then solved as well.
+
   const unsigned nu = static_cast<unsigned>(bds.noOfBoards);
 
   uniques.clear();
   crossrefs.resize(nu);
 
-  for (unsigned i = 0; i < nu; i++)
-    crossrefs[i] = -1;
+  unordered_map<unsigned long long, int> seen;
+  seen.reserve(nu);
 
   for (unsigned i = 0; i < nu; i++)
   {
-    if (crossrefs[i] != -1)
+    const unsigned long long key = HashBoard(bds, i);
+    auto it = seen.find(key);
+
+    if (it != seen.end() &&
+        SameBoard(bds, static_cast<unsigned>(it->second), i))
+    {
+      crossrefs[i] = it->second;
       continue;
+    }
 
+    crossrefs[i] = -1;
     uniques.push_back(static_cast<int>(i));
+    if (it == seen.end())
+      seen[key] = static_cast<int>(i);
+  }
+}
 
-    for (unsigned index = i+1; index < nu; index++)
-    {
-      if (SameBoard(bds, i, index))
-        crossrefs[index] = static_cast<int>(i);
-    }
+
+unsigned long long HashBoard(
+  const boards& bds,
+  const unsigned index)
+{
+  // FNV-1a over the fields, 64 bits.
+  const deal& dl = bds.deals[index];
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  auto mix = [&h](const unsigned v)
+  {
+    h = (h ^ v) * 0x100000001b3ULL;
+  };
+
+  for (int hand = 0; hand < DDS_HANDS; hand++)
+    for (int s = 0; s < DDS_SUITS; s++)
+      mix(dl.remainCards[hand][s]);
+
+  mix(static_cast<unsigned>(dl.trump));
+  mix(static_cast<unsigned>(dl.first));
+  for (int k = 0; k < 3; k++)
+  {
+    mix(static_cast<unsigned>(dl.currentTrickSuit[k]));
+    mix(static_cast<unsigned>(dl.currentTrickRank[k]));
   }
+
+  mix(static_cast<unsigned>(bds.target[index]));
+  mix(static_cast<unsigned>(bds.solutions[index]));
+  mix(static_cast<unsigned>(bds.mode[index]));
+  return h;
 }
 
 
@@ -47,20 +47,6 @@ void LastTrickWinner(
   int& leadSuit,
   int& leadSideWins);
 
-bool (* AB_ptr_list[DDS_HANDS])(
-  pos * posPoint,
-  const int target,
-  const int depth,
-  ThreadData * thrp)
-  = { ABsearch, ABsearch1, ABsearch2, ABsearch3 };
-
-bool (* AB_ptr_trace_list[DDS_HANDS])(
-  pos * posPoint,
-  const int target,
-  const int depth,
-  ThreadData * thrp)
-  = { ABsearch0, ABsearch1, ABsearch2, ABsearch3 };
-
 void (* Make_ptr_list[3])(
   pos * posPoint,
   const int depth,
@@ -142,6 +128,17 @@ int SolveBoardInternal(
   else
     similarDeal = false;
 
+  // A related board shares a partnership with the board before
+  // it on this thread. The TT is keyed on relative ranks, so its
+  // entries stay valid and are worth keeping. As for a similar
+  // deal, only the TT's own memory limit bounds the reuse, since
+  // the node guard below only counts in DDS_TOP_LEVEL builds.
+  if (thrp->relatedDeal)
+  {
+    similarDeal = true;
+    thrp->relatedDeal = false;
+  }
+
   if (dl.trump != thrp->trump)
     newTrump = true;
 
@@ -156,7 +153,12 @@ int SolveBoardInternal(
   int trick = (iniDepth + 3) >> 2;
   int handRelFirst = (48 - iniDepth) % 4;
   int handToPlay = handId(dl.first, handRelFirst);
+  int tricksLeft = (iniDepth + 4 + handRelFirst) >> 2;
   thrp->trickNodes = 0;
+  thrp->ttHits = 0;
+  thrp->ttMisses = 0;
+  thrp->limitNodes = 0;
+  thrp->limitHit = false;
 
   thrp->lookAheadPos.handRelFirst = handRelFirst;
   thrp->lookAheadPos.first[iniDepth] = dl.first;
@@ -222,17 +224,14 @@ int SolveBoardInternal(
     thrp->transTable->ResetMemory(reason);
   }
 
-  if (newDeal)
-  {
+  if (newDeal || thrp->analysisFlag)
     SetDeal(thrp);
-    SetDealTables(thrp);
-  }
-  else if (thrp->analysisFlag)
-  {
-    SetDeal(thrp);
-  }
   thrp->analysisFlag = false;
 
+  // Only redoes what the last call did not cover, which is nothing
+  // for the same deal unless the current trick brings in new cards.
+  SetDealTables(dl, thrp);
+
   if (handToPlay == 0 || handToPlay == 2)
   {
     thrp->nodeTypeStore[0] = MAXNODE;
@@ -353,13 +352,24 @@ int SolveBoardInternal(
         ResetBestMoves(thrp);
 
         TIMER_START(TIMER_NO_AB, iniDepth);
-        thrp->val = (* AB_ptr_list[handRelFirst])(
+        thrp->val = (* ABsearchEntry(handRelFirst, false, thrp))(
                       &thrp->lookAheadPos,
                       guess,
                       iniDepth,
                       thrp);
         TIMER_END(TIMER_NO_AB, iniDepth);
 
+        if (thrp->limitHit)
+        {
+          // The cards before this one have their scores, and the
+          // first of them has the best score.
+          futp->cards = mno;
+          thrp->boundLower = (mno > 0 ? futp->score[0] : lowerbound);
+          thrp->boundUpper = (mno > 0 ? futp->score[0] :
+            (upperbound < tricksLeft ? upperbound : tricksLeft));
+          goto SOLVER_LIMIT;
+        }
+
 #ifdef DDS_TOP_LEVEL
         DumpTopLevel(thrp->fileTopLevel.GetStream(), 
           * thrp, guess, lowerbound, upperbound, 1);
@@ -454,12 +464,21 @@ int SolveBoardInternal(
       ResetBestMoves(thrp);
 
       TIMER_START(TIMER_NO_AB, iniDepth);
-      thrp->val = (* AB_ptr_list[handRelFirst])(&thrp->lookAheadPos,
+      thrp->val = (* ABsearchEntry(handRelFirst, false, thrp))(&thrp->lookAheadPos,
                   guess,
                   iniDepth,
                   thrp);
       TIMER_END(TIMER_NO_AB, iniDepth);
 
+      if (thrp->limitHit)
+      {
+        futp->cards = 0;
+        thrp->boundLower = lowerbound;
+        thrp->boundUpper = 
+          (upperbound < tricksLeft ? upperbound : tricksLeft);
+        goto SOLVER_LIMIT;
+      }
+
 #ifdef DDS_TOP_LEVEL
       DumpTopLevel(thrp->fileTopLevel.GetStream(),
         * thrp, guess, lowerbound, upperbound, 1);
@@ -524,13 +543,21 @@ int SolveBoardInternal(
   else
   {
     TIMER_START(TIMER_NO_AB, iniDepth);
-    thrp->val = (* AB_ptr_list[handRelFirst])(
+    thrp->val = (* ABsearchEntry(handRelFirst, false, thrp))(
                   &thrp->lookAheadPos,
                   target,
                   iniDepth,
                   thrp);
     TIMER_END(TIMER_NO_AB, iniDepth);
 
+    if (thrp->limitHit)
+    {
+      futp->cards = 0;
+      thrp->boundLower = 0;
+      thrp->boundUpper = tricksLeft;
+      goto SOLVER_LIMIT;
+    }
+
 #ifdef DDS_TOP_LEVEL
     DumpTopLevel(thrp->fileTopLevel.GetStream(), 
       * thrp, target, -1, -1, 0);
@@ -592,13 +619,22 @@ int SolveBoardInternal(
     ResetBestMoves(thrp);
 
     TIMER_START(TIMER_NO_AB, iniDepth);
-    thrp->val = (* AB_ptr_list[handRelFirst])(
+    thrp->val = (* ABsearchEntry(handRelFirst, false, thrp))(
                   &thrp->lookAheadPos,
                   futp->score[0],
                   iniDepth,
                   thrp);
     TIMER_END(TIMER_NO_AB, iniDepth);
 
+    if (thrp->limitHit)
+    {
+      // The cards found so far all reach score[0], which is the
+      // optimum unless it is the user's target.
+      thrp->boundLower = futp->score[0];
+      thrp->boundUpper = (target == -1 ? futp->score[0] : tricksLeft);
+      goto SOLVER_LIMIT;
+    }
+
 #ifdef DDS_TOP_LEVEL
     DumpTopLevel(thrp->fileTopLevel.GetStream(),
       * thrp, target, -1, -1, 2);
@@ -617,6 +653,19 @@ int SolveBoardInternal(
     ind++;
   }
 
+  goto SOLVER_STATS;
+
+SOLVER_LIMIT:
+
+  // The search ran out of trick nodes or time, and only the cards
+  // that were finished are returned. The search that was cut short
+  // has left wrong bounds in the TT, so the TT is cleared, and the
+  // next solve on this thread sets up the deal afresh.
+  if (futp->cards == 0)
+    futp->score[0] = -1;
+  thrp->transTable->ResetMemory(TT_RESET_UNKNOWN);
+  thrp->nodes = 0;
+  thrp->analysisFlag = true;
 
 SOLVER_STATS:
 
@@ -720,7 +769,7 @@ int SolveSameBoard(
     ResetBestMoves(thrp);
 
     TIMER_START(TIMER_NO_AB, iniDepth);
-    thrp->val = ABsearch(
+    thrp->val = (* ABsearchEntry(0, false, thrp))(
                   &thrp->lookAheadPos,
                   guess,
                   iniDepth,
@@ -881,7 +930,7 @@ int AnalyseLaterBoard(
     ResetBestMoves(thrp);
 
     TIMER_START(TIMER_NO_AB, iniDepth);
-    thrp->val = (* AB_ptr_trace_list[handRelFirst])(
+    thrp->val = (* ABsearchEntry(handRelFirst, true, thrp))(
                   &thrp->lookAheadPos,
                   guess,
                   iniDepth,
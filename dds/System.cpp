@@ -94,6 +94,7 @@ System::~System()
 void System::Reset()
 {
   runCat = DDS_RUN_SOLVE;
+  runCrossrefs = nullptr;
   numThreads = 1;
   preferredSystem = DDS_SYSTEM_THREAD_BASIC;
 
@@ -258,10 +259,41 @@ int System::RegisterRun(
 
   runCat = mode;
   bop = &bdsIn;
+  runCrossrefs = nullptr;
   return RETURN_NO_FAULT;
 }
 
 
+int System::RegisterRun(
+  const RunMode mode,
+  const boards& bdsIn,
+  const vector<int>& crossrefsIn)
+{
+  // The caller has found the repeats already, and copies their
+  // results itself after the run.
+  const int ret = System::RegisterRun(mode, bdsIn);
+  runCrossrefs = &crossrefsIn;
+  return ret;
+}
+
+
+void System::FindUniques(
+  vector<int>& uniques,
+  vector<int>& crossrefs) const
+{
+  if (runCrossrefs == nullptr)
+  {
+    (* CallbackDuplList[runCat])(* bop, uniques, crossrefs);
+    return;
+  }
+
+  uniques.clear();
+  for (unsigned i = 0; i < runCrossrefs->size(); i++)
+    if ((* runCrossrefs)[i] == -1)
+      uniques.push_back(static_cast<int>(i));
+}
+
+
 bool System::IsSingleThreaded() const
 {
   return (preferredSystem == DDS_SYSTEM_THREAD_BASIC);
@@ -460,10 +492,6 @@ int System::RunThreadsSTL()
 #ifdef DDS_THREADS_STL
   vector<thread *> threads;
 
-  vector<int> uniques;
-  vector<int> crossrefs;
-  (* CallbackDuplList[runCat])(* bop, uniques, crossrefs);
-
   const unsigned nu = static_cast<unsigned>(numThreads);
   threads.resize(nu);
 
@@ -486,7 +514,7 @@ int System::RunThreadsSTLIMPL()
 #ifdef DDS_THREADS_STLIMPL
   vector<int> uniques;
   vector<int> crossrefs;
-  (* CallbackDuplList[runCat])(* bop, uniques, crossrefs);
+  FindUniques(uniques, crossrefs);
 
   static atomic<int> thrIdNext = 0;
   bool err = false;
@@ -518,7 +546,8 @@ int System::RunThreadsSTLIMPL()
     return RETURN_THREAD_INDEX;
   }
 
-  (* CallbackCopyList[runCat])(crossrefs);
+  if (runCrossrefs == nullptr)
+    (* CallbackCopyList[runCat])(crossrefs);
 #endif
 
   return RETURN_NO_FAULT;
@@ -561,7 +590,7 @@ int System::RunThreadsPPLIMPL()
 #ifdef DDS_THREADS_PPLIMPL
   vector<int> uniques;
   vector<int> crossrefs;
-  (* CallbackDuplList[runCat])(* bop, uniques, crossrefs);
+  FindUniques(uniques, crossrefs);
 
   static atomic<int> thrIdNext = 0;
   bool err = false, err2 = false;
@@ -598,7 +627,8 @@ int System::RunThreadsPPLIMPL()
     return RETURN_THREAD_INDEX;
   }
 
-  (* CallbackCopyList[runCat])(crossrefs);
+  if (runCrossrefs == nullptr)
+    (* CallbackCopyList[runCat])(crossrefs);
 #endif
 
   return RETURN_NO_FAULT;
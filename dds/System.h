@@ -54,6 +54,11 @@ class System
     fptrType fptr;
 
     boards const * bop;
+    vector<int> const * runCrossrefs;
+
+    void FindUniques(
+      vector<int>& uniques,
+      vector<int>& crossrefs) const;
 
     int RunThreadsBasic();
     int RunThreadsBoost();
@@ -93,6 +98,11 @@ class System
       const RunMode r,
       const boards& bop);
 
+    int RegisterRun(
+      const RunMode r,
+      const boards& bop,
+      const vector<int>& crossrefs);
+
     bool IsSingleThreaded() const;
 
     bool IsIMPL() const;
@@ -70,6 +70,12 @@ class TransTable
 
     virtual void Init(const int handLookup[][15]){};
 
+    // As Init, but only the entries for the subsets of cards[s]
+    // in each suit s. A suit with no cards is left as it was.
+    virtual void InitSubsets(
+      const int handLookup[][15],
+      const unsigned short cards[]){};
+
     virtual void SetMemoryDefault(const int megabytes){};
 
     virtual void SetMemoryMaximum(const int megabytes){};
@@ -83,9 +83,33 @@
 #include <sstream>
 #include <math.h>
 
+// Define DDS_TT_ARENA to cut the TT pages from one mmap'ed region
+// per thread with huge pages asked for. It is off by default: it
+// raises the resident size and has not been shown to save time.
+#if (defined(__linux__) || defined(__APPLE__)) && defined(DDS_TT_ARENA)
+  #include <sys/mman.h>
+  #include <unistd.h>
+  #define DDS_TT_MMAP
+#endif
+
+// The block scan can use SSE2, which every x86-64 has, and AVX2,
+// which is checked for at run time.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+  #include <immintrin.h>
+  #define DDS_TT_SIMD
+#endif
+
 #include "TransTableL.h"
 #include "debug.h"
 
+// Transparent huge pages are 2 MB on the platforms that have them.
+// Within a huge page the cache set follows the virtual address, so
+// if the roots and the pages both started on a huge page boundary,
+// the hottest entries of each would compete for the same sets. The
+// pages are moved on by an odd number of cache lines to avoid that.
+#define TT_HUGE_PAGE (2 << 20)
+#define TT_PAGE_COLOUR (33 * 64)
+
 
 extern unsigned char cardRank[16];
 extern char relRank[8192][15];
@@ -99,6 +123,8 @@ static vector<string> players =
   "North", "East", "South", "West"
 };
 
+TransTableL::scanFunctionType TransTableL::scanFunction = nullptr;
+
 
 TransTableL::TransTableL()
 {
@@ -108,7 +134,17 @@ TransTableL::TransTableL()
     TransTableL::SetConstants();
   }
 
+  if (scanFunction == nullptr)
+    TransTableL::SetScanLevel(TT_SCAN_AUTO);
+
   poolp = nullptr;
+  arena.base = nullptr;
+  arena.start = nullptr;
+  arena.size = 0;
+  rootArena.base = nullptr;
+  rootArena.start = nullptr;
+  rootArena.size = 0;
+  arenaTried = false;
   pagesDefault = NUM_PAGES_DEFAULT;
   pagesMaximum = NUM_PAGES_MAXIMUM;
   pagesCurrent = 0;
@@ -241,6 +277,53 @@ void TransTableL::Init(const int handLookup[][15])
 }
 
 
+void TransTableL::InitSubsets(
+  const int handLookup[][15],
+  const unsigned short cards[])
+{
+  // Each suit's columns only depend on that suit's cards, so the
+  // other suits keep theirs. The subsets of cards[s] are taken in
+  // increasing order, so the entry for ind without its top card
+  // is always ready.
+
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    const unsigned all = cards[s];
+    if (all == 0)
+      continue;
+
+    // Byte k of aggrRanks, counting from the top (bits 18-25 for
+    // k = 0), goes to byte s of aggrBytes, also from the top.
+    const unsigned mask = 0xff000000u >> (8 * s);
+    int left[TT_BYTES], right[TT_BYTES];
+    for (int k = 0; k < TT_BYTES; k++)
+    {
+      const int shift = 6 + 8 * (k - s);
+      left[k] = max(shift, 0);
+      right[k] = max(-shift, 0);
+    }
+
+    aggr[0].aggrRanks[s] = 0;
+    for (int k = 0; k < TT_BYTES; k++)
+      aggr[0].aggrBytes[s][k] = 0;
+
+    for (unsigned ind = (0u - all) & all; ind != 0;
+        ind = (ind - all) & all)
+    {
+      const int topBitNo = highestRank[ind];
+      aggrType * ap = &aggr[ind];
+      const unsigned ranks =
+        aggr[ind ^ bitMapRank[topBitNo]].aggrRanks[s] >> 2 |
+        static_cast<unsigned>(handLookup[s][topBitNo] << 24);
+
+      ap->aggrRanks[s] = ranks;
+      for (int k = 0; k < TT_BYTES; k++)
+        ap->aggrBytes[s][k] = ((ranks << left[k]) >> right[k]) & mask;
+    }
+  }
+}
+
+
 void TransTableL::SetMemoryDefault(int megabytes)
 {
   double blockMem = BLOCKS_PER_PAGE * sizeof(winBlockType) /
@@ -265,18 +348,122 @@ void TransTableL::SetMemoryMaximum(int megabytes)
 //                                                         //
 /////////////////////////////////////////////////////////////
 
+bool TransTableL::MapRegion(
+  const size_t bytes,
+  const size_t colour,
+  regionType& region)
+{
+#ifdef DDS_TT_MMAP
+  // Over-reserve so the start can be aligned to a huge page and then
+  // moved on by the colour. Nothing is committed until it is touched.
+  region.mapped = bytes + colour + TT_HUGE_PAGE;
+  void * p = mmap(nullptr, region.mapped, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED)
+  {
+    region.base = nullptr;
+    return false;
+  }
+
+  region.base = static_cast<char *>(p);
+  const size_t mask = TT_HUGE_PAGE - 1;
+  char * aligned = reinterpret_cast<char *>(
+    (reinterpret_cast<size_t>(region.base) + mask) & ~mask);
+  region.start = aligned + colour;
+  region.size = bytes;
+
+#ifdef MADV_HUGEPAGE
+  // Only a hint; without transparent huge pages this fails
+  // harmlessly and we get normal pages.
+  (void) madvise(aligned, colour + bytes, MADV_HUGEPAGE);
+#endif
+  return true;
+#else
+  UNUSED(bytes);
+  UNUSED(colour);
+  region.base = nullptr;
+  return false;
+#endif
+}
+
+
+void TransTableL::UnmapRegion(regionType& region)
+{
+#ifdef DDS_TT_MMAP
+  if (region.base)
+    munmap(region.base, region.mapped);
+#endif
+  region.base = nullptr;
+  region.start = nullptr;
+  region.size = 0;
+}
+
+
+TransTableL::winBlockType * TransTableL::AllocPage(const int pageNo)
+{
+  const size_t pageBytes = BLOCKS_PER_PAGE * sizeof(winBlockType);
+
+  if (! arenaTried)
+  {
+    arenaTried = true;
+    (void) TransTableL::MapRegion(
+      static_cast<size_t>(pagesMaximum) * pageBytes, TT_PAGE_COLOUR, arena);
+  }
+
+  // The maximum may have been raised since the arena was made.
+  if (arena.base &&
+      static_cast<size_t>(pageNo + 1) * pageBytes <= arena.size)
+    return reinterpret_cast<winBlockType *>(arena.start +
+      static_cast<size_t>(pageNo) * pageBytes);
+
+  return static_cast<winBlockType *>(malloc(pageBytes));
+}
+
+
+void TransTableL::FreePage(winBlockType * list)
+{
+  char * p = reinterpret_cast<char *>(list);
+  if (arena.base && p >= arena.start && p < arena.start + arena.size)
+  {
+#ifdef DDS_TT_MMAP
+    // Keep the address range for the next page, but give the
+    // memory back as free() would have. Only whole system pages
+    // can go, and the neighbouring TT pages share the ends.
+    const size_t mask = static_cast<size_t>(sysconf(_SC_PAGESIZE)) - 1;
+    const size_t first = (reinterpret_cast<size_t>(p) + mask) & ~mask;
+    const size_t last = (reinterpret_cast<size_t>(p) +
+      BLOCKS_PER_PAGE * sizeof(winBlockType)) & ~mask;
+    if (last > first)
+      (void) madvise(reinterpret_cast<void *>(first), last - first,
+        MADV_DONTNEED);
+#endif
+    return;
+  }
+
+  free(list);
+}
+
+
 void TransTableL::MakeTT()
 {
   if (! TTInUse)
   {
     TTInUse = 1;
 
+    const size_t rootBytes = 256 * sizeof(distHashType);
+    const bool mapped = TransTableL::MapRegion(
+      TT_TRICKS * DDS_HANDS * rootBytes, 0, rootArena);
+
     for (int t = 0; t < TT_TRICKS; t++)
     {
       for (int h = 0; h < DDS_HANDS; h++)
       {
-        TTroot[t][h] = static_cast<distHashType *>
-                       (malloc(256 * sizeof(distHashType)));
+        if (mapped)
+          TTroot[t][h] = reinterpret_cast<distHashType *>(
+            rootArena.start + (t * DDS_HANDS + h) * rootBytes);
+        else
+          TTroot[t][h] = static_cast<distHashType *>
+                         (malloc(rootBytes));
 
         if (TTroot[t][h] == nullptr)
           exit(1);
@@ -312,6 +499,12 @@ void TransTableL::ReleaseTT()
     return;
   TTInUse = 0;
 
+  if (rootArena.base)
+  {
+    TransTableL::UnmapRegion(rootArena);
+    return;
+  }
+
   for (int t = 0; t < TT_TRICKS; t++)
   {
     for (int h = 0; h < DDS_HANDS; h++)
@@ -337,7 +530,7 @@ void TransTableL::ResetMemory(const TTresetReason reason)
 
   while (pagesCurrent > pagesDefault)
   {
-    free(poolp->list);
+    TransTableL::FreePage(poolp->list);
     poolp = poolp->prev;
 
     free(poolp->next);
@@ -376,13 +569,16 @@ void TransTableL::ReturnAllMemory()
 
     while (poolp)
     {
-      free(poolp->list);
+      TransTableL::FreePage(poolp->list);
       tmp = poolp;
       poolp = poolp->prev;
       free(tmp);
     }
   }
 
+  TransTableL::UnmapRegion(arena);
+  arenaTried = false;
+
   pagesCurrent = 0;
 
   pageStats.numResets = 0;
@@ -450,8 +646,7 @@ TransTableL::winBlockType * TransTableL::GetNextCardBlock()
     if (poolp == nullptr)
       exit(1);
 
-    poolp->list = static_cast<winBlockType *>
-                  (malloc(BLOCKS_PER_PAGE * sizeof(winBlockType)));
+    poolp->list = TransTableL::AllocPage(pagesCurrent);
 
     if (! poolp->list)
       exit(1);
@@ -531,8 +726,7 @@ TransTableL::winBlockType * TransTableL::GetNextCardBlock()
         return harvested.list[0];
       }
 
-      newpoolp->list = static_cast<winBlockType *>
-        (malloc(BLOCKS_PER_PAGE * sizeof(winBlockType)));
+      newpoolp->list = TransTableL::AllocPage(pagesCurrent);
 
       if (! newpoolp->list)
       {
@@ -778,81 +972,254 @@ nodeCardsType * TransTableL::LookupCards(
   const int limit,
   bool& lowerFlag)
 {
+  // The newest entries are those below nextWriteNo, newest last.
+  // Once the block has wrapped, the older ones follow above it.
+
   const int n = bp->nextWriteNo - 1;
-  winMatchType * wp = &bp->list[n];
+  int i = (*scanFunction)(bp, search, 0, n, limit, lowerFlag);
 
-  // It may be a bit silly to duplicate the code like this.
-  // It could be combined to one loop with a slight overhead.
+  if (i == -1)
+    i = (*scanFunction)(bp, search, n + 1, bp->nextMatchNo - 1,
+      limit, lowerFlag);
 
-  for (int i = n; i >= 0; i--, wp--)
-  {
-    if ((wp->topSet1 ^ search.topSet1) & wp->topMask1)
-      continue;
+  if (i == -1)
+    return nullptr;
 
-    if (wp->lastMaskNo != 1)
-    {
-      if ((wp->topSet2 ^ search.topSet2) & wp->topMask2)
-        continue;
+  bp->timestampRead = ++timestamp;
+  return &bp->rest[i].first;
+}
 
-      if (wp->lastMaskNo != 2)
-      {
-        if ((wp->topSet3 ^ search.topSet3) & wp->topMask3)
-          continue;
-      }
-    }
 
-    // Check bounds.
-    nodeCardsType * nodep = &wp->first;
-    if (nodep->lbound > limit)
-    {
-      bp->timestampRead = ++timestamp;
-      lowerFlag = true;
-      return nodep;
-    }
-    else if (nodep->ubound <= limit)
-    {
-      bp->timestampRead = ++timestamp;
-      lowerFlag = false;
-      return nodep;
-    }
+// Whether a stored node decides the search at this limit.
+static inline bool BoundsSettle(
+  const nodeCardsType& node,
+  const int limit,
+  bool& lowerFlag)
+{
+  if (node.lbound > limit)
+  {
+    lowerFlag = true;
+    return true;
+  }
+  else if (node.ubound <= limit)
+  {
+    lowerFlag = false;
+    return true;
   }
+  return false;
+}
+
 
-  const int n2 = bp->nextMatchNo - 1;
-  wp = &bp->list[n2];
+// The masks are zero beyond an entry's lastMaskNo, so an entry
+// matches exactly when all three masked differences are zero.
+// This is what lets several entries be tested at once.
 
-  for (int i = n2; i > n; i--, wp--)
+int TransTableL::ScanScalar(
+  const winBlockType * bp,
+  const winMatchType& search,
+  const int low,
+  const int high,
+  const int limit,
+  bool& lowerFlag)
+{
+  for (int i = high; i >= low; i--)
   {
-    if ((wp->topSet1 ^ search.topSet1) & wp->topMask1)
+    if ((bp->topSet1[i] ^ search.topSet1) & bp->topMask1[i])
       continue;
 
-    if (wp->lastMaskNo != 1)
-    {
-      if ((wp->topSet2 ^ search.topSet2) & wp->topMask2)
-        continue;
+    if ((bp->topSet2[i] ^ search.topSet2) & bp->topMask2[i])
+      continue;
 
-      if (wp->lastMaskNo != 2)
-      {
-        if ((wp->topSet3 ^ search.topSet3) & wp->topMask3)
-          continue;
-      }
-    }
+    if ((bp->topSet3[i] ^ search.topSet3) & bp->topMask3[i])
+      continue;
+
+    if (BoundsSettle(bp->rest[i].first, limit, lowerFlag))
+      return i;
+  }
+  return -1;
+}
+
+
+#ifdef DDS_TT_SIMD
+
+// Keeps the bits of a lane mask for entries base .. base+width-1
+// that lie in [low, high].
+static inline unsigned LanesInRange(
+  unsigned bits,
+  const int base,
+  const int width,
+  const int low,
+  const int high)
+{
+  if (base + width - 1 > high)
+    bits &= (1u << (high - base + 1)) - 1;
+  if (base < low)
+    bits &= ~((1u << (low - base)) - 1);
+  return bits;
+}
+
+
+int TransTableL::ScanSSE2(
+  const winBlockType * bp,
+  const winMatchType& search,
+  const int low,
+  const int high,
+  const int limit,
+  bool& lowerFlag)
+{
+  if (high < low)
+    return -1;
+
+  const __m128i s1 = _mm_set1_epi32(static_cast<int>(search.topSet1));
+  const __m128i s2 = _mm_set1_epi32(static_cast<int>(search.topSet2));
+  const __m128i s3 = _mm_set1_epi32(static_cast<int>(search.topSet3));
+  const __m128i zero = _mm_setzero_si128();
 
-    nodeCardsType * nodep = &wp->first;
-    if (nodep->lbound > limit)
+  for (int base = high & ~3; base >= (low & ~3); base -= 4)
+  {
+    __m128i d = _mm_and_si128(_mm_xor_si128(s1,
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bp->topSet1 + base))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bp->topMask1 + base)));
+    d = _mm_or_si128(d, _mm_and_si128(_mm_xor_si128(s2,
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bp->topSet2 + base))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bp->topMask2 + base))));
+    d = _mm_or_si128(d, _mm_and_si128(_mm_xor_si128(s3,
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bp->topSet3 + base))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bp->topMask3 + base))));
+
+    unsigned bits = static_cast<unsigned>(_mm_movemask_ps(
+      _mm_castsi128_ps(_mm_cmpeq_epi32(d, zero))));
+    bits = LanesInRange(bits, base, 4, low, high);
+
+    while (bits)
     {
-      lowerFlag = true;
-      bp->timestampRead = ++timestamp;
-      return nodep;
+      const int lane = 31 - __builtin_clz(bits);
+      if (BoundsSettle(bp->rest[base + lane].first, limit, lowerFlag))
+        return base + lane;
+      bits ^= 1u << lane;
     }
-    else if (nodep->ubound <= limit)
+  }
+  return -1;
+}
+
+
+__attribute__((target("avx2")))
+int TransTableL::ScanAVX2(
+  const winBlockType * bp,
+  const winMatchType& search,
+  const int low,
+  const int high,
+  const int limit,
+  bool& lowerFlag)
+{
+  if (high < low)
+    return -1;
+
+  const __m256i s1 = _mm256_set1_epi32(static_cast<int>(search.topSet1));
+  const __m256i s2 = _mm256_set1_epi32(static_cast<int>(search.topSet2));
+  const __m256i s3 = _mm256_set1_epi32(static_cast<int>(search.topSet3));
+  const __m256i zero = _mm256_setzero_si256();
+
+  for (int base = high & ~7; base >= (low & ~7); base -= 8)
+  {
+    __m256i d = _mm256_and_si256(_mm256_xor_si256(s1,
+      _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(bp->topSet1 + base))),
+      _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(bp->topMask1 + base)));
+    d = _mm256_or_si256(d, _mm256_and_si256(_mm256_xor_si256(s2,
+      _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(bp->topSet2 + base))),
+      _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(bp->topMask2 + base))));
+    d = _mm256_or_si256(d, _mm256_and_si256(_mm256_xor_si256(s3,
+      _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(bp->topSet3 + base))),
+      _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(bp->topMask3 + base))));
+
+    unsigned bits = static_cast<unsigned>(_mm256_movemask_ps(
+      _mm256_castsi256_ps(_mm256_cmpeq_epi32(d, zero))));
+    bits = LanesInRange(bits, base, 8, low, high);
+
+    while (bits)
     {
-      lowerFlag = false;
-      bp->timestampRead = ++timestamp;
-      return nodep;
+      const int lane = 31 - __builtin_clz(bits);
+      if (BoundsSettle(bp->rest[base + lane].first, limit, lowerFlag))
+        return base + lane;
+      bits ^= 1u << lane;
     }
   }
+  return -1;
+}
 
-  return nullptr;
+#endif
+
+
+int TransTableL::SetScanLevel(const int level)
+{
+  int best = TT_SCAN_SCALAR;
+#ifdef DDS_TT_SIMD
+  best = TT_SCAN_SSE2;
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    best = TT_SCAN_AVX2;
+#endif
+
+  const int use = (level < 0 || level > best ? best : level);
+
+#ifdef DDS_TT_SIMD
+  if (use == TT_SCAN_AVX2)
+    scanFunction = &TransTableL::ScanAVX2;
+  else if (use == TT_SCAN_SSE2)
+    scanFunction = &TransTableL::ScanSSE2;
+  else
+#endif
+    scanFunction = &TransTableL::ScanScalar;
+
+  return use;
+}
+
+
+void TransTableL::GetMatch(
+  winBlockType const * bp,
+  const int no,
+  winMatchType& match)
+{
+  const winRestType& rest = bp->rest[no];
+  match.xorSet = rest.xorSet;
+  match.topSet1 = bp->topSet1[no];
+  match.topSet2 = bp->topSet2[no];
+  match.topSet3 = bp->topSet3[no];
+  match.topSet4 = rest.topSet4;
+  match.topMask1 = bp->topMask1[no];
+  match.topMask2 = bp->topMask2[no];
+  match.topMask3 = bp->topMask3[no];
+  match.topMask4 = rest.topMask4;
+  match.maskIndex = rest.maskIndex;
+  match.lastMaskNo = rest.lastMaskNo;
+  match.first = rest.first;
+}
+
+
+void TransTableL::SetMatch(
+  winBlockType * bp,
+  const int no,
+  const winMatchType& match)
+{
+  winRestType& rest = bp->rest[no];
+  rest.xorSet = match.xorSet;
+  bp->topSet1[no] = match.topSet1;
+  bp->topSet2[no] = match.topSet2;
+  bp->topSet3[no] = match.topSet3;
+  rest.topSet4 = match.topSet4;
+  bp->topMask1[no] = match.topMask1;
+  bp->topMask2[no] = match.topMask2;
+  bp->topMask3[no] = match.topMask3;
+  rest.topMask4 = match.topMask4;
+  rest.maskIndex = match.maskIndex;
+  rest.lastMaskNo = match.lastMaskNo;
+  rest.first = match.first;
 }
 
 
@@ -866,18 +1233,18 @@ void TransTableL::CreateOrUpdate(
   // is not already full, or the oldest one in the list is
   // overwritten.
 
-  winMatchType * wp = bp->list;
   int n = bp->nextMatchNo;
 
-  for (int i = 0; i < n; i++, wp++)
+  for (int i = 0; i < n; i++)
   {
-    if (wp->xorSet != search.xorSet ) continue;
-    if (wp->maskIndex != search.maskIndex) continue;
-    if (wp->topSet1 != search.topSet1 ) continue;
-    if (wp->topSet2 != search.topSet2 ) continue;
-    if (wp->topSet3 != search.topSet3 ) continue;
-
-    nodeCardsType& node = wp->first;
+    winRestType& rest = bp->rest[i];
+    if (rest.xorSet != search.xorSet ) continue;
+    if (rest.maskIndex != search.maskIndex) continue;
+    if (bp->topSet1[i] != search.topSet1 ) continue;
+    if (bp->topSet2[i] != search.topSet2 ) continue;
+    if (bp->topSet3[i] != search.topSet3 ) continue;
+
+    nodeCardsType& node = rest.first;
     if (search.first.lbound > node.lbound)
       node.lbound = search.first.lbound;
     if (search.first.ubound < node.ubound)
@@ -897,13 +1264,13 @@ void TransTableL::CreateOrUpdate(
     bp->nextMatchNo++;
 
 
-  wp = &bp->list[ bp->nextWriteNo++ ];
-  *wp = search;
+  const int m = bp->nextWriteNo++;
+  TransTableL::SetMatch(bp, m, search);
 
   if (!flag)
   {
-    wp->first.bestMoveSuit = 0;
-    wp->first.bestMoveRank = 0;
+    bp->rest[m].first.bestMoveSuit = 0;
+    bp->rest[m].first.bestMoveRank = 0;
   }
 }
 
@@ -1492,12 +1859,14 @@ void TransTableL::PrintEntriesBlock(
 
   fout << st << "\n" << string(st.size(), '=') << "\n\n";
 
+  winMatchType match;
   for (int j = 0; j < bp->nextMatchNo; j++)
   {
     st = "Entry number " + to_string(j+1);
     fout << st << "\n";
     fout << string(st.size(), '-') << "\n\n";
-    TransTableL::PrintMatch(fout, bp->list[j], lengths);
+    TransTableL::GetMatch(bp, j, match);
+    TransTableL::PrintMatch(fout, match, lengths);
   }
 }
 
@@ -1540,10 +1909,13 @@ void TransTableL::PrintEntriesDistAndCards(
 
   int matchNo = 1;
   int n = bp->nextMatchNo - 1;
-  winMatchType const * wp = &bp->list[n];
+  winMatchType match;
+  winMatchType const * wp = &match;
 
-  for (int i = n; i >= 0; i--, wp--)
+  for (int i = n; i >= 0; i--)
   {
+    TransTableL::GetMatch(bp, i, match);
+
     if ((wp->topSet1 ^ TTentry.topSet1) & wp->topMask1)
       continue;
 
@@ -1561,7 +1933,7 @@ void TransTableL::PrintEntriesDistAndCards(
 
     fout << "Match number " << matchNo++ << "\n";
     fout << string(15, '-') << "\n";
-    TransTableL::PrintMatch(fout, bp->list[i], len);
+    TransTableL::PrintMatch(fout, match, len);
   }
 
   if (matchNo == 1)
@@ -32,6 +32,7 @@ using namespace std;
 #define BLOCKS_PER_PAGE 1000
 #define DISTS_PER_ENTRY 32
 #define BLOCKS_PER_ENTRY 125
+#define BLOCKS_PER_SCAN 128 // BLOCKS_PER_ENTRY rounded up to 8
 #define FIRST_HARVEST_TRICK 8
 #define HARVEST_AGE 10000
 
@@ -42,6 +43,14 @@ using namespace std;
 
 #define TT_PERCENTILE 0.9
 
+enum TTscanLevel
+{
+  TT_SCAN_AUTO = -1,
+  TT_SCAN_SCALAR = 0,
+  TT_SCAN_SSE2 = 1,
+  TT_SCAN_AVX2 = 2
+};
+
 
 class TransTableL: public TransTable
 {
@@ -57,14 +66,49 @@ class TransTableL: public TransTable
       nodeCardsType first;
     };
 
-    struct winBlockType // 6508 bytes when BLOCKS_PER_ENTRY == 125
+    // The rest of a winMatchType once the fields that LookupCards
+    // scans have been taken out.
+    struct winRestType // 28 bytes
+    {
+      unsigned xorSet;
+      unsigned topSet4;
+      unsigned topMask4;
+      int maskIndex;
+      int lastMaskNo;
+      nodeCardsType first;
+    };
+
+    // The fields that LookupCards tests are kept column by column,
+    // so that one vector load covers the same field of several
+    // entries. The columns are padded to BLOCKS_PER_SCAN so that
+    // the last load stays inside the block; the padding is never
+    // reported as a match.
+    struct winBlockType // 6584 bytes when BLOCKS_PER_ENTRY == 125
     {
       int nextMatchNo;
       int nextWriteNo;
       int timestampRead;
-      winMatchType list[BLOCKS_PER_ENTRY];
+      unsigned topSet1[BLOCKS_PER_SCAN];
+      unsigned topSet2[BLOCKS_PER_SCAN];
+      unsigned topSet3[BLOCKS_PER_SCAN];
+      unsigned topMask1[BLOCKS_PER_SCAN];
+      unsigned topMask2[BLOCKS_PER_SCAN];
+      unsigned topMask3[BLOCKS_PER_SCAN];
+      winRestType rest[BLOCKS_PER_ENTRY];
     };
 
+    // Returns the highest number in [low, high] whose entry matches
+    // search and whose bounds settle limit, or -1.
+    typedef int (*scanFunctionType)(
+      const winBlockType * bp,
+      const winMatchType& search,
+      const int low,
+      const int high,
+      const int limit,
+      bool& lowerFlag);
+
+    static scanFunctionType scanFunction;
+
     struct posSearchType // 16 bytes (inefficiency, 12 bytes enough)
     {
       winBlockType * posBlock;
@@ -142,6 +186,22 @@ class TransTableL: public TransTable
     winBlockType * nextBlockp;
     harvestedType harvested;
 
+    // With DDS_TT_ARENA on a platform with mmap, the pages of card
+    // blocks are cut from one region per thread, reserved once and
+    // asked for huge pages. Otherwise, or if that fails, pages are
+    // malloc'ed.
+    struct regionType
+    {
+      char * base;   // As mapped, for munmap
+      size_t mapped;
+      char * start;  // Aligned to a huge page, plus colour
+      size_t size;
+    };
+
+    regionType arena;
+    regionType rootArena;
+    bool arenaTried;
+
     int timestamp;
     int TTInUse;
 
@@ -150,6 +210,17 @@ class TransTableL: public TransTable
 
     void ReleaseTT();
 
+    static bool MapRegion(
+      const size_t bytes,
+      const size_t colour,
+      regionType& region);
+
+    static void UnmapRegion(regionType& region);
+
+    winBlockType * AllocPage(const int pageNo);
+
+    void FreePage(winBlockType * list);
+
     void SetConstants();
 
     int hash8(const int handDist[]) const;
@@ -167,6 +238,40 @@ class TransTableL: public TransTable
       const int limit,
       bool& lowerFlag);
 
+    static int ScanScalar(
+      const winBlockType * bp,
+      const winMatchType& search,
+      const int low,
+      const int high,
+      const int limit,
+      bool& lowerFlag);
+
+    static int ScanSSE2(
+      const winBlockType * bp,
+      const winMatchType& search,
+      const int low,
+      const int high,
+      const int limit,
+      bool& lowerFlag);
+
+    static int ScanAVX2(
+      const winBlockType * bp,
+      const winMatchType& search,
+      const int low,
+      const int high,
+      const int limit,
+      bool& lowerFlag);
+
+    static void GetMatch(
+      winBlockType const * bp,
+      const int no,
+      winMatchType& match);
+
+    static void SetMatch(
+      winBlockType * bp,
+      const int no,
+      const winMatchType& match);
+
     void CreateOrUpdate(
       winBlockType * bp,
       const winMatchType& search,
@@ -283,8 +388,18 @@ class TransTableL: public TransTable
 
     ~TransTableL();
 
+    // Chooses how LookupCards scans a block. TT_SCAN_AUTO picks the
+    // widest the CPU supports, and a level the CPU or the build
+    // does not support falls back to the next one down. Returns
+    // the level now in use. Not to be called while solving.
+    static int SetScanLevel(const int level);
+
     void Init(const int handLookup[][15]);
 
+    void InitSubsets(
+      const int handLookup[][15],
+      const unsigned short cards[]);
+
     void SetMemoryDefault(const int megabytes);
 
     void SetMemoryMaximum(const int megabytes);
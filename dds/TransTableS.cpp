@@ -102,6 +102,32 @@ void TransTableS::Init(const int handLookup[][15])
 }
 
 
+void TransTableS::InitSubsets(
+  const int handLookup[][15],
+  const unsigned short cards[])
+{
+  for (int s = 0; s < DDS_SUITS; s++)
+  {
+    const unsigned all = cards[s];
+    if (all == 0)
+      continue;
+
+    // winMask does not depend on the cards, so it stays as Init
+    // left it.
+    aggp[0].aggrRanks[s] = 0;
+
+    for (unsigned ind = (0u - all) & all; ind != 0;
+        ind = (ind - all) & all)
+    {
+      const int topBitNo = highestRank[ind];
+      aggp[ind].aggrRanks[s] =
+        (aggp[ind ^ bitMapRank[topBitNo]].aggrRanks[s] >> 2) |
+        (handLookup[s][topBitNo] << 24);
+    }
+  }
+}
+
+
 void TransTableS::SetMemoryDefault(const int megabytes)
 {
   UNUSED(megabytes);
@@ -160,6 +160,10 @@ class TransTableS: public TransTable
 
     void Init(const int handLookup[][15]);
 
+    void InitSubsets(
+      const int handLookup[][15],
+      const unsigned short cards[]);
+
     void SetMemoryDefault(const int megabytes);
 
     void SetMemoryMaximum(const int megabytes);
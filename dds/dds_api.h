@@ -6,6 +6,7 @@
 struct DDS_C_API {
     DLLEXPORT void (*pErrorMessage)(int code, char line[80]);
     DLLEXPORT int STDCALL (*pSolveAllBoardsBin)(struct boards* bop, struct solvedBoards* solvedp);
+    DLLEXPORT int STDCALL (*pSetRelatedBoards)(int on);
 };
 
 #endif // _DDS_API_H_
@@ -39,6 +39,8 @@
 
 #define MAXNOOFTABLES 40
 
+#define MAXNOOFSTATTHREADS 128
+
 
 // Error codes. See interface document for more detail.
 // Call ErrorMessage(code, line[]) to get the text form in line[].
@@ -340,6 +342,63 @@ struct solvedPlays
   struct solvedPlay solved[MAXNOOFBOARDS];
 };
 
+struct schedulerStats
+{
+  // For the most recent batch. Threads beyond MAXNOOFSTATTHREADS
+  // are not reported.
+  int noOfThreads;
+  int noOfSteals;
+  int boards[MAXNOOFSTATTHREADS];
+  long long busyMicros[MAXNOOFSTATTHREADS];
+
+  // The fitted model's predicted against actual solve times, for
+  // the boards that were solved rather than copied and whose strain
+  // the model was calibrated for: the mean of |ln(predicted/actual)|
+  // and the correlation of the logs. modelReady is 1 if the model
+  // ordered the batch (see SetSchedulerModel) rather than the
+  // built-in constants.
+  int noOfTimedBoards;
+  int modelReady;
+  double meanAbsLogError;
+  double logCorrelation;
+
+  // Boards in the batch, and how many of them were exact repeats of
+  // an earlier board, which are copied rather than solved.
+  int noOfBoards;
+  int noOfDuplicates;
+};
+
+struct solveBounds
+{
+  // For the most recent batch, in the order of its boards. A board
+  // that the limits of SetSolveLimits cut short has complete 0, and
+  // its tricks for the side to play are between lower and upper.
+  // A complete board gets the bounds that its answer implies, which
+  // are the same unless it was solved for a target.
+  int noOfBoards;
+  int complete[MAXNOOFBOARDS];
+  int lower[MAXNOOFBOARDS];
+  int upper[MAXNOOFBOARDS];
+};
+
+struct solveTelemetry
+{
+  // For the most recent batch, in the order of its boards, if
+  // SetSolveTelemetry was on, and otherwise noOfBoards is 0. A board
+  // that exactly repeats an earlier one is copied rather than solved,
+  // and gets the figures of that board. memoryKB is what the thread
+  // held at the end of the board, which is its high-water mark, as
+  // the TT only grows during a solve unless it fills up or the board
+  // is cut short.
+  int noOfBoards;
+  int nodes[MAXNOOFBOARDS];
+  int ttHits[MAXNOOFBOARDS];
+  int ttMisses[MAXNOOFBOARDS];
+  int micros[MAXNOOFBOARDS];
+  int thread[MAXNOOFBOARDS];
+  int memoryKB[MAXNOOFBOARDS];
+};
+
 struct DDSInfo
 {
   // Version 2.8.0 has 2, 8, 0 and a string of 2.8.0
@@ -392,6 +451,59 @@ EXTERN_C DLLEXPORT void STDCALL SetMaxThreads(
 EXTERN_C DLLEXPORT int STDCALL SetThreading(
   int code);
 
+// In related mode, SolveAllBoardsBin groups boards that share the
+// cards of one partnership and keeps the TT across each group.
+// Returns the previous setting.
+EXTERN_C DLLEXPORT int STDCALL SetRelatedBoards(
+  int on);
+
+// In work-stealing mode, each thread gets its own queue of boards,
+// and a thread that runs out takes half of the fullest queue.
+// Returns the previous setting.
+EXTERN_C DLLEXPORT int STDCALL SetWorkStealing(
+  int on);
+
+// The scheduler always fits solve times to what it has seen, and
+// reports the fit in GetSchedulerStats. With this on, the fit also
+// orders the batches once it is calibrated for every strain in one.
+// Off by default. Returns the previous setting.
+EXTERN_C DLLEXPORT int STDCALL SetSchedulerModel(
+  int on);
+
+// The search is compiled separately for notrump and trump and for
+// MAX and MIN nodes, and uses these versions by default. Turning
+// this off runs the plain search, which looks both up on every
+// node. The results are the same. Returns the previous setting.
+EXTERN_C DLLEXPORT int STDCALL SetSpecializedSearch(
+  int on);
+
+EXTERN_C DLLEXPORT void STDCALL GetSchedulerStats(
+  struct schedulerStats * statsp);
+
+// Limits for the boards of SolveAllBoards and the others that take
+// a batch: the milliseconds from the start of the batch, and the
+// trick nodes per board, 0 for none. A board that runs out comes
+// back with the cards it finished, if any, and score[0] -1 if none,
+// and GetSolveBounds tells what is known of its tricks.
+EXTERN_C DLLEXPORT void STDCALL SetSolveLimits(
+  int milliseconds,
+  int nodes);
+
+EXTERN_C DLLEXPORT void STDCALL GetSolveLimits(
+  int * milliseconds,
+  int * nodes);
+
+EXTERN_C DLLEXPORT void STDCALL GetSolveBounds(
+  struct solveBounds * boundsp);
+
+// With telemetry on, the batch solvers time each board and keep its
+// search figures for GetSolveTelemetry. Returns the previous setting.
+EXTERN_C DLLEXPORT int STDCALL SetSolveTelemetry(
+  int on);
+
+EXTERN_C DLLEXPORT void STDCALL GetSolveTelemetry(
+  struct solveTelemetry * telemetryp);
+
 EXTERN_C DLLEXPORT void STDCALL SetResources(
   int maxMemoryMB,
   int maxThreads);
@@ -406,6 +518,19 @@ EXTERN_C DLLEXPORT int STDCALL SolveBoard(
   struct futureTricks * futp,
   int threadIndex);
 
+// Like SolveBoard, but the moves at the root are played out and the
+// positions after them are solved in parallel on the DDS threads,
+// which cuts the time for one board when there are threads to
+// spare. Ties come in the order the moves are generated. It uses
+// thread 0 and the batch interface, so it must not run alongside
+// other calls.
+EXTERN_C DLLEXPORT int STDCALL SolveBoardSplit(
+  struct deal dl,
+  int target,
+  int solutions,
+  int mode,
+  struct futureTricks * futp);
+
 EXTERN_C DLLEXPORT int STDCALL SolveBoardPBN(
   struct dealPBN dlpbn,
   int target,
@@ -414,6 +539,13 @@ EXTERN_C DLLEXPORT int STDCALL SolveBoardPBN(
   struct futureTricks * futp,
   int thrId);
 
+EXTERN_C DLLEXPORT int STDCALL SolveBoardSplitPBN(
+  struct dealPBN dlpbn,
+  int target,
+  int solutions,
+  int mode,
+  struct futureTricks * futp);
+
 EXTERN_C DLLEXPORT int STDCALL CalcDDtable(
   struct ddTableDeal tableDeal,
   struct ddTableResults * tablep);
@@ -530,6 +662,16 @@ EXTERN_C DLLEXPORT int STDCALL AnalyseAllPlaysPBN(
   struct solvedPlays * solvedp,
   int chunkSize);
 
+// As AnalyseAllPlaysBin, but solves the position before each card
+// in full, as SolveBoard with solutions = 3, into
+// solutions[52 * board + card].  The cards of a board are solved in
+// order on one thread, so the TT carries over from card to card.
+EXTERN_C DLLEXPORT int STDCALL AnalyseAllPlaysFullBin(
+  struct boards * bop,
+  struct playTracesBin * plp,
+  struct futureTricks * solutions,
+  int chunkSize);
+
 EXTERN_C DLLEXPORT void STDCALL GetDDSInfo(
   struct DDSInfo * info);
 
@@ -291,6 +291,18 @@ std::map<std::string, stat_t> ANSOLVER::get_stats() const
 #undef A
     out["tt_size"] = (stat_t)_tt.size();
 
+    size_t bdt_sizes[BDT_MANAGER::MAP_NUM];
+    _b2.get_map_sizes(bdt_sizes);
+
+    size_t i=0;
+    out["bdt_nodes"] = bdt_sizes[i++];
+    out["bdt_union_map"] = bdt_sizes[i++];
+    out["bdt_intersect_map"] = bdt_sizes[i++];
+    out["bdt_extrude_map"] = bdt_sizes[i++];
+    out["bdt_remove_map"] = bdt_sizes[i++];
+    out["bdt_require_map"] = bdt_sizes[i++];
+    jassert(i == BDT_MANAGER::MAP_NUM);
+
     return out;
 }
 
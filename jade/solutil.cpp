@@ -219,7 +219,11 @@ void DDS_LOADER::solve_some()
 	return;
     }
 
+    // Every board here has the same North and South, so let DDS
+    // keep its transposition table from one to the next.
+    int was_related = (*dds_api->pSetRelatedBoards)(1);
     int r = (*dds_api->pSolveAllBoardsBin)(&_bo, &_solved);
+    (*dds_api->pSetRelatedBoards)(was_related);
 
     if (r < 0) {
 	char line[80];
@@ -344,6 +344,7 @@ std::map<std::string, stat_t> SOLVER::get_stats() const
     out["bdt_remove_map"] = bdt_sizes[i++];
     out["bdt_require_map"] = bdt_sizes[i++];
     assert(i == BDT_MANAGER::MAP_NUM);
+    out["tt_size"] = (stat_t)_tt.size();
 
     return out;
 }
@@ -1,11 +1,17 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <inttypes.h>
+#include <algorithm>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include "j128.h"
 #include "jbdd.h"
+#include "jmetric.h"
+#include "jbddfile.h"
+#include "jreorder.h"
+#include "jdealer.h"
 
 #ifndef Py_IS_TYPE
 #define Py_IS_TYPE(obj, type)	(Py_TYPE((obj)) == (type))
@@ -51,18 +57,27 @@ struct BDD_TRIPLE {
     }
 };
 
+/*
+ * pyrefs counts the live Python BDD objects pointing at a node (with
+ * either sign); those nodes are the roots for bdd_collect().  A slot
+ * whose vnum is BDD_FREE_VNUM has been collected and is on the free list.
+ */
+const bddvar_t BDD_FREE_VNUM = -1;
+
 struct BDD_INFO {
     BDD_TRIPLE	trip;
     j128_t	pcount;
     j128_t	ncount;
+    uint32_t	pyrefs;
 
-    BDD_INFO(const BDD_TRIPLE& t) : trip(t),pcount(0),ncount(0) {}
+    BDD_INFO(const BDD_TRIPLE& t) : trip(t),pcount(0),ncount(0),pyrefs(0) {}
     BDD_INFO(const BDD_INFO& i) :
-	trip(i.trip),pcount(i.pcount),ncount(i.ncount) {}
+	trip(i.trip),pcount(i.pcount),ncount(i.ncount),pyrefs(i.pyrefs) {}
     BDD_INFO& operator=(const BDD_INFO& i) {
 	trip = i.trip;
 	pcount = i.pcount;
 	ncount = i.ncount;
+	pyrefs = i.pyrefs;
 	return *this;
     }
 };
@@ -97,9 +112,22 @@ struct BDD_ITE {
     }
 };
 
+struct BDD_HASH {
+    static uint64_t mix(uint64_t h, uint64_t x) {
+	h = (h ^ x) * 0x9e3779b97f4a7c15ull;
+	return h ^ (h >> 29);
+    }
+    size_t operator()(const BDD_TRIPLE& t) const {
+	return mix(mix(mix(0, t.vnum), t.avec), t.sans);
+    }
+    size_t operator()(const BDD_ITE& x) const {
+	return mix(mix(mix(0, x.i), x.t), x.e);
+    }
+};
+
 typedef std::vector<BDD_INFO>          BDD_INFO_VEC;
-typedef std::map<BDD_TRIPLE, size_t>   BDD_TRIPLE_MAP;
-typedef std::map<BDD_ITE, bddref_t>    BDD_ITE_MAP;
+typedef std::unordered_map<BDD_TRIPLE, size_t, BDD_HASH>   BDD_TRIPLE_MAP;
+typedef std::unordered_map<BDD_ITE, bddref_t, BDD_HASH>    BDD_ITE_MAP;
 
 static
 BDD_INFO_VEC& info_vector()
@@ -122,6 +150,24 @@ BDD_ITE_MAP& ite_map()
     return im;
 }
 
+struct BDD_GC_INFO {
+    std::vector<size_t>	free_slots;
+    size_t		threshold;	// 0 means never collect automatically
+    size_t		made_since;	// nodes made since the last collection
+    size_t		collections;
+    size_t		last_freed;
+
+    BDD_GC_INFO() : threshold(1 << 20),made_since(0),collections(0),
+	last_freed(0) {}
+};
+
+static
+BDD_GC_INFO& gc_info()
+{
+    static BDD_GC_INFO gi;
+    return gi;
+}
+
 
 bddref_t bdd_node(bddvar_t vnum, bddref_t avec, bddref_t sans)
 {
@@ -160,8 +206,17 @@ bddref_t bdd_node(bddvar_t vnum, bddref_t avec, bddref_t sans)
 	}
     }
 
-    bddref_t new_index = (bddref_t)(iv.size() + 2);
-    iv.push_back(info);
+    BDD_GC_INFO& gi = gc_info();
+    bddref_t new_index;
+    if (gi.free_slots.empty()) {
+	new_index = (bddref_t)(iv.size() + 2);
+	iv.push_back(info);
+    } else {
+	new_index = (bddref_t)(gi.free_slots.back() + 2);
+	gi.free_slots.pop_back();
+	iv[new_index-2] = info;
+    }
+    gi.made_since++;
 
     tm[rep_p] = new_index;
     return new_index;
@@ -176,6 +231,26 @@ bddref_t bdd_ite(bddref_t i, bddref_t t, bddref_t e)
 	return t;
     if (i == bdd_false)
 	return e;
+    if (t == bdd_true && e == bdd_false)
+	return i;
+    if (t == bdd_false && e == bdd_true)
+	return -i;
+
+    // Standard simplifications when i reappears as t or e
+    if (i == t)
+	t = bdd_true;
+    else if (i == -t)
+	t = bdd_false;
+    if (i == e)
+	e = bdd_false;
+    else if (i == -e)
+	e = bdd_true;
+    if (t == e)
+	return t;
+    if (t == bdd_true && e == bdd_false)
+	return i;
+    if (t == bdd_false && e == bdd_true)
+	return -i;
 
     // No?  Look it up in the cache!!
     BDD_ITE_MAP& im = ite_map();
@@ -258,12 +333,155 @@ bddref_t bdd_ite(bddref_t i, bddref_t t, bddref_t e)
     return out;
 }
 
+static bool
+bdd_is_free(bddref_t r)
+{
+    if (r == bdd_true || r == bdd_false)
+	return false;
+    return info_vector()[(r < 0 ? -r : r) - 2].trip.vnum == BDD_FREE_VNUM;
+}
+
+/*
+ * Mark everything reachable from a node held by Python, then sweep the
+ * rest onto the free list.  Collected slots are reused in place rather
+ * than compacted: a BDD object hashes by its index, so live indices must
+ * never move.  Trailing free slots are trimmed off the node vector.
+ *
+ * Only call this between operations; bddrefs held on the C++ stack
+ * are not roots.
+ */
+size_t bdd_collect()
+{
+    BDD_INFO_VEC& iv = info_vector();
+    BDD_TRIPLE_MAP& tm = triple_map();
+    BDD_ITE_MAP& im = ite_map();
+    BDD_GC_INFO& gi = gc_info();
+
+    std::vector<bool> marked(iv.size(), false);
+    std::vector<size_t> stack;
+    for (size_t k=0 ; k<iv.size() ; k++) {
+	if (iv[k].pyrefs > 0)
+	    stack.push_back(k);
+    }
+    while (!stack.empty()) {
+	size_t k = stack.back();
+	stack.pop_back();
+	if (marked[k])
+	    continue;
+	marked[k] = true;
+
+	bddref_t two[] = { iv[k].trip.avec, iv[k].trip.sans };
+	for (int i=0 ; i<2 ; i++) {
+	    if (two[i] != bdd_true && two[i] != bdd_false)
+		stack.push_back((two[i] < 0 ? -two[i] : two[i]) - 2);
+	}
+    }
+
+    size_t freed = 0;
+    for (size_t k=0 ; k<iv.size() ; k++) {
+	if (marked[k] || iv[k].trip.vnum == BDD_FREE_VNUM)
+	    continue;
+	tm.erase(iv[k].trip);
+	iv[k].trip = BDD_TRIPLE(BDD_FREE_VNUM, 0, 0);
+	freed++;
+    }
+
+    for (BDD_ITE_MAP::iterator it = im.begin() ; it != im.end() ; ) {
+	if (bdd_is_free(it->first.i) || bdd_is_free(it->first.t) ||
+	    bdd_is_free(it->first.e) || bdd_is_free(it->second))
+	{
+	    it = im.erase(it);
+	} else {
+	    ++it;
+	}
+    }
+
+    while (!iv.empty() && iv.back().trip.vnum == BDD_FREE_VNUM)
+	iv.pop_back();
+    if (iv.capacity() > 2 * iv.size())
+	iv.shrink_to_fit();
+
+    // Highest slot on top, so new nodes fill in from the bottom
+    gi.free_slots.clear();
+    for (size_t k=iv.size() ; k>0 ; k--) {
+	if (iv[k-1].trip.vnum == BDD_FREE_VNUM)
+	    gi.free_slots.push_back(k-1);
+    }
+    gi.free_slots.shrink_to_fit();
+    tm.rehash(0);
+    im.rehash(0);
+
+    gi.made_since = 0;
+    gi.collections++;
+    gi.last_freed = freed;
+    return freed;
+}
+
+static void
+bdd_maybe_collect()
+{
+    BDD_GC_INFO& gi = gc_info();
+    if (gi.threshold == 0 || gi.made_since < gi.threshold)
+	return;
+    bdd_collect();
+}
+
+bddvar_t bdd_vnum(bddref_t r)
+{
+    if (r == bdd_true || r == bdd_false)
+	return BDD_LEAF_VNUM;
+    return info_vector()[(r < 0 ? -r : r) - 2].trip.vnum;
+}
+
+bddref_t bdd_avec(bddref_t r)
+{
+    if (r == bdd_true || r == bdd_false)
+	return r;
+    else if (r > 0)
+	return info_vector()[r-2].trip.avec;
+    else
+	return -info_vector()[-r-2].trip.avec;
+}
+
+bddref_t bdd_sans(bddref_t r)
+{
+    if (r == bdd_true || r == bdd_false)
+	return r;
+    else if (r > 0)
+	return info_vector()[r-2].trip.sans;
+    else
+	return -info_vector()[-r-2].trip.sans;
+}
+
 
 typedef struct {
     PyObject_HEAD
     bddref_t	index;
 } BDDObject;
 
+static void
+pyref_incr(bddref_t r)
+{
+    if (r == 0 || r == bdd_true || r == bdd_false)
+	return;
+    info_vector()[(r < 0 ? -r : r) - 2].pyrefs++;
+}
+
+static void
+pyref_decr(bddref_t r)
+{
+    if (r == 0 || r == bdd_true || r == bdd_false)
+	return;
+    info_vector()[(r < 0 ? -r : r) - 2].pyrefs--;
+}
+
+static void
+BDD_dealloc(BDDObject* self)
+{
+    pyref_decr(self->index);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
 static PyObject*
 BDD_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
 {
@@ -281,7 +499,15 @@ BDD_init(BDDObject* self, PyObject* args, PyObject* kwds)
     if (!PyArg_ParseTuple(args, "i", &vnum))
 	return -1;
 
+    if (vnum < 0 || vnum >= BDD_LEAF_VNUM) {
+	PyErr_Format(PyExc_ValueError, "Bad variable number %d", vnum);
+	return -1;
+    }
+
+    bdd_maybe_collect();
+    pyref_decr(self->index);
     self->index = bdd_node(vnum, bdd_true, bdd_false);
+    pyref_incr(self->index);
     return 0;
 }
 
@@ -355,9 +581,9 @@ BDD_eval_pset(PyObject* self, PyObject* args)
 	    return NULL;
 	}
 	if (cur == bdd_true)
-	    return Py_True;
+	    Py_RETURN_TRUE;
 	else if (cur == bdd_false)
-	    return Py_False;
+	    Py_RETURN_FALSE;
 
 	if (cur > 0) {
 	    const BDD_INFO& bi = iv[cur-2];
@@ -378,6 +604,17 @@ BDD_eval_pset(PyObject* self, PyObject* args)
 }
 
 
+static int
+append_vnum(PyObject* list, bddvar_t vnum)
+{
+    PyObject* item = PyLong_FromLong(vnum);
+    if (item == NULL)
+	return -1;
+    int ret = PyList_Append(list, item);
+    Py_DECREF(item);
+    return ret;
+}
+
 static PyObject*
 BDD_get_pindex(PyObject* self, PyObject* args)
 {
@@ -410,7 +647,7 @@ BDD_get_pindex(PyObject* self, PyObject* args)
 
 	    j128_t ac = bddref_pcount(bi.trip.avec);
 	    if (index < ac) {
-		if (PyList_Append(out_list, Py_BuildValue("i", bi.trip.vnum)) < 0) {
+		if (append_vnum(out_list, bi.trip.vnum) < 0) {
 		    Py_DECREF(out_list);
 		    return NULL;
 		}
@@ -425,7 +662,7 @@ BDD_get_pindex(PyObject* self, PyObject* args)
 	    const BDD_INFO& bi = iv[-cur-2];
 	    j128_t ac = bddref_pcount(-bi.trip.avec);
 	    if (index < ac) {
-		if (PyList_Append(out_list, Py_BuildValue("i", bi.trip.vnum)) < 0) {
+		if (append_vnum(out_list, bi.trip.vnum) < 0) {
 		    Py_DECREF(out_list);
 		    return NULL;
 		}
@@ -453,6 +690,7 @@ static PyObject* BDD_split(PyObject* self, PyObject* args);
 static PyObject* BDD_false(PyObject* self, PyObject* args);
 static PyObject* BDD_true(PyObject* self, PyObject* args);
 static PyObject* BDD_thenelse(PyObject* self, PyObject* args);
+static PyObject* BDD_node_count(PyObject* self, PyObject* args);
 
 static PyNumberMethods BDDNumberMethods = {
     .nb_subtract = BDD_sub,
@@ -471,6 +709,7 @@ static PyMethodDef BDDRegularMethods[] = {
     { "false", BDD_false, METH_NOARGS | METH_STATIC, "Return the constant False BDD" },
     { "true", BDD_true, METH_NOARGS | METH_STATIC, "Return the constant True BDD" },
     { "thenelse", BDD_thenelse, METH_VARARGS, "Return a BDD for if (self) then (first arg) else (second arg)" },
+    { "node_count", BDD_node_count, METH_NOARGS, "Return the number of nodes in the diagram" },
     { NULL, NULL, 0, NULL },
 };
 
@@ -480,6 +719,7 @@ static PyTypeObject BDDType = {
     .tp_name = "bridgemoose.jbdd.BDD",
     .tp_basicsize = sizeof(BDDObject),
     .tp_itemsize = 0,
+    .tp_dealloc = (destructor) BDD_dealloc,
     .tp_as_number = &BDDNumberMethods,
     .tp_hash = (hashfunc) BDD_hash,
     .tp_flags = Py_TPFLAGS_DEFAULT,
@@ -494,8 +734,10 @@ static PyObject*
 bddref_to_pyobject(bddref_t bdd)
 {
     BDDObject* out = PyObject_New(BDDObject, &BDDType);
-    if (out != NULL)
+    if (out != NULL) {
 	out->index = bdd;
+	pyref_incr(bdd);
+    }
     return (PyObject*)out;
 }
 
@@ -527,7 +769,7 @@ BDD_richcompare(PyObject* a, PyObject* b, int op)
     CHECK_TYPE(a);
     CHECK_TYPE(b);
     if (op != Py_NE && op != Py_EQ)
-	return Py_NotImplemented;
+	Py_RETURN_NOTIMPLEMENTED;
 
     BDDObject* ba = (BDDObject*)a;
     BDDObject* bb = (BDDObject*)b;
@@ -555,6 +797,7 @@ BDD_and(PyObject* a, PyObject* b)
 {
     CHECK_TYPE(a);
     CHECK_TYPE(b);
+    bdd_maybe_collect();
 
     BDDObject* bdd_a = (BDDObject*)a;
     BDDObject* bdd_b = (BDDObject*)b;
@@ -568,6 +811,7 @@ BDD_or(PyObject* a, PyObject* b)
 {
     CHECK_TYPE(a);
     CHECK_TYPE(b);
+    bdd_maybe_collect();
 
     BDDObject* bdd_a = (BDDObject*)a;
     BDDObject* bdd_b = (BDDObject*)b;
@@ -580,6 +824,7 @@ BDD_xor(PyObject* a, PyObject* b)
 {
     CHECK_TYPE(a);
     CHECK_TYPE(b);
+    bdd_maybe_collect();
 
     BDDObject* bdd_a = (BDDObject*)a;
     BDDObject* bdd_b = (BDDObject*)b;
@@ -592,6 +837,7 @@ BDD_sub(PyObject* a, PyObject* b)
 {
     CHECK_TYPE(a);
     CHECK_TYPE(b);
+    bdd_maybe_collect();
 
     BDDObject* bdd_a = (BDDObject*)a;
     BDDObject* bdd_b = (BDDObject*)b;
@@ -629,6 +875,7 @@ BDD_thenelse(PyObject* self, PyObject* args)
 
     if (!PyArg_ParseTuple(args, "O!O!", &BDDType, &pt, &BDDType, &pe))
 	return NULL;
+    bdd_maybe_collect();
 
     bddref_t i = bo->index;
     bddref_t t = ((BDDObject*)pt)->index;
@@ -637,6 +884,14 @@ BDD_thenelse(PyObject* self, PyObject* args)
     return bddref_to_pyobject(bdd_ite(i, t, e));
 }
 
+static PyObject*
+BDD_node_count(PyObject* self, PyObject* args)
+{
+    (void)args;
+    std::vector<bddref_t> roots(1, ((BDDObject*)self)->index);
+    return PyLong_FromSize_t(bdd_node_count(roots));
+}
+
 static PyObject*
 jbdd_test(PyObject* self, PyObject* args)
 {
@@ -652,9 +907,598 @@ jbdd_test(PyObject* self, PyObject* args)
     return out;
 }
 
+/*
+ * Metrics cross the Python boundary as {int value: BDD} dictionaries,
+ * the same representation HandSetMetric.values uses.
+ */
+static int
+pydict_to_partition(PyObject* dict, METRIC_PARTITION& out)
+{
+    if (!PyDict_Check(dict)) {
+	PyErr_SetString(PyExc_TypeError, "Expected a dict of int -> BDD");
+	return -1;
+    }
+
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+	long long v = PyLong_AsLongLong(key);
+	if (v == -1 && PyErr_Occurred())
+	    return -1;
+	if (!Py_IS_TYPE(value, &BDDType)) {
+	    PyErr_SetString(PyExc_TypeError, "Only BDD Objects accepted");
+	    return -1;
+	}
+	bddref_t b = ((BDDObject*)value)->index;
+	if (b != bdd_false)
+	    out.push_back(std::make_pair((metric_val_t)v, b));
+    }
+    std::sort(out.begin(), out.end());
+    return 0;
+}
+
+static PyObject*
+partition_to_pydict(const METRIC_PARTITION& part)
+{
+    PyObject* out = PyDict_New();
+    if (out == NULL)
+	return NULL;
+
+    for (size_t i=0 ; i<part.size() ; i++) {
+	PyObject* key = PyLong_FromLongLong(part[i].first);
+	PyObject* value = bddref_to_pyobject(part[i].second);
+	if (key == NULL || value == NULL || PyDict_SetItem(out, key, value) < 0) {
+	    Py_XDECREF(key);
+	    Py_XDECREF(value);
+	    Py_DECREF(out);
+	    return NULL;
+	}
+	Py_DECREF(key);
+	Py_DECREF(value);
+    }
+    return out;
+}
+
+static PyObject*
+jbdd_metric_arith(PyObject* args, METRIC_OP op)
+{
+    PyObject* da;
+    PyObject* db;
+    if (!PyArg_ParseTuple(args, "OO", &da, &db))
+	return NULL;
+
+    METRIC_PARTITION pa, pb, out;
+    if (pydict_to_partition(da, pa) < 0 || pydict_to_partition(db, pb) < 0)
+	return NULL;
+    bdd_maybe_collect();
+
+    metric_arith(op, pa, pb, out);
+    return partition_to_pydict(out);
+}
+
+static PyObject*
+jbdd_metric_add(PyObject* self, PyObject* args)
+{
+    (void)self;
+    return jbdd_metric_arith(args, METRIC_ADD);
+}
+
+static PyObject*
+jbdd_metric_sub(PyObject* self, PyObject* args)
+{
+    (void)self;
+    return jbdd_metric_arith(args, METRIC_SUB);
+}
+
+static PyObject*
+jbdd_metric_from_weights(PyObject* self, PyObject* args)
+{
+    (void)self;
+    PyObject* dict;
+    if (!PyArg_ParseTuple(args, "O!", &PyDict_Type, &dict))
+	return NULL;
+
+    std::map<bddvar_t, metric_val_t> weights;
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+	long var = PyLong_AsLong(key);
+	if (var == -1 && PyErr_Occurred())
+	    return NULL;
+	long long w = PyLong_AsLongLong(value);
+	if (w == -1 && PyErr_Occurred())
+	    return NULL;
+	if (var < 0 || var >= BDD_LEAF_VNUM)
+	    return PyErr_Format(PyExc_ValueError, "Bad variable number %ld", var);
+	weights[(bddvar_t)var] = w;
+    }
+
+    bdd_maybe_collect();
+    METRIC_PARTITION part;
+    metric_from_weights(weights, part);
+    return partition_to_pydict(part);
+}
+
+static PyObject*
+jbdd_metric_less_than(PyObject* self, PyObject* args)
+{
+    (void)self;
+    PyObject* dict;
+    long long n;
+    if (!PyArg_ParseTuple(args, "OL", &dict, &n))
+	return NULL;
+
+    METRIC_PARTITION part;
+    if (pydict_to_partition(dict, part) < 0)
+	return NULL;
+    bdd_maybe_collect();
+
+    return bddref_to_pyobject(metric_less_than(part, n));
+}
+
+static PyObject*
+jbdd_collect(PyObject* self, PyObject* args)
+{
+    (void)self;
+    (void)args;
+    return PyLong_FromSize_t(bdd_collect());
+}
+
+static PyObject*
+jbdd_set_gc_threshold(PyObject* self, PyObject* args)
+{
+    (void)self;
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n))
+	return NULL;
+    if (n < 0)
+	return PyErr_Format(PyExc_ValueError, "Threshold must be >= 0");
+
+    gc_info().threshold = (size_t)n;
+    Py_RETURN_NONE;
+}
+
+static PyObject*
+jbdd_stats(PyObject* self, PyObject* args)
+{
+    (void)self;
+    (void)args;
+    const BDD_INFO_VEC& iv = info_vector();
+    const BDD_TRIPLE_MAP& tm = triple_map();
+    const BDD_ITE_MAP& im = ite_map();
+    const BDD_GC_INFO& gi = gc_info();
+
+    size_t pyrefs = 0;
+    for (size_t k=0 ; k<iv.size() ; k++)
+	pyrefs += iv[k].pyrefs;
+
+    // Hash tables: one heap node per entry (value plus the next pointer
+    // and cached hash) and one pointer per bucket.
+    size_t node_bytes = iv.capacity() * sizeof(BDD_INFO) +
+	gi.free_slots.capacity() * sizeof(size_t);
+    size_t triple_bytes = tm.size() *
+	(sizeof(BDD_TRIPLE_MAP::value_type) + 2*sizeof(void*)) +
+	tm.bucket_count() * sizeof(void*);
+    size_t ite_bytes = im.size() *
+	(sizeof(BDD_ITE_MAP::value_type) + 2*sizeof(void*)) +
+	im.bucket_count() * sizeof(void*);
+
+    return Py_BuildValue("{s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n}",
+	"nodes", (Py_ssize_t)(iv.size() - gi.free_slots.size()),
+	"slots", (Py_ssize_t)iv.size(),
+	"free_slots", (Py_ssize_t)gi.free_slots.size(),
+	"python_refs", (Py_ssize_t)pyrefs,
+	"unique_entries", (Py_ssize_t)tm.size(),
+	"ite_cache_entries", (Py_ssize_t)im.size(),
+	"node_bytes", (Py_ssize_t)node_bytes,
+	"unique_bytes", (Py_ssize_t)triple_bytes,
+	"ite_cache_bytes", (Py_ssize_t)ite_bytes,
+	"bytes", (Py_ssize_t)(node_bytes + triple_bytes + ite_bytes),
+	"collections", (Py_ssize_t)gi.collections,
+	"last_freed", (Py_ssize_t)gi.last_freed);
+}
+
+static PyObject*
+jbdd_save(PyObject* self, PyObject* args)
+{
+    (void)self;
+    const char* path;
+    PyObject* dict;
+    if (!PyArg_ParseTuple(args, "sO!", &path, &PyDict_Type, &dict))
+	return NULL;
+
+    BDD_NAMED_ROOTS roots;
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+	Py_ssize_t len;
+	const char* name = PyUnicode_AsUTF8AndSize(key, &len);
+	if (name == NULL)
+	    return NULL;
+	if (!Py_IS_TYPE(value, &BDDType)) {
+	    PyErr_SetString(PyExc_TypeError, "Only BDD Objects accepted");
+	    return NULL;
+	}
+	roots.push_back(std::make_pair(std::string(name, len),
+	    ((BDDObject*)value)->index));
+    }
+
+    std::string err;
+    if (!bdd_save(path, roots, err))
+	return PyErr_Format(PyExc_OSError, "%s", err.c_str());
+    Py_RETURN_NONE;
+}
+
+static PyObject*
+jbdd_load(PyObject* self, PyObject* args)
+{
+    (void)self;
+    const char* path;
+    if (!PyArg_ParseTuple(args, "s", &path))
+	return NULL;
+    bdd_maybe_collect();
+
+    BDD_NAMED_ROOTS roots;
+    std::string err;
+    if (!bdd_load(path, roots, err))
+	return PyErr_Format(PyExc_ValueError, "%s", err.c_str());
+
+    PyObject* out = PyDict_New();
+    if (out == NULL)
+	return NULL;
+    for (size_t i=0 ; i<roots.size() ; i++) {
+	PyObject* value = bddref_to_pyobject(roots[i].second);
+	if (value == NULL ||
+	    PyDict_SetItemString(out, roots[i].first.c_str(), value) < 0)
+	{
+	    Py_XDECREF(value);
+	    Py_DECREF(out);
+	    return NULL;
+	}
+	Py_DECREF(value);
+    }
+    return out;
+}
+
+static int
+pyiter_to_refs(PyObject* obj, std::vector<bddref_t>& out)
+{
+    PyObject* iter = PyObject_GetIter(obj);
+    if (iter == NULL)
+	return -1;
+
+    PyObject* item;
+    while ((item = PyIter_Next(iter))) {
+	if (!Py_IS_TYPE(item, &BDDType)) {
+	    Py_DECREF(item);
+	    Py_DECREF(iter);
+	    PyErr_SetString(PyExc_TypeError, "Only BDD Objects accepted");
+	    return -1;
+	}
+	out.push_back(((BDDObject*)item)->index);
+	Py_DECREF(item);
+    }
+    Py_DECREF(iter);
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+static PyObject*
+perm_to_pydict(const BDD_PERM& perm)
+{
+    PyObject* out = PyDict_New();
+    if (out == NULL)
+	return NULL;
+
+    for (BDD_PERM::const_iterator it = perm.begin() ; it != perm.end() ; ++it) {
+	PyObject* key = PyLong_FromLong(it->first);
+	PyObject* value = PyLong_FromLong(it->second);
+	if (key == NULL || value == NULL || PyDict_SetItem(out, key, value) < 0) {
+	    Py_XDECREF(key);
+	    Py_XDECREF(value);
+	    Py_DECREF(out);
+	    return NULL;
+	}
+	Py_DECREF(key);
+	Py_DECREF(value);
+    }
+    return out;
+}
+
+static PyObject*
+jbdd_node_count(PyObject* self, PyObject* args)
+{
+    (void)self;
+    PyObject* obj;
+    if (!PyArg_ParseTuple(args, "O", &obj))
+	return NULL;
+
+    std::vector<bddref_t> roots;
+    if (pyiter_to_refs(obj, roots) < 0)
+	return NULL;
+    return PyLong_FromSize_t(bdd_node_count(roots));
+}
+
+static PyObject*
+jbdd_permute(PyObject* self, PyObject* args)
+{
+    (void)self;
+    PyObject* bdd;
+    PyObject* dict;
+    if (!PyArg_ParseTuple(args, "O!O!", &BDDType, &bdd, &PyDict_Type, &dict))
+	return NULL;
+
+    BDD_PERM perm;
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+	long from = PyLong_AsLong(key);
+	if (from == -1 && PyErr_Occurred())
+	    return NULL;
+	long to = PyLong_AsLong(value);
+	if (to == -1 && PyErr_Occurred())
+	    return NULL;
+	if (from < 0 || from >= BDD_LEAF_VNUM || to < 0 || to >= BDD_LEAF_VNUM)
+	    return PyErr_Format(PyExc_ValueError, "Bad variable number");
+	perm[(bddvar_t)from] = (bddvar_t)to;
+    }
+    bdd_maybe_collect();
+
+    return bddref_to_pyobject(bdd_permute(((BDDObject*)bdd)->index, perm));
+}
+
+static PyObject*
+jbdd_sift(PyObject* self, PyObject* args)
+{
+    (void)self;
+    PyObject* obj;
+    double max_growth = 1.2;
+    int group = 1;
+    if (!PyArg_ParseTuple(args, "O|di", &obj, &max_growth, &group))
+	return NULL;
+    if (max_growth < 1.0)
+	return PyErr_Format(PyExc_ValueError, "max_growth must be at least 1.0");
+    if (group < 1)
+	return PyErr_Format(PyExc_ValueError, "group must be at least 1");
+
+    // The BDD objects keep their nodes from the collector, so hold on
+    // to them until the sifter has taken the roots; a generator would
+    // otherwise drop each one as soon as it was read.
+    PyObject* items = PySequence_List(obj);
+    if (items == NULL)
+	return NULL;
+    std::vector<bddref_t> roots;
+    if (pyiter_to_refs(items, roots) < 0) {
+	Py_DECREF(items);
+	return NULL;
+    }
+    bdd_maybe_collect();
+
+    BDD_SIFTER sifter(roots);
+    Py_DECREF(items);
+    sifter.sift(max_growth, group);
+
+    BDD_PERM perm;
+    sifter.permutation(perm);
+    std::vector<bddref_t> sifted;
+    sifter.export_roots(sifted);
+
+    PyObject* list = PyList_New(sifted.size());
+    if (list == NULL)
+	return NULL;
+    for (size_t i=0 ; i<sifted.size() ; i++) {
+	PyObject* b = bddref_to_pyobject(sifted[i]);
+	if (b == NULL) {
+	    Py_DECREF(list);
+	    return NULL;
+	}
+	PyList_SET_ITEM(list, i, b);
+    }
+
+    PyObject* pdict = perm_to_pydict(perm);
+    if (pdict == NULL) {
+	Py_DECREF(list);
+	return NULL;
+    }
+    return Py_BuildValue("NN", list, pdict);
+}
+
+
+typedef struct {
+    PyObject_HEAD
+    BDD_DEALER*	dealer;
+    bool	busy;	// a deal() is running with the GIL released
+} DealerObject;
+
+// deal() takes the GIL back this often to look for signals
+static const uint64_t DEALER_SIGNAL_TRIES = 1 << 20;
+
+static void
+Dealer_dealloc(DealerObject* self)
+{
+    delete self->dealer;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject*
+Dealer_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
+{
+    DealerObject* self = (DealerObject*) type->tp_alloc(type, 0);
+    if (self != NULL) {
+	self->dealer = NULL;
+	self->busy = false;
+    }
+    return (PyObject*) self;
+}
+
+// Reads exactly DEALER_SEATS items; None in a constraint means bdd_true
+static int
+pyseq_to_seats(PyObject* obj, uint64_t fixed[DEALER_SEATS],
+    bddref_t constraint[DEALER_SEATS])
+{
+    PyObject* seq = PySequence_Fast(obj, "Expected a sequence");
+    if (seq == NULL)
+	return -1;
+    if (PySequence_Fast_GET_SIZE(seq) != DEALER_SEATS) {
+	Py_DECREF(seq);
+	PyErr_Format(PyExc_ValueError, "Expected %d seats", DEALER_SEATS);
+	return -1;
+    }
+
+    for (int s=0 ; s<DEALER_SEATS ; s++) {
+	PyObject* item = PySequence_Fast_GET_ITEM(seq, s);
+	if (fixed != NULL) {
+	    fixed[s] = PyLong_AsUnsignedLongLong(item);
+	    if (PyErr_Occurred()) {
+		Py_DECREF(seq);
+		return -1;
+	    }
+	} else if (item == Py_None) {
+	    constraint[s] = bdd_true;
+	} else if (Py_IS_TYPE(item, &BDDType)) {
+	    constraint[s] = ((BDDObject*)item)->index;
+	} else {
+	    Py_DECREF(seq);
+	    PyErr_SetString(PyExc_TypeError, "Only BDD Objects or None accepted");
+	    return -1;
+	}
+    }
+    Py_DECREF(seq);
+    return 0;
+}
+
+static int
+Dealer_init(DealerObject* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* py_fixed;
+    PyObject* py_constraints;
+    PyObject* py_seed;
+    if (!PyArg_ParseTuple(args, "OOO", &py_fixed, &py_constraints, &py_seed))
+	return -1;
+    if (self->busy) {
+	PyErr_SetString(PyExc_RuntimeError, "Dealer is busy in another thread");
+	return -1;
+    }
+
+    uint64_t fixed[DEALER_SEATS];
+    bddref_t constraint[DEALER_SEATS];
+    if (pyseq_to_seats(py_fixed, fixed, NULL) < 0)
+	return -1;
+    if (pyseq_to_seats(py_constraints, NULL, constraint) < 0)
+	return -1;
+    uint64_t seed = PyLong_AsUnsignedLongLongMask(py_seed);
+    if (PyErr_Occurred())
+	return -1;
+
+    BDD_DEALER* dealer = new BDD_DEALER;
+    std::string err;
+    if (!dealer->init(fixed, constraint, seed, err)) {
+	delete dealer;
+	PyErr_Format(PyExc_ValueError, "Bad dealer: %s", err.c_str());
+	return -1;
+    }
+    delete self->dealer;
+    self->dealer = dealer;
+    return 0;
+}
+
+static PyObject*
+Dealer_deal(PyObject* self, PyObject* args)
+{
+    DealerObject* dobj = (DealerObject*)self;
+    BDD_DEALER* dealer = dobj->dealer;
+    Py_ssize_t count;
+    unsigned long long max_tries = 0;
+    if (!PyArg_ParseTuple(args, "n|K", &count, &max_tries))
+	return NULL;
+    if (dealer == NULL)
+	return PyErr_Format(PyExc_ValueError, "Dealer not initialized");
+    if (count < 0)
+	return PyErr_Format(PyExc_ValueError, "Negative count");
+
+    if (dobj->busy)
+	return PyErr_Format(PyExc_RuntimeError, "Dealer is busy in another thread");
+
+    // The busy flag keeps other threads off the dealer while the GIL is
+    // released, and the GIL comes back between rounds so that Ctrl-C can
+    // stop an unlimited search for deals that do not exist.
+    std::vector<uint64_t> hands;
+    uint64_t tries = 0;
+    dobj->busy = true;
+    while (hands.size() < (size_t)count * DEALER_SEATS &&
+	(max_tries == 0 || tries < max_tries))
+    {
+	uint64_t round = DEALER_SIGNAL_TRIES;
+	if (max_tries != 0 && max_tries - tries < round)
+	    round = max_tries - tries;
+	size_t left = (size_t)count - hands.size() / DEALER_SEATS;
+
+	Py_BEGIN_ALLOW_THREADS
+	tries += dealer->deal(left, round, hands);
+	Py_END_ALLOW_THREADS
+
+	if (PyErr_CheckSignals() < 0) {
+	    dobj->busy = false;
+	    return NULL;
+	}
+    }
+    dobj->busy = false;
+
+    size_t found = hands.size() / DEALER_SEATS;
+    PyObject* list = PyList_New(found);
+    if (list == NULL)
+	return NULL;
+    for (size_t i=0 ; i<found ; i++) {
+	const uint64_t* h = &hands[i * DEALER_SEATS];
+	PyObject* tupe = Py_BuildValue("KKKK", (unsigned long long)h[0],
+	    (unsigned long long)h[1], (unsigned long long)h[2],
+	    (unsigned long long)h[3]);
+	if (tupe == NULL) {
+	    Py_DECREF(list);
+	    return NULL;
+	}
+	PyList_SET_ITEM(list, i, tupe);
+    }
+    return Py_BuildValue("NK", list, (unsigned long long)tries);
+}
+
+static PyMethodDef DealerMethods[] = {
+    { "deal", Dealer_deal, METH_VARARGS, "deal(count, max_tries=0) returns ([(w, n, e, s) card masks], tries); max_tries 0 is unlimited" },
+    { NULL, NULL, 0, NULL },
+};
+
+static PyTypeObject DealerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "bridgemoose.jbdd.Dealer",
+    .tp_basicsize = sizeof(DealerObject),
+    .tp_itemsize = 0,
+    .tp_dealloc = (destructor) Dealer_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = PyDoc_STR("Dealer((w, n, e, s) fixed card masks, (w, n, e, s) BDD or None, seed)\n"
+	"Random deals over cards 0..51 in HandSet variable order"),
+    .tp_methods = DealerMethods,
+    .tp_init = (initproc) Dealer_init,
+    .tp_new = Dealer_new,
+};
+
 
 static PyMethodDef jbdd_methods[] = {
     {"test", jbdd_test, METH_VARARGS, "Generic test method"},
+    {"metric_add", jbdd_metric_add, METH_VARARGS, "Sum of two {value: BDD} metrics, as a new metric"},
+    {"metric_sub", jbdd_metric_sub, METH_VARARGS, "Difference of two {value: BDD} metrics, as a new metric"},
+    {"metric_from_weights", jbdd_metric_from_weights, METH_VARARGS, "Metric for the sum of {var: weight} over the variables set"},
+    {"metric_less_than", jbdd_metric_less_than, METH_VARARGS, "BDD for where a {value: BDD} metric is below n"},
+    {"collect", jbdd_collect, METH_NOARGS, "Free nodes unreachable from any live BDD object; returns the number freed"},
+    {"set_gc_threshold", jbdd_set_gc_threshold, METH_VARARGS, "Collect automatically after this many new nodes (0 to disable)"},
+    {"stats", jbdd_stats, METH_NOARGS, "Return a dict of node counts, cache sizes and bytes used"},
+    {"save", jbdd_save, METH_VARARGS, "save(path, {name: BDD}) writes the BDDs and their shared nodes to a file"},
+    {"load", jbdd_load, METH_VARARGS, "load(path) reads a file from save() back as {name: BDD}"},
+    {"node_count", jbdd_node_count, METH_VARARGS, "Number of distinct nodes shared by an iterable of BDDs"},
+    {"permute", jbdd_permute, METH_VARARGS, "permute(bdd, {var: new_var}) renames variables, and so reorders them"},
+    {"sift", jbdd_sift, METH_VARARGS, "sift(bdds, max_growth=1.2, group=1) reorders variables to shrink the BDDs; returns (new_bdds, {var: new_var})"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -672,6 +1516,8 @@ PyInit_jbdd(void)
     PyObject *m;
     if (PyType_Ready(&BDDType) < 0)
 	return NULL;
+    if (PyType_Ready(&DealerType) < 0)
+	return NULL;
 
     m = PyModule_Create(&jbdd_module);
     if (m == NULL)
@@ -684,5 +1530,12 @@ PyInit_jbdd(void)
 	return NULL;
     }
 
+    Py_INCREF(&DealerType);
+    if (PyModule_AddObject(m, "Dealer", (PyObject*) &DealerType) < 0) {
+	Py_DECREF(&DealerType);
+	Py_DECREF(m);
+	return NULL;
+    }
+
     return m;
 }
@@ -6,7 +6,15 @@ const bddref_t bdd_true = 1;
 const bddref_t bdd_false = -1;
 typedef int bddvar_t;
 
+// bdd_vnum() of a constant; larger than any real variable
+const bddvar_t BDD_LEAF_VNUM = 0x7fffffff;
+
 bddref_t bdd_node(bddvar_t vnum, bddref_t avec, bddref_t sans);
 bddref_t bdd_ite(bddref_t i, bddref_t t, bddref_t e);
+size_t bdd_collect();
+
+bddvar_t bdd_vnum(bddref_t r);
+bddref_t bdd_avec(bddref_t r);
+bddref_t bdd_sans(bddref_t r);
 
 #endif // _JBDD_H_
@@ -0,0 +1,238 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include "jbddfile.h"
+
+static const char BDD_FILE_MAGIC[4] = { 'J', 'B', 'D', 'D' };
+static const uint32_t BDD_FILE_VERSION = 1;
+
+struct BDD_FILE_HEADER {
+    char	magic[4];
+    uint32_t	version;
+    uint32_t	nroots;
+    uint32_t	nnodes;
+};
+
+struct BDD_FILE_NODE {
+    int32_t	vnum;
+    int32_t	avec;
+    int32_t	sans;
+};
+
+
+static bool
+sys_error(std::string& err, const char* what, const char* path)
+{
+    err = std::string(what) + " " + path + ": " + strerror(errno);
+    return false;
+}
+
+
+bool bdd_save(const char* path, const BDD_NAMED_ROOTS& roots, std::string& err)
+{
+    // Number the nodes children first; keys are positive live refs
+    std::map<bddref_t, int32_t> number;
+    std::vector<BDD_FILE_NODE> nodes;
+    std::vector<std::pair<bddref_t, bool> > stack;
+
+    for (size_t i=0 ; i<roots.size() ; i++)
+	stack.push_back(std::make_pair(roots[i].second, false));
+
+    while (!stack.empty()) {
+	bddref_t r = stack.back().first;
+	bool expanded = stack.back().second;
+	stack.pop_back();
+	if (r < 0)
+	    r = -r;
+	if (r == bdd_true || number.find(r) != number.end())
+	    continue;
+
+	if (!expanded) {
+	    stack.push_back(std::make_pair(r, true));
+	    stack.push_back(std::make_pair(bdd_avec(r), false));
+	    stack.push_back(std::make_pair(bdd_sans(r), false));
+	    continue;
+	}
+
+	if (nodes.size() + 2 > (size_t)INT32_MAX) {
+	    err = "Too many nodes to save";
+	    return false;
+	}
+
+	bddref_t two[] = { bdd_avec(r), bdd_sans(r) };
+	int32_t local[2];
+	for (int i=0 ; i<2 ; i++) {
+	    bddref_t c = two[i];
+	    if (c == bdd_true || c == bdd_false)
+		local[i] = (int32_t)c;
+	    else if (c > 0)
+		local[i] = number[c];
+	    else
+		local[i] = -number[-c];
+	}
+
+	BDD_FILE_NODE fn = { bdd_vnum(r), local[0], local[1] };
+	number[r] = (int32_t)(nodes.size() + 2);
+	nodes.push_back(fn);
+    }
+
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+	return sys_error(err, "Cannot open", path);
+
+    BDD_FILE_HEADER hdr;
+    memcpy(hdr.magic, BDD_FILE_MAGIC, sizeof hdr.magic);
+    hdr.version = BDD_FILE_VERSION;
+    hdr.nroots = (uint32_t)roots.size();
+    hdr.nnodes = (uint32_t)nodes.size();
+
+    bool ok = fwrite(&hdr, sizeof hdr, 1, fp) == 1;
+    if (ok && !nodes.empty())
+	ok = fwrite(&nodes[0], sizeof nodes[0], nodes.size(), fp) == nodes.size();
+
+    for (size_t i=0 ; ok && i<roots.size() ; i++) {
+	const std::string& name = roots[i].first;
+	bddref_t r = roots[i].second;
+	int32_t local;
+	if (r == bdd_true || r == bdd_false)
+	    local = (int32_t)r;
+	else
+	    local = r > 0 ? number[r] : -number[-r];
+
+	uint32_t len = (uint32_t)name.size();
+	ok = fwrite(&len, sizeof len, 1, fp) == 1 &&
+	    fwrite(name.data(), 1, len, fp) == len &&
+	    fwrite(&local, sizeof local, 1, fp) == 1;
+    }
+
+    if (fclose(fp) != 0)
+	ok = false;
+    if (!ok)
+	return sys_error(err, "Error writing", path);
+    return true;
+}
+
+
+static bool
+remap_ref(int32_t local, const std::vector<bddref_t>& live, bddref_t& out)
+{
+    int32_t mag = local < 0 ? -local : local;
+    if (mag == 1) {
+	out = local;
+	return true;
+    }
+    if (mag < 2 || (size_t)(mag - 2) >= live.size())
+	return false;
+    out = local < 0 ? -live[mag-2] : live[mag-2];
+    return true;
+}
+
+
+static bool
+parse_mapped(const char* base, size_t size, BDD_NAMED_ROOTS& roots,
+    std::string& err)
+{
+    BDD_FILE_HEADER hdr;
+    if (size < sizeof hdr) {
+	err = "File too short for a header";
+	return false;
+    }
+    memcpy(&hdr, base, sizeof hdr);
+    if (memcmp(hdr.magic, BDD_FILE_MAGIC, sizeof hdr.magic) != 0) {
+	err = "Not a jbdd file";
+	return false;
+    }
+    if (hdr.version != BDD_FILE_VERSION) {
+	err = "Unsupported jbdd file version";
+	return false;
+    }
+
+    size_t pos = sizeof hdr;
+    if ((size - pos) / sizeof(BDD_FILE_NODE) < hdr.nnodes) {
+	err = "File truncated in the node table";
+	return false;
+    }
+
+    // Children always come first, so only earlier nodes can be referenced
+    std::vector<bddref_t> live;
+    live.reserve(hdr.nnodes);
+    for (uint32_t k=0 ; k<hdr.nnodes ; k++) {
+	BDD_FILE_NODE fn;
+	memcpy(&fn, base + pos, sizeof fn);
+	pos += sizeof fn;
+
+	bddref_t avec, sans;
+	if (fn.vnum < 0 || fn.vnum >= BDD_LEAF_VNUM ||
+	    !remap_ref(fn.avec, live, avec) || !remap_ref(fn.sans, live, sans) ||
+	    bdd_vnum(avec) <= fn.vnum || bdd_vnum(sans) <= fn.vnum)
+	{
+	    err = "Corrupt node table";
+	    return false;
+	}
+	live.push_back(bdd_node(fn.vnum, avec, sans));
+    }
+
+    roots.clear();
+    for (uint32_t i=0 ; i<hdr.nroots ; i++) {
+	uint32_t len;
+	int32_t local;
+	if (size - pos < sizeof len) {
+	    err = "File truncated in the root table";
+	    return false;
+	}
+	memcpy(&len, base + pos, sizeof len);
+	pos += sizeof len;
+	if (size - pos < len || size - pos - len < sizeof local) {
+	    err = "File truncated in the root table";
+	    return false;
+	}
+	std::string name(base + pos, len);
+	pos += len;
+	memcpy(&local, base + pos, sizeof local);
+	pos += sizeof local;
+
+	bddref_t r;
+	if (!remap_ref(local, live, r)) {
+	    err = "Corrupt root table";
+	    return false;
+	}
+	roots.push_back(std::make_pair(name, r));
+    }
+    return true;
+}
+
+
+bool bdd_load(const char* path, BDD_NAMED_ROOTS& roots, std::string& err)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+	return sys_error(err, "Cannot open", path);
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+	close(fd);
+	return sys_error(err, "Cannot stat", path);
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+	close(fd);
+	err = "Empty file";
+	return false;
+    }
+
+    void* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+	return sys_error(err, "Cannot mmap", path);
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    bool ok = parse_mapped((const char*)base, size, roots, err);
+    munmap(base, size);
+    return ok;
+}
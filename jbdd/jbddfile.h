@@ -0,0 +1,30 @@
+#ifndef _JBDDFILE_H_
+#define _JBDDFILE_H_
+
+/*
+ * Saving and loading sets of named BDDs.  The file holds the shared
+ * subgraph once, children before parents, so loading is a single pass of
+ * bdd_node() calls which also remaps the saved node numbers onto whatever
+ * is already in the live store.
+ *
+ * Layout (native byte order):
+ *   header    "JBDD", uint32 version, uint32 root count, uint32 node count
+ *   nodes     int32 vnum, int32 avec, int32 sans
+ *   roots     uint32 name length, name bytes, int32 ref
+ *
+ * Refs inside the file use the same encoding as bddref_t (+-1 for the
+ * constants, +-(k+2) for the k-th node in the file) squeezed to 32 bits.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "jbdd.h"
+
+typedef std::vector<std::pair<std::string, bddref_t> > BDD_NAMED_ROOTS;
+
+// Both return false and set err on failure
+bool bdd_save(const char* path, const BDD_NAMED_ROOTS& roots, std::string& err);
+bool bdd_load(const char* path, BDD_NAMED_ROOTS& roots, std::string& err);
+
+#endif // _JBDDFILE_H_
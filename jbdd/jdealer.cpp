@@ -0,0 +1,198 @@
+#include <inttypes.h>
+#include "jdealer.h"
+
+static inline uint64_t
+rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t
+splitmix64(uint64_t& x)
+{
+    uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static int
+popcount64(uint64_t x)
+{
+    int n = 0;
+    for ( ; x ; x &= x - 1)
+	n++;
+    return n;
+}
+
+
+// xoshiro256**
+uint64_t BDD_DEALER::next()
+{
+    uint64_t out = rotl(rng[1] * 5, 7) * 9;
+    uint64_t t = rng[1] << 17;
+    rng[2] ^= rng[0];
+    rng[3] ^= rng[1];
+    rng[1] ^= rng[2];
+    rng[0] ^= rng[3];
+    rng[2] ^= t;
+    rng[3] = rotl(rng[3], 45);
+    return out;
+}
+
+// Uniform in [0, n), by Lemire's multiply and reject
+uint32_t BDD_DEALER::below(uint32_t n)
+{
+    uint64_t m = (next() >> 32) * n;
+    uint32_t low = (uint32_t)m;
+    if (low < n) {
+	uint32_t floor = (0 - n) % n;
+	while (low < floor) {
+	    m = (next() >> 32) * n;
+	    low = (uint32_t)m;
+	}
+    }
+    return (uint32_t)(m >> 32);
+}
+
+
+int32_t BDD_DEALER::flatten(bddref_t r, std::map<bddref_t, int32_t>& memo,
+    bool& ok)
+{
+    if (r == bdd_false)
+	return 0;
+    if (r == bdd_true)
+	return 1;
+
+    std::map<bddref_t, int32_t>::iterator f = memo.find(r);
+    if (f != memo.end())
+	return f->second;
+
+    bddvar_t var = bdd_vnum(r);
+    if (var < 0 || var >= DEALER_CARDS) {
+	ok = false;
+	return 0;
+    }
+
+    NODE n;
+    n.var = var;
+    n.hi = flatten(bdd_avec(r), memo, ok);
+    n.lo = flatten(bdd_sans(r), memo, ok);
+    int32_t id = (int32_t)nodes.size();
+    nodes.push_back(n);
+    memo[r] = id;
+    return id;
+}
+
+
+bool BDD_DEALER::accepts(int32_t n, uint64_t hand) const
+{
+    while (n >= 2) {
+	const NODE& node = nodes[n];
+	n = ((hand >> node.var) & 1) ? node.hi : node.lo;
+    }
+    return n == 1;
+}
+
+
+bool BDD_DEALER::init(const uint64_t fix[DEALER_SEATS],
+    const bddref_t constraint[DEALER_SEATS], uint64_t seed, std::string& err)
+{
+    const uint64_t all_cards = (1ull << DEALER_CARDS) - 1;
+
+    uint64_t used = 0;
+    for (int s=0 ; s<DEALER_SEATS ; s++) {
+	if (fix[s] & ~all_cards) {
+	    err = "card number out of range";
+	    return false;
+	}
+	if (fix[s] & used) {
+	    err = "card fixed in two hands";
+	    return false;
+	}
+	used |= fix[s];
+
+	fixed[s] = fix[s];
+	need[s] = 13 - popcount64(fix[s]);
+	if (need[s] < 0) {
+	    err = "more than 13 cards fixed in one hand";
+	    return false;
+	}
+    }
+
+    npool = 0;
+    for (int c=0 ; c<DEALER_CARDS ; c++)
+	if (!(used & (1ull << c)))
+	    pool[npool++] = (uint8_t)c;
+
+    NODE term = { -1, 0, 0 };
+    nodes.clear();
+    nodes.push_back(term);
+    nodes.push_back(term);
+
+    std::map<bddref_t, int32_t> memo;
+    bool ok = true;
+    for (int s=0 ; s<DEALER_SEATS ; s++)
+	root[s] = flatten(constraint[s], memo, ok);
+    if (!ok) {
+	err = "constraint uses a variable which is not a card";
+	return false;
+    }
+
+    int k = 0;
+    for (int s=0 ; s<DEALER_SEATS ; s++)
+	if (root[s] != 1)
+	    order[k++] = s;
+    for (int s=0 ; s<DEALER_SEATS ; s++)
+	if (root[s] == 1)
+	    order[k++] = s;
+
+    for (int i=0 ; i<4 ; i++)
+	rng[i] = splitmix64(seed);
+    return true;
+}
+
+
+bool BDD_DEALER::try_one(uint64_t hands[DEALER_SEATS])
+{
+    // The pool is left in whatever order the last try shuffled it to;
+    // Fisher-Yates gives a uniform result from any starting order.
+    int pos = 0;
+    for (int i=0 ; i<DEALER_SEATS ; i++) {
+	int s = order[i];
+	uint64_t h = fixed[s];
+	if (pos + need[s] == npool) {
+	    for ( ; pos < npool ; pos++)
+		h |= 1ull << pool[pos];
+	} else {
+	    for (int j=0 ; j<need[s] ; j++, pos++) {
+		int r = pos + (int)below((uint32_t)(npool - pos));
+		uint8_t c = pool[r];
+		pool[r] = pool[pos];
+		pool[pos] = c;
+		h |= 1ull << c;
+	    }
+	}
+	if (root[s] != 1 && !accepts(root[s], h))
+	    return false;
+	hands[s] = h;
+    }
+    return true;
+}
+
+
+uint64_t BDD_DEALER::deal(size_t count, uint64_t max_tries,
+    std::vector<uint64_t>& out)
+{
+    uint64_t tries = 0;
+    uint64_t hands[DEALER_SEATS];
+    size_t found = 0;
+    while (found < count && (max_tries == 0 || tries < max_tries)) {
+	tries++;
+	if (try_one(hands)) {
+	    out.insert(out.end(), hands, hands + DEALER_SEATS);
+	    found++;
+	}
+    }
+    return tries;
+}
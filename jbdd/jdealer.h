@@ -0,0 +1,65 @@
+#ifndef _JDEALER_H_
+#define _JDEALER_H_
+
+/*
+ * Random deals under per-seat restrictions.  Cards are numbered 0..51 in
+ * the HandSet variable order, and a hand is the uint64_t mask of its card
+ * numbers, so a HandSet BDD can be evaluated on a hand directly.
+ *
+ * Each seat may have fixed cards and a constraint BDD.  A try deals the
+ * unfixed cards with a partial Fisher-Yates shuffle, constrained seats
+ * first, and gives up as soon as one seat is rejected.  The BDDs are
+ * flattened into a private table when the dealer is made, so later
+ * garbage collection in the global store does not affect it.
+ */
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "jbdd.h"
+
+const int DEALER_CARDS = 52;
+const int DEALER_SEATS = 4;
+
+class BDD_DEALER
+{
+  public:
+    // Constraints of bdd_true mean no restriction.  Returns false and
+    // sets err if the fixed cards overlap, overflow a hand, or a
+    // constraint uses a variable outside 0..51.
+    bool init(const uint64_t fixed[DEALER_SEATS],
+	const bddref_t constraint[DEALER_SEATS], uint64_t seed,
+	std::string& err);
+
+    // One attempt; returns true and fills hands if every seat accepts
+    bool try_one(uint64_t hands[DEALER_SEATS]);
+
+    // Deal until count deals are found or max_tries attempts are used
+    // (max_tries 0 means no limit).  Returns the number of attempts.
+    uint64_t deal(size_t count, uint64_t max_tries,
+	std::vector<uint64_t>& out);
+
+  private:
+    struct NODE {
+	int32_t	var;
+	int32_t	hi;
+	int32_t	lo;
+    };
+
+    uint64_t		rng[4];
+    uint64_t		fixed[DEALER_SEATS];
+    int			need[DEALER_SEATS];
+    int			order[DEALER_SEATS];	// constrained seats first
+    int32_t		root[DEALER_SEATS];
+    int			npool;
+    uint8_t		pool[DEALER_CARDS];
+    std::vector<NODE>	nodes;			// 0 is false, 1 is true
+
+    uint64_t next();
+    uint32_t below(uint32_t n);
+    int32_t flatten(bddref_t r, std::map<bddref_t, int32_t>& memo, bool& ok);
+    bool accepts(int32_t n, uint64_t hand) const;
+};
+
+#endif // _JDEALER_H_
@@ -0,0 +1,81 @@
+#include <inttypes.h>
+#include <utility>
+#include "jmetric.h"
+
+typedef std::map<metric_val_t, bddref_t> METRIC_MAP;
+
+static void
+map_to_partition(const METRIC_MAP& m, METRIC_PARTITION& out)
+{
+    out.clear();
+    for (METRIC_MAP::const_iterator it = m.begin() ; it != m.end() ; ++it) {
+	if (it->second != bdd_false)
+	    out.push_back(*it);
+    }
+}
+
+
+void metric_from_weights(const std::map<bddvar_t, metric_val_t>& weights,
+    METRIC_PARTITION& out)
+{
+    // Working from the bottom variable up, each new variable sits above
+    // everything built so far, so bdd_node() can be used in place of ite.
+    // Each round reads one of the two maps and fills the other.
+    METRIC_MAP maps[2];
+    METRIC_MAP* values = &maps[0];
+    METRIC_MAP* next = &maps[1];
+    (*values)[0] = bdd_true;
+
+    std::map<bddvar_t, metric_val_t>::const_reverse_iterator w;
+    for (w = weights.rbegin() ; w != weights.rend() ; ++w) {
+	next->clear();
+	METRIC_MAP::const_iterator it;
+	for (it = values->begin() ; it != values->end() ; ++it) {
+	    (*next)[it->first] = bdd_false;
+	    (*next)[it->first + w->second] = bdd_false;
+	}
+	for (METRIC_MAP::iterator n = next->begin() ; n != next->end() ; ++n) {
+	    METRIC_MAP::const_iterator a = values->find(n->first - w->second);
+	    METRIC_MAP::const_iterator s = values->find(n->first);
+	    n->second = bdd_node(w->first,
+		a == values->end() ? bdd_false : a->second,
+		s == values->end() ? bdd_false : s->second);
+	}
+	std::swap(values, next);
+    }
+
+    map_to_partition(*values, out);
+}
+
+
+void metric_arith(METRIC_OP op, const METRIC_PARTITION& a,
+    const METRIC_PARTITION& b, METRIC_PARTITION& out)
+{
+    METRIC_MAP sums;
+    for (size_t i=0 ; i<a.size() ; i++) {
+	for (size_t j=0 ; j<b.size() ; j++) {
+	    bddref_t both = bdd_ite(a[i].second, b[j].second, bdd_false);
+	    if (both == bdd_false)
+		continue;
+
+	    metric_val_t key = (op == METRIC_ADD) ?
+		a[i].first + b[j].first : a[i].first - b[j].first;
+	    METRIC_MAP::iterator f = sums.find(key);
+	    if (f == sums.end())
+		sums[key] = both;
+	    else
+		f->second = bdd_ite(f->second, bdd_true, both);
+	}
+    }
+
+    map_to_partition(sums, out);
+}
+
+
+bddref_t metric_less_than(const METRIC_PARTITION& a, metric_val_t n)
+{
+    bddref_t out = bdd_false;
+    for (size_t i=0 ; i<a.size() && a[i].first < n ; i++)
+	out = bdd_ite(a[i].second, bdd_true, out);
+    return out;
+}
@@ -0,0 +1,30 @@
+#ifndef _JMETRIC_H_
+#define _JMETRIC_H_
+
+/*
+ * Integer valued functions of the jbdd variables.  A metric is kept as a
+ * partition: a list of (value, BDD) pairs, sorted by value, whose BDDs are
+ * pairwise disjoint.  Variable assignments covered by none of the BDDs are
+ * "undefined" and stay undefined through arithmetic.  This is the same
+ * representation HandSetMetric.values uses on the Python side.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "jbdd.h"
+
+typedef int64_t metric_val_t;
+typedef std::vector<std::pair<metric_val_t, bddref_t> > METRIC_PARTITION;
+
+enum METRIC_OP { METRIC_ADD, METRIC_SUB };
+
+// Sum of the weights of the variables which are set
+void metric_from_weights(const std::map<bddvar_t, metric_val_t>& weights,
+    METRIC_PARTITION& out);
+void metric_arith(METRIC_OP op, const METRIC_PARTITION& a,
+    const METRIC_PARTITION& b, METRIC_PARTITION& out);
+bddref_t metric_less_than(const METRIC_PARTITION& a, metric_val_t n);
+
+#endif // _JMETRIC_H_
@@ -0,0 +1,347 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <set>
+#include "jreorder.h"
+
+static bddref_t
+permute_rec(bddref_t r, const BDD_PERM& perm, std::map<bddref_t, bddref_t>& memo)
+{
+    if (r == bdd_true || r == bdd_false)
+	return r;
+
+    std::map<bddref_t, bddref_t>::iterator f = memo.find(r);
+    if (f != memo.end())
+	return f->second;
+
+    bddvar_t v = bdd_vnum(r);
+    BDD_PERM::const_iterator p = perm.find(v);
+    if (p != perm.end())
+	v = p->second;
+
+    // The new variable may land anywhere, so this needs ite, not bdd_node
+    bddref_t avec = permute_rec(bdd_avec(r), perm, memo);
+    bddref_t sans = permute_rec(bdd_sans(r), perm, memo);
+    bddref_t out = bdd_ite(bdd_node(v, bdd_true, bdd_false), avec, sans);
+    memo[r] = out;
+    return out;
+}
+
+bddref_t bdd_permute(bddref_t r, const BDD_PERM& perm)
+{
+    std::map<bddref_t, bddref_t> memo;
+    return permute_rec(r, perm, memo);
+}
+
+size_t bdd_node_count(const std::vector<bddref_t>& roots)
+{
+    std::set<bddref_t> seen;
+    std::vector<bddref_t> stack(roots);
+    while (!stack.empty()) {
+	bddref_t r = stack.back();
+	stack.pop_back();
+	if (r < 0)
+	    r = -r;
+	if (r == bdd_true || !seen.insert(r).second)
+	    continue;
+	stack.push_back(bdd_avec(r));
+	stack.push_back(bdd_sans(r));
+    }
+    return seen.size();
+}
+
+
+BDD_SIFTER::BDD_SIFTER(const std::vector<bddref_t>& global_roots) : live(0)
+{
+    // 0 and 1 are the false and true terminals
+    NODE term = { -1, 0, 0, 0 };
+    nodes.push_back(term);
+    nodes.push_back(term);
+
+    std::set<bddvar_t> vars;
+    std::set<bddref_t> seen;
+    std::vector<bddref_t> stack(global_roots);
+    while (!stack.empty()) {
+	bddref_t r = stack.back();
+	stack.pop_back();
+	if (r < 0)
+	    r = -r;
+	if (r == bdd_true || !seen.insert(r).second)
+	    continue;
+	vars.insert(bdd_vnum(r));
+	stack.push_back(bdd_avec(r));
+	stack.push_back(bdd_sans(r));
+    }
+
+    std::map<bddvar_t, int> local;
+    for (std::set<bddvar_t>::iterator it = vars.begin() ; it != vars.end() ; ++it) {
+	local[*it] = (int)var_name.size();
+	level_of.push_back((int)var_name.size());
+	var_at.push_back((int)var_name.size());
+	var_name.push_back(*it);
+    }
+    unique.resize(var_name.size());
+
+    std::map<bddref_t, nid_t> memo;
+    for (size_t i=0 ; i<global_roots.size() ; i++) {
+	nid_t n = import(global_roots[i], memo, local);
+	incref(n);
+	roots.push_back(n);
+    }
+}
+
+
+BDD_SIFTER::nid_t BDD_SIFTER::import(bddref_t r,
+    std::map<bddref_t, nid_t>& memo, const std::map<bddvar_t, int>& local)
+{
+    if (r == bdd_true)
+	return 1;
+    if (r == bdd_false)
+	return 0;
+
+    std::map<bddref_t, nid_t>::iterator f = memo.find(r);
+    if (f != memo.end())
+	return f->second;
+
+    nid_t hi = import(bdd_avec(r), memo, local);
+    nid_t lo = import(bdd_sans(r), memo, local);
+    nid_t out = make(local.find(bdd_vnum(r))->second, hi, lo);
+    memo[r] = out;
+    return out;
+}
+
+
+BDD_SIFTER::nid_t BDD_SIFTER::make(int var, nid_t hi, nid_t lo)
+{
+    if (hi == lo)
+	return hi;
+
+    uint64_t k = key(hi, lo);
+    UNIQUE::iterator f = unique[var].find(k);
+    if (f != unique[var].end())
+	return f->second;
+
+    NODE n = { var, hi, lo, 0 };
+    nid_t id;
+    if (free_ids.empty()) {
+	id = (nid_t)nodes.size();
+	nodes.push_back(n);
+    } else {
+	id = free_ids.back();
+	free_ids.pop_back();
+	nodes[id] = n;
+    }
+    incref(hi);
+    incref(lo);
+    unique[var][k] = id;
+    live++;
+    return id;
+}
+
+
+void BDD_SIFTER::incref(nid_t n)
+{
+    if (n >= 2)
+	nodes[n].refs++;
+}
+
+
+void BDD_SIFTER::decref(nid_t n)
+{
+    if (n < 2 || --nodes[n].refs > 0)
+	return;
+
+    NODE& x = nodes[n];
+    unique[x.var].erase(key(x.hi, x.lo));
+    nid_t hi = x.hi, lo = x.lo;
+    x.var = -1;
+    free_ids.push_back(n);
+    live--;
+    decref(hi);
+    decref(lo);
+}
+
+
+/*
+ * Exchange the variables at level and level+1.  Nodes of the upper
+ * variable x which have children on y are rewritten in place as y nodes,
+ * so references from above stay valid; the rest just drop a level.
+ */
+void BDD_SIFTER::swap_levels(int level)
+{
+    int x = var_at[level];
+    int y = var_at[level+1];
+
+    std::vector<nid_t> moving;
+    for (UNIQUE::iterator it = unique[x].begin() ; it != unique[x].end() ; ++it) {
+	const NODE& n = nodes[it->second];
+	if (var_of(n.hi) == y || var_of(n.lo) == y)
+	    moving.push_back(it->second);
+    }
+    for (size_t i=0 ; i<moving.size() ; i++) {
+	const NODE& n = nodes[moving[i]];
+	unique[x].erase(key(n.hi, n.lo));
+    }
+
+    for (size_t i=0 ; i<moving.size() ; i++) {
+	nid_t id = moving[i];
+	nid_t f1 = nodes[id].hi, f0 = nodes[id].lo;
+	nid_t f11 = f1, f10 = f1, f01 = f0, f00 = f0;
+	if (var_of(f1) == y) {
+	    f11 = nodes[f1].hi;
+	    f10 = nodes[f1].lo;
+	}
+	if (var_of(f0) == y) {
+	    f01 = nodes[f0].hi;
+	    f00 = nodes[f0].lo;
+	}
+
+	nid_t n1 = make(x, f11, f01);
+	incref(n1);
+	nid_t n0 = make(x, f10, f00);
+	incref(n0);
+
+	NODE& n = nodes[id];
+	n.var = y;
+	n.hi = n1;
+	n.lo = n0;
+	unique[y][key(n1, n0)] = id;
+
+	decref(f1);
+	decref(f0);
+    }
+
+    var_at[level] = y;
+    var_at[level+1] = x;
+    level_of[y] = level;
+    level_of[x] = level+1;
+}
+
+
+/*
+ * Move the block at pos below the next one.  Blocks occupy contiguous
+ * levels and keep their internal order, so this is a*b level swaps.
+ */
+void BDD_SIFTER::swap_blocks(int pos)
+{
+    int upper = block_at[pos];
+    int lower = block_at[pos+1];
+    int top = block_level[upper];
+    int a = block_size[upper];
+    int b = block_size[lower];
+
+    for (int i=a-1 ; i>=0 ; i--) {
+	for (int j=0 ; j<b ; j++)
+	    swap_levels(top + i + j);
+    }
+
+    block_at[pos] = lower;
+    block_at[pos+1] = upper;
+    block_level[lower] = top;
+    block_level[upper] = top + b;
+}
+
+
+void BDD_SIFTER::sift_block(int pos, double max_growth)
+{
+    int nblocks = (int)block_at.size();
+    size_t best = live;
+    int best_pos = pos;
+
+    // Head for the nearer end first
+    bool down_first = 2 * pos >= nblocks;
+    for (int pass=0 ; pass<2 ; pass++) {
+	bool down = (pass == 0) == down_first;
+	while (true) {
+	    if (down ? pos+1 >= nblocks : pos == 0)
+		break;
+	    if (down)
+		swap_blocks(pos++);
+	    else
+		swap_blocks(--pos);
+	    if (live < best) {
+		best = live;
+		best_pos = pos;
+	    } else if (live > max_growth * best) {
+		break;
+	    }
+	}
+    }
+
+    while (pos < best_pos)
+	swap_blocks(pos++);
+    while (pos > best_pos)
+	swap_blocks(--pos);
+}
+
+
+void BDD_SIFTER::sift(double max_growth, int group)
+{
+    // Variables whose numbers agree after dividing by group move as one
+    block_at.clear();
+    block_level.clear();
+    block_size.clear();
+    for (size_t l=0 ; l<var_at.size() ; l++) {
+	bddvar_t v = var_name[var_at[l]];
+	if (l == 0 || v / group != var_name[var_at[l-1]] / group) {
+	    block_at.push_back((int)block_size.size());
+	    block_level.push_back((int)l);
+	    block_size.push_back(0);
+	}
+	block_size.back()++;
+    }
+
+    // Biggest blocks first
+    std::vector<std::pair<size_t, int> > order;
+    for (size_t pos=0 ; pos<block_at.size() ; pos++) {
+	int b = block_at[pos];
+	size_t n = 0;
+	for (int l=block_level[b] ; l<block_level[b]+block_size[b] ; l++)
+	    n += unique[var_at[l]].size();
+	order.push_back(std::make_pair(n, b));
+    }
+    std::sort(order.rbegin(), order.rend());
+
+    for (size_t i=0 ; i<order.size() ; i++) {
+	int b = order[i].second;
+	int pos = (int)(std::find(block_at.begin(), block_at.end(), b) - block_at.begin());
+	sift_block(pos, max_growth);
+    }
+}
+
+
+void BDD_SIFTER::permutation(BDD_PERM& perm) const
+{
+    // var_name is sorted, so it doubles as level -> global number
+    perm.clear();
+    for (size_t v=0 ; v<var_name.size() ; v++)
+	perm[var_name[v]] = var_name[level_of[v]];
+}
+
+
+bddref_t BDD_SIFTER::export_node(nid_t n, std::map<nid_t, bddref_t>& memo)
+{
+    if (n == 1)
+	return bdd_true;
+    if (n == 0)
+	return bdd_false;
+
+    std::map<nid_t, bddref_t>::iterator f = memo.find(n);
+    if (f != memo.end())
+	return f->second;
+
+    // Children are on deeper levels, which get larger numbers
+    bddref_t avec = export_node(nodes[n].hi, memo);
+    bddref_t sans = export_node(nodes[n].lo, memo);
+    bddref_t out = bdd_node(var_name[level_of[nodes[n].var]], avec, sans);
+    memo[n] = out;
+    return out;
+}
+
+
+void BDD_SIFTER::export_roots(std::vector<bddref_t>& out)
+{
+    std::map<nid_t, bddref_t> memo;
+    out.clear();
+    for (size_t i=0 ; i<roots.size() ; i++)
+	out.push_back(export_node(roots[i], memo));
+}
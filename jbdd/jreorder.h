@@ -0,0 +1,83 @@
+#ifndef _JREORDER_H_
+#define _JREORDER_H_
+
+/*
+ * Variable reordering.  The global store ties order to variable number
+ * (lower numbers nearer the root), so a new order is expressed as a
+ * renumbering of the variables.
+ *
+ * BDD_SIFTER copies a set of roots into a private store without
+ * complement edges, where adjacent levels can be swapped in place, and
+ * runs Rudell's sifting on it.  Exporting builds the result in the global
+ * store under the renumbering it found.
+ */
+
+#include <stdint.h>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "jbdd.h"
+
+typedef std::map<bddvar_t, bddvar_t> BDD_PERM;
+
+bddref_t bdd_permute(bddref_t r, const BDD_PERM& perm);
+size_t bdd_node_count(const std::vector<bddref_t>& roots);
+
+class BDD_SIFTER
+{
+  public:
+    BDD_SIFTER(const std::vector<bddref_t>& roots);
+
+    // Stop moving a variable in one direction once the size passes
+    // max_growth times the best size seen for it.  With group > 1,
+    // variables v and w with v/group == w/group are kept together.
+    void sift(double max_growth, int group);
+    size_t size() const { return live; }
+
+    // Only variables which appear in the roots are renumbered, among
+    // the same set of numbers
+    void permutation(BDD_PERM& perm) const;
+    void export_roots(std::vector<bddref_t>& out);
+
+  private:
+    typedef int32_t nid_t;
+    typedef std::unordered_map<uint64_t, nid_t> UNIQUE;
+
+    struct NODE {
+	int32_t		var;	// local variable, -1 for terminals and free
+	nid_t		hi;
+	nid_t		lo;
+	uint32_t	refs;
+    };
+
+    std::vector<NODE>		nodes;
+    std::vector<nid_t>		free_ids;
+    std::vector<bddvar_t>	var_name;	// local var -> global number
+    std::vector<int>		level_of;	// local var -> level
+    std::vector<int>		var_at;		// level -> local var
+    std::vector<UNIQUE>		unique;		// one table per local var
+    std::vector<nid_t>		roots;
+    size_t			live;
+
+    // Sifting moves blocks of variables; these are only used by sift()
+    std::vector<int>		block_at;	// position -> block
+    std::vector<int>		block_level;	// block -> top level
+    std::vector<int>		block_size;
+
+    static uint64_t key(nid_t hi, nid_t lo) {
+	return ((uint64_t)(uint32_t)hi << 32) | (uint32_t)lo;
+    }
+    int var_of(nid_t n) const { return n < 2 ? -1 : nodes[n].var; }
+
+    nid_t make(int var, nid_t hi, nid_t lo);
+    void incref(nid_t n);
+    void decref(nid_t n);
+    nid_t import(bddref_t r, std::map<bddref_t, nid_t>& memo,
+	const std::map<bddvar_t, int>& local);
+    bddref_t export_node(nid_t n, std::map<nid_t, bddref_t>& memo);
+    void swap_levels(int level);
+    void swap_blocks(int pos);
+    void sift_block(int pos, double max_growth);
+};
+
+#endif // _JREORDER_H_
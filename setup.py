@@ -22,7 +22,8 @@ module_jade = setuptools.Extension('bridgemoose.jade',
     ]])
 
 module_jbdd = setuptools.Extension('bridgemoose.jbdd',
-    sources=["jbdd/jbdd.cpp", "jbdd/j128.cpp"])
+    sources=["jbdd/jbdd.cpp", "jbdd/j128.cpp", "jbdd/jmetric.cpp",
+        "jbdd/jbddfile.cpp", "jbdd/jreorder.cpp", "jbdd/jdealer.cpp"])
 
 module_dds = setuptools.Extension('bridgemoose.dds',
     # define_macros = [('DDS_THREADS_GCD', None), ('DDS_THREADS_STL', None)],
@@ -10,6 +10,7 @@ from .card import Card
 from .deal import Deal, Hand
 from .play import PartialHand
 from .jbdd import BDD
+from . import jbdd
 
 debug = False
 
@@ -53,26 +54,15 @@ class HandSetMetric:
     __ge__ = cmp_func_make(operator.ge, lambda self, n: ~self.less_than(n))
     __gt__ = cmp_func_make(operator.gt, lambda self, n: ~self.less_than(n+1))
 
-    def make_arith_func(op):
+    def make_arith_func(native_op):
         def arith_func(self, other):
             if not isinstance(other, HandSetMetric):
                 raise TypeError(other)
-            
-            out = dict()
-            for key1, val1 in self.values.items():
-                for key2, val2 in other.values.items():
-                    key3 = op(key1, key2)
-                    both = val1 & val2
-                    if key3 in out:
-                        out[key3] |= both
-                    else:
-                        out[key3] = both
-
-            return HandSetMetric(out)
+            return HandSetMetric(native_op(self.values, other.values))
         return arith_func
 
-    __add__ = make_arith_func(operator.add)
-    __sub__ = make_arith_func(operator.sub)
+    __add__ = make_arith_func(jbdd.metric_add)
+    __sub__ = make_arith_func(jbdd.metric_sub)
 
     def __mul__(self, other):
         return HandSetMetric({key*other: val for key, val in self.values.items()})
@@ -90,9 +80,7 @@ class HandSetMetric:
         if key in self.cache:
             return HandSet(self.cache[key])
 
-        a = self.less_than(n-1).bdd
-        b = self.values.get(n-1, BDD.false())
-        out = a | b
+        out = jbdd.metric_less_than(self.values, n)
         self.cache[key] = out
         return HandSet(out)
 
@@ -102,20 +90,8 @@ class SimpleHandMetric(HandSetMetric):
     card_index = {c:i for i, c in enumerate(cards)}
 
     def __init__(self, scores):
-        values = {0: BDD.true()}
-        for card in reversed(sorted(scores, key=SimpleHandMetric.card_index.get)):
-            card_value = scores[card]
-            aveces = {val + card_value: hs for val, hs in values.items()}
-            sanses = {val: hs for val, hs in values.items()}
-
-            values = {}
-            for val in aveces.keys() | sanses.keys():
-                a = aveces.get(val, BDD.false())
-                s = sanses.get(val, BDD.false())
-                n = BDD(SimpleHandMetric.card_index[card]).thenelse(a, s)
-                values[val] = n
-
-        super(SimpleHandMetric, self).__init__(values)
+        weights = {SimpleHandMetric.card_index[card]: v for card, v in scores.items()}
+        super(SimpleHandMetric, self).__init__(jbdd.metric_from_weights(weights))
 
 class QuickTricksMetric(HandSetMetric):
     def __init__(self):
@@ -165,17 +141,24 @@ class QuickTricksMetric(HandSetMetric):
         return values
 
 class DealSet:
-    def __init__(self, d):
+    def __init__(self, d, perm=None):
+        """ perm maps each variable of the standard order (two per card,
+in SimpleHandMetric.cards order) to the variable number it has in d.
+None means d is in the standard order. """
         if d is None:
             self.d = BDD.false()
         elif isinstance(d, BDD):
             self.d = d
         else:
             raise TypeError("BDD or None")
+        self.perm = perm
 
     def sample(self, rng=random):
         index = rng.randrange(self.d.pcount())
         bits = set(DealSet.get_bits(self.d, index))
+        if self.perm is not None:
+            inverse = {v: k for k, v in self.perm.items()}
+            bits = {inverse.get(b, b) for b in bits}
         hand_lists = [[],[],[],[]]
         for i, card in enumerate(SimpleHandMetric.cards):
             owner = 2*(i*2+1 in bits) + 1*(i*2 in bits)
@@ -201,33 +184,76 @@ class DealSet:
             if j & 1:
                 bits.add(i*2)
 
+        if self.perm is not None:
+            bits = {self.perm.get(b, b) for b in bits}
         return self.d.eval_pset(bits)
 
 
     def count(self):
         return self.d.pcount()
 
+    def node_count(self):
+        return self.d.node_count()
+
+    def reorder(self, max_growth=1.2):
+        """ Return an equivalent DealSet whose variable order has been
+chosen by sifting to make the diagram smaller.  Smaller diagrams make
+sample() and contains() faster. """
+        return reorder_dealsets([self], max_growth)[0]
+
+    def _in_my_order(self, other):
+        if other.perm == self.perm:
+            return other.d
+        d = other.d
+        if other.perm is not None:
+            d = jbdd.permute(d, {v: k for k, v in other.perm.items()})
+        if self.perm is not None:
+            d = jbdd.permute(d, self.perm)
+        return d
+
     @staticmethod
     def get_bits(bdd, index):
         return bdd.get_pindex(index)
 
     def __and__(self, other):
-        return DealSet(self.d & other.d)
+        return DealSet(self.d & self._in_my_order(other), self.perm)
     def __or__(self, other):
-        return DealSet(self.d | other.d)
+        return DealSet(self.d | self._in_my_order(other), self.perm)
     def __xor___(self, other):
-        return DealSet(self.d ^ other.d)
+        return DealSet(self.d ^ self._in_my_order(other), self.perm)
     def __invert__(self):
-        return DealSet(~self.d)
+        return DealSet(~self.d, self.perm)
     def ite(self, t, e):
         return DealSet(self.bdd.thenelse(t.bdd, e.bdd))
 
+def reorder_dealsets(dealsets, max_growth=1.2):
+    """ Sift a list of DealSets together and return them in one shared new
+variable order, so that combining them afterwards stays in that order.
+Sifting is slow (minutes for a million nodes) but DealSets combining
+constraints on two hands can shrink by an order of magnitude or more. """
+    if not dealsets:
+        return []
+    first = dealsets[0]
+    bdds = [first.d] + [first._in_my_order(x) for x in dealsets[1:]]
+
+    # Keep the two variables of each card next to each other
+    sifted_bdds, sifted = jbdd.sift(bdds, max_growth, 2)
+    if first.perm is None:
+        perm = sifted
+    else:
+        # Variables that first.perm leaves in place can still move in
+        # the sift, so compose over the keys of both maps
+        perm = {}
+        for k in set(first.perm) | set(sifted):
+            v = first.perm.get(k, k)
+            perm[k] = sifted.get(v, v)
+    return [DealSet(d, perm) for d in sifted_bdds]
+
 class DealSetConverter:
     four_hands = None
 
     def __init__(self, player):
         self.player = Direction(player)
-        self.cache = dict()
 
     def __call__(self, hs):
         if not isinstance(hs, HandSet):
@@ -236,7 +262,9 @@ class DealSetConverter:
         if DealSetConverter.four_hands is None:
             DealSetConverter._compute_four_hands()
 
-        return DealSet(self._doit(hs.bdd) & DealSetConverter.four_hands)
+        # The cache is per call so that converted BDDs don't outlive the
+        # request that built them (see jbdd.collect)
+        return DealSet(self._doit(hs.bdd, dict()) & DealSetConverter.four_hands)
 
     @staticmethod
     def _compute_four_hands(N=13):
@@ -265,17 +293,17 @@ class DealSetConverter:
         assert len(tier) == 1, (tier.keys())
         DealSetConverter.four_hands = tier[(N,N,N,N)]
 
-    def _doit(self, bdd):
+    def _doit(self, bdd, cache):
         split = bdd.split()
         if split is True or split is False:
             return bdd
 
-        if bdd in self.cache:
-            return self.cache[bdd]
+        if bdd in cache:
+            return cache[bdd]
 
         var, avec, sans = split
-        avec = self._doit(avec)
-        sans = self._doit(sans)
+        avec = self._doit(avec, cache)
+        sans = self._doit(sans, cache)
 
         if self.player.i & 2:
             n2 = BDD(2*var + 1).thenelse(avec, sans)
@@ -287,7 +315,7 @@ class DealSetConverter:
         else:
             n1 = BDD(2*var).thenelse(sans, n2)
 
-        self.cache[bdd] = n1
+        cache[bdd] = n1
         return n1
 
 def tuple_to_pattern(tupe, n):
@@ -600,6 +628,56 @@ class HandSet:
         return bool(cur)
 
 
+def _library_metrics():
+    seen = set()
+    for name, const in vars(hand_makers).items():
+        if isinstance(const, lazy_const) and id(const) not in seen:
+            seen.add(id(const))
+            yield name, const
+
+def save_library(path):
+    """ Write the hand_makers metrics, shape tables and the four-hands
+DealSet constraint to a file, so other processes can load_library() it
+instead of computing them all again. """
+    roots = {"four_hands": DealSetConverter.four_hands}
+    if roots["four_hands"] is None:
+        DealSetConverter._compute_four_hands()
+        roots["four_hands"] = DealSetConverter.four_hands
+
+    for name, const in _library_metrics():
+        value = const.__get__(None, hand_makers)
+        if isinstance(value, HandSetMetric):
+            for v, bdd in value.values.items():
+                roots[f"{name}={v}"] = bdd
+
+    for pat, bdd in ShapeMaker.get_pattern_bdds().items():
+        roots["shape=" + ",".join(map(str, pat))] = bdd
+
+    jbdd.save(path, roots)
+
+def load_library(path):
+    """ Read a file written by save_library() and install its contents """
+    roots = jbdd.load(path)
+    metric_values = defaultdict(dict)
+    shapes = dict()
+
+    for key, bdd in roots.items():
+        name, _, value = key.partition("=")
+        if name == "shape":
+            shapes[IncrTuple(int(x) for x in value.split(","))] = bdd
+        elif value:
+            metric_values[name][int(value)] = bdd
+
+    if "four_hands" in roots:
+        DealSetConverter.four_hands = roots["four_hands"]
+    if shapes:
+        ShapeMaker.BDDS = shapes
+    for name, const in _library_metrics():
+        if name in metric_values:
+            const.value = HandSetMetric(metric_values[name])
+            const.made = True
+
+
 if __name__ == "__main__":
     HandMakers = hand_makers()
 
@@ -636,4 +714,4 @@ if __name__ == "__main__":
             print("------")
             print(ds.sample().square_string())
 
-__all__ = ["hand_makers", "DealSet"]
+__all__ = ["hand_makers", "DealSet", "reorder_dealsets", "save_library", "load_library"]
@@ -2,7 +2,20 @@ import random
 from .deal import Card, Deal, Hand
 from .direction import Direction
 from .play import PartialHand
-from .handset import HandSet, hand_makers
+from .handset import HandSet, SimpleHandMetric, hand_makers
+from . import jbdd
+
+# Cards for each byte of a jbdd.Dealer hand mask
+_MASK_BYTE_CARDS = [[[card for i, card in
+    enumerate(SimpleHandMetric.cards[8*k:8*k+8]) if b & (1 << i)]
+    for b in range(256)] for k in range(7)]
+
+def _mask_cards(mask):
+    out = []
+    for table in _MASK_BYTE_CARDS:
+        out.extend(table[mask & 0xff])
+        mask >>= 8
+    return out
 
 def parse_card_set(s):
     out = set()
@@ -25,24 +38,23 @@ class RestrictedDealer:
             self.rng = random
             self.sorting = False
         else:
+            self.rng = rng
             self.sorting = True
 
         self.cardset = set(Card.all())
         self.acceptors = dict()
-        self.dealset = None
+        self.native = None
         self.known_cards = {d: set() for d in Direction.ALL}
         self.accept = accept
         args = [west, north, east, south]
 
         if any(callable(x) for x in args):
             self.init_with_callables(args)
-        elif any(isinstance(x, HandSet) for x in args):
-            self.init_with_handsets(args)
         else:
-            self.init_with_callables(args)
+            self.init_native(args)
 
     def init_with_callables(self, args):
-        self.dealset = None
+        self.native = None
         for d, spec in zip("WNES", args):
             if spec is None:
                 continue
@@ -51,50 +63,68 @@ class RestrictedDealer:
                 self._process_card_set(d, hand.cards)
             elif isinstance(spec, (Hand, PartialHand)):
                 self._process_card_set(d, spec.cards)
+            elif isinstance(spec, HandSet):
+                self.acceptors[d] = spec.contains
             elif callable(spec):
                 self.acceptors[d] = spec
-                any_callable = True
-            elif isinstance(spec, HandSet):
-                def acc(hand):
-                    return spec.contains(hand)
             else:
                 self._process_card_set(d, set(spec))
 
-    def init_with_handsets(self, args):
-        m = hand_makers()
-        handsets = {}
-
-        def from_cards(cards):
-            hs = m.ANY
-            for card in cards:
-                hs &= m.CARD(card)
-            return hs
-
+    def init_native(self, args):
+        """ Fixed cards and HandSets only: deals are made and checked
+against the HandSet BDDs by jbdd.Dealer """
+        fixed = []
+        constraints = []
         for d, spec in zip("WNES", args):
+            mask = 0
+            bdd = None
             if spec is None:
-                handsets[d] = m.ANY
-            elif isinstance(spec, str):
-                handsets[d] = from_cards(Hand(spec).cards)
-            elif isinstance(spec, (Hand, PartialHand)):
-                handsets[d] = from_cards(spec.cards)
-            elif callable(spec):
-                raise TypeError("This shouldn't happen")
+                pass
             elif isinstance(spec, HandSet):
-                handsets[d] = spec
+                bdd = spec.bdd
             else:
-                handsets[d] = from_cards(set(spec))
-
-        self.dealset = m.WEST(handsets["W"]) & m.EAST(handsets["E"]) & \
-            m.NORTH(handsets["N"]) & m.SOUTH(handsets["S"])
-
-
+                if isinstance(spec, str):
+                    cards = Hand(spec).cards
+                elif isinstance(spec, (Hand, PartialHand)):
+                    cards = spec.cards
+                else:
+                    cards = set(spec)
+                self._process_card_set(d, cards)
+                for card in cards:
+                    mask |= 1 << SimpleHandMetric.card_index[card]
+            fixed.append(mask)
+            constraints.append(bdd)
+
+        self.native = jbdd.Dealer(fixed, constraints, self.rng.getrandbits(64))
+
+    def batch(self, count, max_tries=0):
+        """ Returns (deals, tries): up to count deals found in at most
+max_tries attempts (0 for no limit). """
+        if self.native is None:
+            deals = []
+            tries = 0
+            while len(deals) < count and (not max_tries or tries < max_tries):
+                tries += 1
+                deal = self.one_try()
+                if deal is not None:
+                    deals.append(deal)
+            return deals, tries
+
+        masks, tries = self.native.deal(count, max_tries)
+        deals = [Deal(*[Hand(_mask_cards(m)) for m in hands]) for hands in masks]
+        if self.accept is not None:
+            deals = [deal for deal in deals if self.accept(deal)]
+        return deals, tries
 
     def one_try(self):
-        if self.dealset is None:
+        if self.native is not None:
+            deals, _ = self.batch(1, 1)
+            return deals[0] if deals else None
+        else:
             # Must sort when
             cardlist = list(self.cardset)
             if self.sorting:
-                self.cardlist.sort()
+                cardlist.sort()
             self.rng.shuffle(cardlist)
             n = 0
 
@@ -113,8 +143,6 @@ class RestrictedDealer:
                     return None
 
             deal = Deal(hands['W'],hands['N'],hands['E'],hands['S'])
-        else:
-            deal = self.dealset.sample()
 
         if self.accept is not None:
             if not self.accept(deal):
@@ -151,13 +179,26 @@ accept  : can be None or a callable which takes a Deal and returns True/False\
     hits = 0
     dealer = RestrictedDealer(west, north, east, south, accept, rng)
     while count is None or hits < count:
-        d = dealer.one_try()
-        if d is None:
-            misses += 1
-            if hits == 0 and fail_count is not None and misses >= fail_count:
-                raise ValueError("No hits found - is your clause possible?")
-        else:
+        want = 1000 if count is None else min(count - hits, 1000)
+        max_tries = 0
+        if hits == 0 and fail_count is not None:
+            max_tries = fail_count - misses
+        deals, tries = dealer.batch(want, max_tries)
+        misses += tries - len(deals)
+        if hits == 0 and not deals and fail_count is not None and \
+            misses >= fail_count:
+            raise ValueError("No hits found - is your clause possible?")
+        for d in deals:
             hits += 1
             yield d
 
-__all__ = ["random_deals"]
+def random_deal_tuples(count, declarer, strain, west=None, north=None,
+    east=None, south=None, accept=None, rng=None, fail_count=100000):
+    """\
+A list of count (deal, declarer, strain) tuples, ready for
+dds.solve_many_deals().  Other arguments are as for random_deals().\
+"""
+    return [(deal, declarer, strain) for deal in random_deals(count, west,
+        north, east, south, accept, rng, fail_count)]
+
+__all__ = ["random_deals", "random_deal_tuples"]
@@ -224,12 +224,12 @@ class DDAnalyzer:
         misses = 0
         hits = 0
         while hits < count:
-            deal = self.gen.one_try()
-            if deal is None:
-                misses += 1
-                if hits == 0 and misses > 100000:
-                    raise ValueError("100,000 misses.  Perhaps there are no valid deals?")
-            else:
+            deals, tries = self.gen.batch(count - hits,
+                100001 - misses if hits == 0 else 0)
+            misses += tries - len(deals)
+            if hits == 0 and not deals and misses > 100000:
+                raise ValueError("100,000 misses.  Perhaps there are no valid deals?")
+            for deal in deals:
                 self.deals.append(deal)
                 self.tricks.append({})
                 hits += 1
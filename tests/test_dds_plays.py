@@ -0,0 +1,68 @@
+""" dds.analyze_many_plays must give the same answers as analyze_deal_play
+on each deal, for random legal play histories.  Run with pytest, or on its
+own with python. """
+
+import random
+
+import bridgemoose as bm
+from bridgemoose import dds
+
+SEATS = "WNES"
+
+
+def random_history(deal, declarer, strain, tricks, rng):
+    hands = {seat: set(str(c) for c in deal.hand(seat).cards) for seat in SEATS}
+    leader = SEATS[(SEATS.index(declarer) + 1) % 4]
+    plays = []
+    for _ in range(tricks):
+        trick = []
+        for k in range(4):
+            seat = SEATS[(SEATS.index(leader) + k) % 4]
+            cards = sorted(hands[seat])
+            if trick:
+                follow = [c for c in cards if c[0] == trick[0][0]]
+                cards = follow or cards
+            card = rng.choice(cards)
+            hands[seat].remove(card)
+            trick.append(card)
+
+        def strength(card):
+            if card[0] == strain:
+                return 100 + bm.Card.rank_order(card[1])
+            if card[0] == trick[0][0]:
+                return bm.Card.rank_order(card[1])
+            return -1
+        best = max(range(4), key=lambda k: strength(trick[k]))
+        leader = SEATS[(SEATS.index(leader) + best) % 4]
+        plays.extend(trick)
+    return "".join(plays)
+
+
+def test_many_plays_matches_single():
+    rng = random.Random(39)
+    deals = list(bm.random_deals(12, rng=rng))
+    for strain in "NSHDC":
+        for declarer in SEATS:
+            history = random_history(deals[0], declarer, strain, 3, rng)
+            many = dds.analyze_many_plays(deals[:1], declarer, strain, history)
+            single = dds.analyze_deal_play(deals[0], declarer, strain, history)
+            got = [(many[0, p, 0], many[0, p, 1], bool(many[0, p, 2]))
+                for p in range(len(single))]
+            assert got == [(g, b, bool(w)) for g, b, w in single], \
+                (strain, declarer, history)
+
+    # A history is legal only on the deal it was made for, so the batch
+    # of several deals repeats that deal.
+    for deal in deals:
+        history = random_history(deal, "S", "N", 4, rng)
+        single = dds.analyze_deal_play(deal, "S", "N", history)
+        many = dds.analyze_many_plays([deal] * 3, "S", "N", history)
+        for d in range(3):
+            got = [(many[d, p, 0], many[d, p, 1], bool(many[d, p, 2]))
+                for p in range(len(single))]
+            assert got == [(g, b, bool(w)) for g, b, w in single], history
+
+
+if __name__ == "__main__":
+    test_many_plays_matches_single()
+    print("ok")
@@ -0,0 +1,29 @@
+""" jbdd.sift must keep the BDDs it is given alive while it reads them,
+even from a generator whose items nothing else holds, and with the
+collector running on every new node.  Run with pytest, or on its own
+with python. """
+
+from bridgemoose import jbdd
+
+
+def test_sift_generator_survives_collection():
+    v = [jbdd.BDD(k) for k in range(8)]
+    jbdd.set_gc_threshold(1)
+    try:
+        sifted, perm = jbdd.sift(
+            ((v[k] & v[7-k]) | (v[(k+1) % 8] & v[(k+5) % 8])
+                for k in range(4)), 1.2, 1)
+        expect = [(v[k] & v[7-k]) | (v[(k+1) % 8] & v[(k+5) % 8])
+            for k in range(4)]
+    finally:
+        jbdd.set_gc_threshold(1 << 20)   # the default
+
+    assert len(sifted) == 4
+    back = {new: var for var, new in perm.items()}
+    for got, want in zip(sifted, expect):
+        assert jbdd.permute(got, back) == want
+
+
+if __name__ == "__main__":
+    test_sift_generator_survives_collection()
+    print("ok")